@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include "common/definitions.h"
+
+namespace marian {
+
+/**
+ * @brief Bump allocator for objects that are created and dropped in bulk,
+ * like the nodes of an expression graph between two calls to clear().
+ *
+ * Objects are placed one after the other in chunks of CHUNK_SIZE bytes.
+ * Memory of single objects is not reused, except for the object allocated
+ * last, but a chunk is reused as a whole as soon as its last object is
+ * released. Objects that outlive the others thus only hold on to their own
+ * chunk.
+ *
+ * An arena and the objects placed in it belong to one thread at a time.
+ * The owner calls release() instead of deleting the arena, which then lives
+ * on until its last object has been released.
+ */
+class Arena {
+public:
+  static const size_t CHUNK_SIZE = 1 << 16;
+
+private:
+  static const size_t ALIGN = alignof(std::max_align_t);
+
+  struct Chunk {
+    Chunk* next;
+    size_t size;
+    size_t used;
+    size_t live;
+  };
+
+  // every object is preceded by a pointer to its chunk
+  static const size_t HEADER = (sizeof(Chunk) + ALIGN - 1) / ALIGN * ALIGN;
+  static const size_t PREFIX = ALIGN;
+
+  Chunk* current_{nullptr};
+  Chunk* spare_{nullptr};
+  size_t chunks_{0};
+  size_t live_{0};
+  bool released_{false};
+
+  static size_t blockSize(size_t bytes) {
+    return PREFIX + (bytes + ALIGN - 1) / ALIGN * ALIGN;
+  }
+
+  static Chunk* chunkOf(void* ptr) {
+    return *reinterpret_cast<Chunk**>(static_cast<char*>(ptr) - PREFIX);
+  }
+
+  Chunk* newChunk(size_t size) {
+    if(size == CHUNK_SIZE && spare_) {
+      Chunk* chunk = spare_;
+      spare_ = chunk->next;
+      return chunk;
+    }
+    Chunk* chunk = static_cast<Chunk*>(::operator new(size));
+    chunk->size = size;
+    chunks_++;
+    return chunk;
+  }
+
+  void deleteChunk(Chunk* chunk) {
+    chunks_--;
+    ::operator delete(chunk);
+  }
+
+  void recycle(Chunk* chunk) {
+    if(chunk->size == CHUNK_SIZE) {
+      chunk->next = spare_;
+      spare_ = chunk;
+    } else {
+      deleteChunk(chunk);
+    }
+  }
+
+  ~Arena() {
+    while(spare_) {
+      Chunk* chunk = spare_;
+      spare_ = chunk->next;
+      deleteChunk(chunk);
+    }
+    if(current_)
+      deleteChunk(current_);
+  }
+
+public:
+  void* allocate(size_t bytes) {
+    size_t block = blockSize(bytes);
+    if(!current_ || current_->used + block > current_->size) {
+      // a chunk that is left behind is recycled with its last object
+      if(current_ && current_->live == 0)
+        recycle(current_);
+
+      size_t size = HEADER + block > CHUNK_SIZE ? HEADER + block : CHUNK_SIZE;
+      current_ = newChunk(size);
+      current_->next = nullptr;
+      current_->used = HEADER;
+      current_->live = 0;
+    }
+
+    char* ptr = reinterpret_cast<char*>(current_) + current_->used;
+    *reinterpret_cast<Chunk**>(ptr) = current_;
+    current_->used += block;
+    current_->live++;
+    live_++;
+    return ptr + PREFIX;
+  }
+
+  void deallocate(void* ptr, size_t bytes) {
+    Chunk* chunk = chunkOf(ptr);
+    chunk->live--;
+    live_--;
+
+    if(chunk == current_) {
+      // the last object, e.g. a node replaced by an existing equal one
+      char* end = static_cast<char*>(ptr) - PREFIX + blockSize(bytes);
+      if(end == reinterpret_cast<char*>(chunk) + chunk->used)
+        chunk->used -= blockSize(bytes);
+      if(chunk->live == 0)
+        chunk->used = HEADER;
+    } else if(chunk->live == 0) {
+      recycle(chunk);
+    }
+
+    if(released_ && live_ == 0)
+      delete this;
+  }
+
+  /** @brief Called by the owner instead of deleting the arena */
+  void release() {
+    released_ = true;
+    if(live_ == 0)
+      delete this;
+  }
+
+  /** @brief Number of chunks allocated from the heap */
+  size_t chunks() const { return chunks_; }
+
+  /** @brief Number of objects in the arena */
+  size_t live() const { return live_; }
+};
+
+/**
+ * @brief Standard allocator placing objects in an Arena
+ */
+template <class T>
+class ArenaAllocator {
+private:
+  template <class U>
+  friend class ArenaAllocator;
+
+  Arena* arena_;
+
+public:
+  typedef T value_type;
+
+  ArenaAllocator(Arena* arena) : arena_(arena) {}
+
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) { arena_->deallocate(ptr, n * sizeof(T)); }
+
+  template <class U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena_;
+  }
+
+  template <class U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena_;
+  }
+};
+
+/**
+ * @brief Like New, but object and reference count share a single block of
+ * the given arena
+ */
+template <class T, typename... Args>
+Ptr<T> NewInArena(Arena* arena, Args&&... args) {
+  return std::allocate_shared<T>(ArenaAllocator<T>(arena),
+                                 std::forward<Args>(args)...);
+}
+}
@@ -196,6 +196,19 @@ void ConfigParser::addOptionsCommon(po::options_description& desc) {
       "Preallocate  arg  MB of work space")
     ("log", po::value<std::string>(),
      "Log training process information to file given by  arg")
+    ("memory-stats", po::value<std::string>(),
+     "Write allocator statistics (peak usage, fragmentation, per-operation "
+     "attribution) as JSON to file given by  arg  at the end of the run")
+    ("fuse-elementwise", po::value<bool>()->zero_tokens()->default_value(false),
+     "Fold chains of element-wise operations into single kernels before each "
+     "forward pass")
+    ("eager-release", po::value<bool>()->zero_tokens()->default_value(false),
+     "Return tensors of inference graphs to the workspace as soon as their "
+     "last reader has run instead of keeping them until the graph is cleared")
+    ("profile", po::value<std::string>(),
+     "Time the steps of every node of the expression graph, log the most "
+     "expensive operations and parameter scopes at the end of the run and "
+     "write a Chrome trace (chrome://tracing) to file given by  arg")
     ("log-level", po::value<std::string>()->default_value("info"),
      "Set verbosity level of logging "
      "(trace - debug - info - warn - err(or) - critical - off)")
@@ -325,6 +338,25 @@ void ConfigParser::addOptionsTraining(po::options_description& desc) {
       ->multitoken()
       ->default_value(std::vector<int>({0}), "0"),
       "GPUs to use for training. Asynchronous SGD is used with multiple devices")
+    ("memory-planning", po::value<bool>()->zero_tokens()->default_value(false),
+      "Plan workspace memory statically per batch shape, tensors that are not "
+      "live at the same time share memory. Training only, translation and "
+      "rescoring use --eager-release")
+    ("graph-capture", po::value<size_t>()->default_value(0),
+      "Capture the graphs of up to  arg  batch shapes and replay them for "
+      "later batches of the same shape instead of rebuilding them, replaces "
+      "--memory-planning. 0 disables capturing")
+    ("rnn-checkpoint", po::value<int>()->default_value(0),
+      "Keep only every  arg -th state of recurrent layers after the forward "
+      "pass and recompute the steps in between during the backward pass. 0 "
+      "keeps all intermediate values")
+    ("health-check", po::value<size_t>()->default_value(0),
+      "Log minimum, maximum, mean and NaN/Inf counts of parameters, "
+      "gradients and cost every  arg  updates, computed on the device and "
+      "logged on a separate thread. 0 disables the check")
+    ("health-dump", po::value<std::string>(),
+      "With --health-check, write the nodes around tensors with NaNs or "
+      "infinities in graphviz notation to  arg.device.step.dot")
 
     ("mini-batch", po::value<int>()->default_value(64),
       "Size of mini-batch used during update")
@@ -496,6 +528,18 @@ void ConfigParser::addOptionsTranslate(po::options_description& desc) {
       "Number of batches to preload for length-based sorting")
     ("n-best", po::value<bool>()->zero_tokens()->default_value(false),
       "Display n-best list")
+    ("cpu", po::value<bool>()->zero_tokens()->default_value(false),
+      "Translate on the CPU, --devices then only sets the number of workers")
+    ("int8", po::value<bool>()->zero_tokens()->default_value(false),
+      "Use 8-bit integer matrix products with the model parameters, "
+      "requires --cpu")
+    ("half-precision", po::value<std::string>()->implicit_value("bf16"),
+      "Store the model parameters of matrix products as 16-bit floats, "
+      "arg: bf16 or fp16, requires --cpu")
+    ("concurrent-graph", po::value<bool>()->zero_tokens()->default_value(false),
+      "Run independent parts of the graph, like the scorers of an ensemble "
+      "or the directions of a bidirectional encoder, concurrently on the CPU "
+      "threads, requires --cpu")
     //("lexical-table", po::value<std::string>(),
     // "Path to lexical table")
     ("weights", po::value<std::vector<float>>()
@@ -655,6 +699,11 @@ void ConfigParser::parseOptions(
     SET_OPTION("save-freq", size_t);
     SET_OPTION("no-shuffle", bool);
     SET_OPTION("tempdir", std::string);
+    SET_OPTION("memory-planning", bool);
+    SET_OPTION("graph-capture", size_t);
+    SET_OPTION("rnn-checkpoint", int);
+    SET_OPTION("health-check", size_t);
+    SET_OPTION_NONDEFAULT("health-dump", std::string);
 
     SET_OPTION("optimizer", std::string);
     SET_OPTION("learn-rate", double);
@@ -710,6 +759,10 @@ void ConfigParser::parseOptions(
     SET_OPTION("n-best", bool);
     SET_OPTION("beam-size", size_t);
     SET_OPTION("allow-unk", bool);
+    SET_OPTION("cpu", bool);
+    SET_OPTION("int8", bool);
+    SET_OPTION_NONDEFAULT("half-precision", std::string);
+    SET_OPTION("concurrent-graph", bool);
     SET_OPTION_NONDEFAULT("weights", std::vector<float>);
     // SET_OPTION_NONDEFAULT("lexical-table", std::string);
     SET_OPTION("port", size_t);
@@ -749,6 +802,10 @@ void ConfigParser::parseOptions(
   SET_OPTION("workspace", size_t);
   SET_OPTION("log-level", std::string);
   SET_OPTION_NONDEFAULT("log", std::string);
+  SET_OPTION_NONDEFAULT("memory-stats", std::string);
+  SET_OPTION("fuse-elementwise", bool);
+  SET_OPTION("eager-release", bool);
+  SET_OPTION_NONDEFAULT("profile", std::string);
   SET_OPTION("seed", size_t);
   SET_OPTION("relative-paths", bool);
   SET_OPTION("devices", std::vector<int>);
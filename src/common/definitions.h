@@ -39,6 +39,9 @@ Ptr<T> New(Ptr<T> p) {
 
 namespace marian {
 
+/** @brief Memory space in which tensors of a graph are allocated and kernels are run */
+enum class DeviceType : size_t { gpu = 0, cpu = 1 };
+
 class TensorBase;
 typedef Ptr<TensorBase> Tensor;
 
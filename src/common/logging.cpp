@@ -74,6 +74,8 @@ void createLoggers(const marian::Config* options) {
   Logger warn{stderrLogger("warn", "[%Y-%m-%d %T] [warn] %v", generalLogs)};
   Logger config{stderrLogger("config", "[%Y-%m-%d %T] [config] %v", generalLogs)};
   Logger memory{stderrLogger("memory", "[%Y-%m-%d %T] [memory] %v", generalLogs)};
+  Logger profile{stderrLogger("profile", "[%Y-%m-%d %T] [profile] %v", generalLogs)};
+  Logger health{stderrLogger("health", "[%Y-%m-%d %T] [health] %v", generalLogs)};
   Logger data{stderrLogger("data", "[%Y-%m-%d %T] [data] %v", generalLogs)};
   Logger valid{stderrLogger("valid", "[%Y-%m-%d %T] [valid] %v", validLogs)};
   Logger translate{stderrLogger("translate", "%v")};
@@ -86,6 +88,8 @@ void createLoggers(const marian::Config* options) {
     set_loglevel(*warn, loglevel);
     set_loglevel(*config, loglevel);
     set_loglevel(*memory, loglevel);
+    set_loglevel(*profile, loglevel);
+    set_loglevel(*health, loglevel);
     set_loglevel(*data, loglevel);
     set_loglevel(*valid, loglevel);
     set_loglevel(*translate, loglevel);
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include "common/definitions.h"
+
+namespace marian {
+
+/**
+ * @brief Per-thread free list of fixed-size blocks.
+ *
+ * Blocks may be released on a different thread than the one that took them,
+ * they then simply move to the free list of the releasing thread. Lists are
+ * capped so that threads which only release objects do not hoard memory.
+ */
+template <size_t Bytes>
+class BlockFreeList {
+private:
+  static const size_t MAX_BLOCKS = 4096;
+
+  struct Block {
+    Block* next;
+  };
+
+  Block* head_{nullptr};
+  size_t count_{0};
+
+  // Set while the list of the calling thread exists. A trivially
+  // destructible thread_local stays readable during thread shutdown, when
+  // objects released after the list has been destroyed go to the heap.
+  static bool& alive() {
+    static thread_local bool alive{false};
+    return alive;
+  }
+
+public:
+  BlockFreeList() { alive() = true; }
+
+  ~BlockFreeList() {
+    alive() = false;
+    while(head_) {
+      Block* block = head_;
+      head_ = block->next;
+      ::operator delete(block);
+    }
+  }
+
+  void* take() {
+    if(!head_)
+      return ::operator new(Bytes);
+    Block* block = head_;
+    head_ = block->next;
+    --count_;
+    return block;
+  }
+
+  void give(void* ptr) {
+    if(count_ >= MAX_BLOCKS) {
+      ::operator delete(ptr);
+      return;
+    }
+    Block* block = static_cast<Block*>(ptr);
+    block->next = head_;
+    head_ = block;
+    ++count_;
+  }
+
+  /** @brief The list of the calling thread, null once it has been destroyed */
+  static BlockFreeList* local() {
+    static thread_local BlockFreeList list;
+    return alive() ? &list : nullptr;
+  }
+};
+
+/**
+ * @brief Standard allocator serving single objects from per-thread free
+ * lists, used for small objects that are created and dropped at a high rate
+ * by several threads.
+ */
+template <class T>
+class PoolAllocator {
+private:
+  static const size_t BLOCK_SIZE
+      = sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T);
+
+public:
+  typedef T value_type;
+
+  PoolAllocator() {}
+
+  template <class U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    auto list = n == 1 ? BlockFreeList<BLOCK_SIZE>::local() : nullptr;
+    if(list)
+      return static_cast<T*>(list->take());
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    auto list = n == 1 ? BlockFreeList<BLOCK_SIZE>::local() : nullptr;
+    if(list)
+      list->give(ptr);
+    else
+      ::operator delete(ptr);
+  }
+};
+
+template <class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return true;
+}
+
+template <class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+  return false;
+}
+
+/**
+ * @brief Like New, but object and reference count share a single block from
+ * a per-thread pool instead of two separate heap allocations
+ */
+template <class T, typename... Args>
+Ptr<T> NewPooled(Args&&... args) {
+  return std::allocate_shared<T>(PoolAllocator<T>(),
+                                 std::forward<Args>(args)...);
+}
+}
@@ -101,6 +101,11 @@ Corpus::Corpus(std::vector<std::string> paths,
 SentenceTuple Corpus::next() {
   bool cont = true;
   while(cont) {
+    // a corpus shuffled through line indices ends with its permutation
+    bool indexed = !indices_.empty() && !ids_.empty();
+    if(indexed && pos_ >= ids_.size())
+      break;
+
     // get index of the current sentence
     size_t curId = pos_;
     // if corpus has been shuffled, ids_ contains sentence indexes
@@ -112,7 +117,9 @@ SentenceTuple Corpus::next() {
     SentenceTuple tup(curId);
     for(size_t i = 0; i < files_.size(); ++i) {
       std::string line;
-      if(std::getline((std::istream&)*files_[i], line)) {
+      if(indexed)
+        line = indices_[i]->line(curId);
+      if(indexed || std::getline((std::istream&)*files_[i], line)) {
         Words words = (*vocabs_[i])(line);
         if(words.empty())
           words.push_back(0);
@@ -148,7 +155,37 @@ void Corpus::reset() {
   }
 }
 
+bool Corpus::shuffleIndexed(const std::vector<std::string>& paths) {
+  if(paths.empty())
+    return false;
+
+  if(indices_.empty()) {
+    for(auto& path : paths)
+      if(!LineIndex::indexable(path))
+        return false;
+    for(auto& path : paths) {
+      LOG(data)->info("Indexing lines of {}", path);
+      indices_.emplace_back(new LineIndex(path));
+    }
+  }
+
+  // like reading the files in parallel, stops at the end of the shortest
+  size_t lines = indices_[0]->size();
+  for(auto& index : indices_)
+    lines = std::min(lines, index->size());
+
+  LOG(data)->info("Shuffling {} sentences", lines);
+  pos_ = 0;
+  ids_.resize(lines);
+  std::iota(ids_.begin(), ids_.end(), 0);
+  std::shuffle(ids_.begin(), ids_.end(), g_);
+  return true;
+}
+
 void Corpus::shuffleFiles(const std::vector<std::string>& paths) {
+  if(shuffleIndexed(paths))
+    return;
+
   LOG(data)->info("Shuffling files");
 
   std::vector<std::vector<std::string>> corpus;
@@ -5,6 +5,7 @@
 #include <random>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 
 #include "common/config.h"
@@ -12,6 +13,7 @@
 #include "common/file_stream.h"
 #include "data/batch.h"
 #include "data/dataset.h"
+#include "data/line_index.h"
 #include "data/vocab.h"
 
 namespace marian {
@@ -115,6 +117,20 @@ public:
 
   size_t sets() const { return batches_.size(); }
 
+  /**
+   * @brief Hash of the dimensions of all sub-batches, batches with equal
+   * signatures are built into graphs of identical topology
+   */
+  size_t signature() const {
+    size_t seed = 0;
+    for(auto sb : batches_) {
+      boost::hash_combine(seed, sb->batchSize());
+      boost::hash_combine(seed, sb->batchWidth());
+    }
+    boost::hash_combine(seed, guidedAlignment_.empty());
+    return seed;
+  }
+
   static Ptr<CorpusBatch> fakeBatch(std::vector<size_t>& lengths,
                                     size_t batchSize,
                                     bool guidedAlignment = false) {
@@ -229,6 +245,8 @@ private:
 
   std::vector<UPtr<TemporaryFile>> tempFiles_;
   std::vector<UPtr<InputFileStream>> files_;
+  // built on the first shuffle, if all files can be indexed
+  std::vector<UPtr<LineIndex>> indices_;
   std::vector<Ptr<Vocab>> vocabs_;
   size_t maxLength_;
 
@@ -239,6 +257,8 @@ private:
   Ptr<WordAlignment> wordAlignment_;
 
   void shuffleFiles(const std::vector<std::string>& paths);
+  // shuffles sentence ids only, false if the files cannot be indexed
+  bool shuffleIndexed(const std::vector<std::string>& paths);
 
 public:
   Corpus(Ptr<Config> options, bool translate = false);
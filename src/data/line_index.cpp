@@ -0,0 +1,74 @@
+#include "data/line_index.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+#include "3rd_party/exception.h"
+
+namespace marian {
+namespace data {
+
+LineIndex::LineIndex(const std::string& path) : path_(path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  UTIL_THROW_IF2(fd == -1, "Cannot open " << path);
+
+  struct stat sb;
+  if(fstat(fd, &sb) == -1) {
+    close(fd);
+    UTIL_THROW2("Cannot stat " << path);
+  }
+  size_ = sb.st_size;
+
+  // the mapping stays valid after the descriptor is closed
+  if(size_ > 0) {
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    UTIL_THROW_IF2(ptr == MAP_FAILED, "Cannot map " << path);
+    data_ = static_cast<const char*>(ptr);
+  } else {
+    close(fd);
+  }
+
+  if(data_)
+    madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+  offsets_.push_back(0);
+  const char* pos = data_;
+  const char* end = data_ + size_;
+  while(pos < end) {
+    auto next = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    pos = next ? next + 1 : end;
+    offsets_.push_back(pos - data_);
+  }
+  offsets_.shrink_to_fit();
+
+  // lines are read in shuffled order from now on
+  if(data_)
+    madvise(const_cast<char*>(data_), size_, MADV_RANDOM);
+}
+
+LineIndex::~LineIndex() {
+  if(data_)
+    munmap(const_cast<char*>(data_), size_);
+}
+
+bool LineIndex::indexable(const std::string& path) {
+  return path != "stdin" && boost::filesystem::path(path).extension() != ".gz"
+         && boost::filesystem::is_regular_file(path);
+}
+
+std::string LineIndex::line(size_t i) const {
+  size_t begin = offsets_[i];
+  size_t end = offsets_[i + 1];
+  // the last line may end without a line break
+  if(end > begin && data_[end - 1] == '\n')
+    end--;
+  return std::string(data_ + begin, end - begin);
+}
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace marian {
+namespace data {
+
+/**
+ * @brief Random access to the lines of an uncompressed text file.
+ *
+ * The file is memory-mapped and scanned once for line breaks, afterwards
+ * every line is read in place by its number. The index holds one offset per
+ * line, so a shuffled corpus is read through a permutation of line numbers
+ * instead of being loaded and rewritten. Lines are returned without their
+ * line break, like std::getline does.
+ */
+class LineIndex {
+private:
+  std::string path_;
+  const char* data_{nullptr};
+  size_t size_{0};
+  // start of every line and the end of the last line
+  std::vector<size_t> offsets_;
+
+public:
+  LineIndex(const std::string& path);
+  ~LineIndex();
+
+  LineIndex(const LineIndex&) = delete;
+  LineIndex& operator=(const LineIndex&) = delete;
+
+  /** @brief False for compressed files and stdin, which cannot be indexed */
+  static bool indexable(const std::string& path);
+
+  const std::string& path() const { return path_; }
+
+  /** @brief Number of lines */
+  size_t size() const { return offsets_.size() - 1; }
+
+  /** @brief Line i, counting from 0 */
+  std::string line(size_t i) const;
+};
+}
+}
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "common/definitions.h"
+
 namespace marian {
 
 class Backend {
 public:
   virtual void setDevice(size_t device) = 0;
+  virtual DeviceType getDeviceType() = 0;
+
+  /** @brief Waits for all work queued on the current device */
+  virtual void synchronize() = 0;
 };
 }
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <random>
+
+#include "common/config.h"
+#include "graph/backend.h"
+
+namespace marian {
+
+class BackendCPU : public Backend {
+public:
+  void setDevice(size_t device) {}
+
+  DeviceType getDeviceType() { return DeviceType::cpu; }
+
+  void synchronize() {}
+
+  void setHandles(size_t device, size_t seed) { generator_.seed(seed); }
+
+  std::mt19937& getRandomGenerator() { return generator_; }
+
+private:
+  std::mt19937 generator_;
+};
+}
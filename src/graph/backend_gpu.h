@@ -21,6 +21,10 @@ class BackendGPU : public Backend {
 public:
   void setDevice(size_t device) { cudaSetDevice(device); }
 
+  DeviceType getDeviceType() { return DeviceType::gpu; }
+
+  void synchronize() { cudaStreamSynchronize(0); }
+
   void setHandles(size_t device, size_t seed) {
     cublasHandle_ = create_handle(device);
     curandGenerator_ = createCurandGenerator(device, Config::seed);
@@ -28,6 +32,13 @@ public:
 
   cublasHandle_t getCublasHandle() { return cublasHandle_; }
 
+  /** @brief cuBLAS handle of a backend, null for host backends */
+  static cublasHandle_t getCublasHandle(Ptr<Backend> backend) {
+    if(backend->getDeviceType() != DeviceType::gpu)
+      return nullptr;
+    return std::static_pointer_cast<BackendGPU>(backend)->getCublasHandle();
+  }
+
   curandGenerator_t getCurandGenerator() { return curandGenerator_; }
 
 private:
@@ -6,6 +6,7 @@
 
 #include "3rd_party/exception.h"
 #include "common/definitions.h"
+#include "kernels/element_program.h"
 
 /**
  * @brief Parent namespace for the Marian project
@@ -70,12 +71,24 @@ struct Chainable {
   virtual void setId(size_t) = 0;
   virtual size_t getId() = 0;
 
+  // readers of the value on the tape that have not run yet and whether the
+  // value has to outlive them, see ExpressionGraph::setEagerRelease
+  virtual void increaseEdges(size_t = 1) = 0;
+  virtual void decreaseEdges(size_t = 1) = 0;
+  virtual size_t edges() = 0;
+  virtual void setPersistent(bool) = 0;
+  virtual bool persistent() = 0;
+
   // virtual const std::string& type() = 0;
   virtual Ptr<ExpressionGraph> graph() = 0;
   virtual const Shape& shape() = 0;
 
   virtual std::vector<Expr>& children() = 0;
   virtual Expr child(size_t) = 0;
+  // node whose memory this node reuses instead of allocating its own
+  virtual Expr viewOf() { return nullptr; }
+  // node owning the memory of this node, the end of its chain of views
+  virtual Expr memoryOwner() = 0;
   virtual DataType& val() = 0;
   virtual DataType& grad() = 0;
   virtual float scalar() = 0;
@@ -95,5 +108,19 @@ struct Chainable {
 
   virtual size_t hash() = 0;
   virtual bool equal(Expr) = 0;
+
+  // takes over the per-batch data of an identically built node when a
+  // captured tape is replayed, children are the same for both
+  virtual void rebind(Expr) {}
+
+  // element-wise operation of the node on its children, ElementCode::None
+  // if the node cannot be part of a fused chain, see graph/fusion.h
+  virtual ElementOp elementOp() { return {ElementCode::None, 0.f}; }
+  // replaces children and computation of the node by a fused chain
+  virtual void fuse(const ElementProgram&, const std::vector<Expr>&) {}
+
+  // false if backward() only needs the adjoint and not the values of the
+  // children, see graph/checkpointing.h
+  virtual bool backwardReadsValues() { return true; }
 };
 }
@@ -0,0 +1,117 @@
+#include "graph/checkpointing.h"
+
+#include "graph/expression_graph.h"
+
+namespace marian {
+
+void Checkpointing::release(Expr node) {
+  node->graph()->free(node->val());
+  node->val() = nullptr;
+  released_.insert(node.get());
+}
+
+void Checkpointing::end(const std::vector<Expr>& keep) {
+  for(auto& node : keep)
+    kept_.insert(node->memoryOwner().get());
+  open_ = 0;
+}
+
+bool Checkpointing::prepare(const std::list<Expr>& nodesForward) {
+  segments_.clear();
+  index_.clear();
+  lastReader_.clear();
+  released_.clear();
+  restored_.clear();
+
+  for(auto& node : nodesForward)
+    for(auto& child : node->children())
+      lastReader_[child->memoryOwner().get()] = node.get();
+
+  // nodes nobody reads on the tape are results and stay
+  std::unordered_map<size_t, size_t> segmentIndex;
+  for(auto& node : nodesForward) {
+    auto it = segmentOf_.find(node.get());
+    if(it == segmentOf_.end() || kept_.count(node.get()) || node->viewOf()
+       || node->children().empty() || !lastReader_.count(node.get()))
+      continue;
+
+    auto found = segmentIndex.find(it->second);
+    if(found == segmentIndex.end()) {
+      found = segmentIndex.emplace(it->second, segments_.size()).first;
+      segments_.emplace_back();
+    }
+    segments_[found->second].nodes.push_back(node);
+    index_[node.get()] = found->second;
+  }
+
+  return !segments_.empty();
+}
+
+void Checkpointing::forwarded(Expr node) {
+  for(auto& child : node->children()) {
+    Expr o = child->memoryOwner();
+    if(index_.count(o.get()) && !released_.count(o.get())
+       && lastReader_[o.get()] == node.get())
+      release(o);
+  }
+}
+
+void Checkpointing::restore(Expr node,
+                            const std::function<void(Expr)>& run) {
+  std::function<void(Expr)> restoreOwner = [&](Expr n) {
+    Expr o = n->memoryOwner();
+    if(!released_.count(o.get()))
+      return;
+
+    auto& segment = segments_[index_[o.get()]];
+    if(segment.restored)
+      return;
+    segment.restored = true;
+    restored_.push_back(index_[o.get()]);
+
+    // nodes of the segment read earlier nodes of the segment, which are
+    // recomputed first, or values of other segments, restored recursively
+    for(auto& s : segment.nodes) {
+      if(!released_.count(s.get()))
+        continue;
+      for(auto& child : s->children())
+        restoreOwner(child);
+      run(s);
+      released_.erase(s.get());
+    }
+  };
+
+  restoreOwner(node);
+  if(node->backwardReadsValues())
+    for(auto& child : node->children())
+      restoreOwner(child);
+}
+
+void Checkpointing::backwarded(Expr node) {
+  // all readers of a segment come after its first node on the tape
+  auto it = restored_.begin();
+  while(it != restored_.end()) {
+    auto& segment = segments_[*it];
+    if(segment.nodes.front()->getId() >= node->getId()) {
+      for(auto& s : segment.nodes)
+        if(!released_.count(s.get()))
+          release(s);
+      segment.restored = false;
+      it = restored_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void Checkpointing::clear() {
+  open_ = 0;
+  segmentOf_.clear();
+  kept_.clear();
+  segments_.clear();
+  index_.clear();
+  lastReader_.clear();
+  released_.clear();
+  restored_.clear();
+}
+}
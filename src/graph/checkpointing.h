@@ -0,0 +1,92 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/definitions.h"
+#include "graph/chainable.h"
+
+namespace marian {
+
+/**
+ * @brief Trades memory for recomputation by releasing the values of segments
+ * of the tape after the forward pass and recomputing them in the backward
+ * pass.
+ *
+ * Nodes added between begin() and end() form a segment. The value of a
+ * segment node is freed as soon as the last node reading it in the forward
+ * pass has run. When the backward pass reaches a node that needs a released
+ * value, its own or one of its children's (see
+ * Chainable::backwardReadsValues), the released nodes of that segment are run
+ * forward again, first restoring values they read from other segments. A
+ * restored segment is released again once the backward pass has moved past
+ * its first node.
+ *
+ * Nodes passed to end(), leaves (parameters, constants including dropout
+ * masks) and views are never released, so segments are recomputed from kept
+ * values and with the same random masks. Values of released nodes are not
+ * available to the caller after the forward pass.
+ */
+class Checkpointing {
+private:
+  typedef Chainable<Tensor>* Key;
+
+  struct Segment {
+    std::vector<Expr> nodes;
+    bool restored{false};
+  };
+
+  // recorded while the graph is built
+  size_t open_{0};
+  size_t count_{0};
+  std::unordered_map<Key, size_t> segmentOf_;
+  std::unordered_set<Key> kept_;
+
+  // computed by prepare()
+  std::vector<Segment> segments_;
+  std::unordered_map<Key, size_t> index_;
+  std::unordered_map<Key, Key> lastReader_;
+  std::unordered_set<Key> released_;
+  std::vector<size_t> restored_;
+
+  void release(Expr node);
+
+public:
+  /** @brief Starts a new segment, nodes added from now on belong to it */
+  void begin() { open_ = ++count_; }
+
+  /** @brief Closes the current segment, keep are retained after forward */
+  void end(const std::vector<Expr>& keep);
+
+  /** @brief Adds a node appended to the tape to the open segment */
+  void record(Expr node) {
+    if(open_)
+      segmentOf_[node.get()] = open_;
+  }
+
+  /**
+   * @brief Collects the segments among the nodes of the forward tape, has to
+   * be called before the forward pass. Returns false if there are none.
+   */
+  bool prepare(const std::list<Expr>& nodesForward);
+
+  /** @brief Releases the values node was the last forward reader of */
+  void forwarded(Expr node);
+
+  /**
+   * @brief Restores the values the backward step of node needs, run has to
+   * allocate and compute a node
+   */
+  void restore(Expr node, const std::function<void(Expr)>& run);
+
+  /** @brief Releases the restored segments the backward pass moved past */
+  void backwarded(Expr node);
+
+  size_t released() { return released_.size(); }
+
+  void clear();
+};
+}
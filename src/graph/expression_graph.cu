@@ -1,30 +1,48 @@
 #include <sstream>
+#include "graph/backend_cpu.h"
 #include "graph/backend_gpu.h"
 #include "graph/expression_graph.h"
 #include "kernels/dropout.h"
+#include "kernels/dropout_cpu.h"
+#include "kernels/prod_half_cpu.h"
+#include "kernels/prod_int8_cpu.h"
 #include "kernels/tensor_operators.h"
 
 namespace marian {
 
 ExpressionGraph::ExpressionGraph(bool inference)
-    : inferenceOnly_(inference), backend_(New<BackendGPU>()) {}
+    : arena_(new Arena()),
+      inferenceOnly_(inference),
+      backend_(New<BackendGPU>()) {}
 
-void ExpressionGraph::setDevice(size_t device) {
+void ExpressionGraph::setDevice(size_t device, DeviceType type) {
   device_ = device;
+  type_ = type;
 
   params_ = New<Parameters>();
-  params_->init(device_);
+  params_->init(device_, type_);
 
-  tensors_ = New<TensorAllocator>(device);
+  tensors_ = New<TensorAllocator>(device, type);
 
-  std::static_pointer_cast<BackendGPU>(backend_)->setHandles(device,
-                                                             Config::seed);
+  if(type_ == DeviceType::cpu) {
+    auto backend = New<BackendCPU>();
+    backend->setHandles(device, Config::seed);
+    backend_ = backend;
+  } else {
+    auto backend = New<BackendGPU>();
+    backend->setHandles(device, Config::seed);
+    backend_ = backend;
+  }
 }
 
 Expr ExpressionGraph::dropout(float prob, Shape shape) {
   auto dropoutInit = [prob, this](Tensor t) {
-    Dropout(t, prob,
-      std::static_pointer_cast<BackendGPU>(backend_)->getCurandGenerator());
+    if(type_ == DeviceType::cpu)
+      cpu::Dropout(t, prob,
+        std::static_pointer_cast<BackendCPU>(backend_)->getRandomGenerator());
+    else
+      Dropout(t, prob,
+        std::static_pointer_cast<BackendGPU>(backend_)->getCurandGenerator());
   };
 
   return Expression<ConstantNode>(shared_from_this(),
@@ -34,8 +52,12 @@ Expr ExpressionGraph::dropout(float prob, Shape shape) {
 
 Expr ExpressionGraph::gaussian(float mean, float stddev, Shape shape) {
   auto gaussianInit = [mean, stddev, this](Tensor t) {
-    Gaussian(t, mean, stddev,
-      std::static_pointer_cast<BackendGPU>(backend_)->getCurandGenerator());
+    if(type_ == DeviceType::cpu)
+      cpu::Gaussian(t, mean, stddev,
+        std::static_pointer_cast<BackendCPU>(backend_)->getRandomGenerator());
+    else
+      Gaussian(t, mean, stddev,
+        std::static_pointer_cast<BackendGPU>(backend_)->getCurandGenerator());
   };
 
   return Expression<ConstantNode>(shared_from_this(),
@@ -43,8 +65,78 @@ Expr ExpressionGraph::gaussian(float mean, float stddev, Shape shape) {
                                   keywords::shape = shape);
 }
 
+Ptr<cpu::QuantizedMatrix> ExpressionGraph::quantized(Expr weights,
+                                                     bool trans) {
+  if(!int8_ || !inferenceOnly_ || type_ != DeviceType::cpu
+     || weights->type() != "param")
+    return nullptr;
+
+  // products of concurrently scheduled nodes may quantize at the same time
+  std::lock_guard<std::mutex> lock(quantizedMutex_);
+  auto& q = quantized_[std::make_pair(weights.get(), trans)];
+  if(!q)
+    q = New<cpu::QuantizedMatrix>(weights->val(), trans);
+  return q;
+}
+
+Ptr<cpu::HalfMatrix> ExpressionGraph::halfPrecision(Expr weights, bool trans) {
+  if(half_.empty() || int8_ || !inferenceOnly_ || type_ != DeviceType::cpu
+     || weights->type() != "param")
+    return nullptr;
+
+  std::lock_guard<std::mutex> lock(quantizedMutex_);
+  auto& h = halves_[std::make_pair(weights.get(), trans)];
+  if(!h)
+    h = New<cpu::HalfMatrix>(weights->val(),
+                             trans,
+                             half_ == "bf16" ? cpu::HalfType::bf16
+                                             : cpu::HalfType::fp16);
+  return h;
+}
+
 void ExpressionGraph::checkNan(Tensor t) {
   UTIL_THROW_IF2(throwNaN_ && IsNan(t), "Tensor has NaN");
 }
 
+void dumpMemoryStats(const std::vector<Ptr<ExpressionGraph>>& graphs,
+                     const std::string& fileName) {
+  for(auto graph : graphs) {
+    auto stats = graph->getWorkspace()->stats();
+    LOG(memory)->info(
+        "Workspace on device {}: peak {} MB of {} MB, {} grows ({:.2f}s), "
+        "{} gaps, largest gap {} MB",
+        graph->getDevice(),
+        stats.peak / (1024 * 1024),
+        stats.capacity / (1024 * 1024),
+        stats.grows,
+        stats.growSeconds,
+        stats.gaps,
+        stats.largestGap / (1024 * 1024));
+  }
+
+  if(!fileName.empty()) {
+    std::ofstream out(fileName);
+    out << "[";
+    for(size_t i = 0; i < graphs.size(); ++i)
+      out << (i ? ",\n " : "") << graphs[i]->memoryStats();
+    out << "]" << std::endl;
+  }
+}
+
+void dumpProfile(const std::vector<Ptr<ExpressionGraph>>& graphs,
+                 const std::string& fileName) {
+  std::vector<Ptr<Profiler>> profilers;
+  for(auto graph : graphs)
+    if(graph->getProfiler())
+      profilers.push_back(graph->getProfiler());
+  if(profilers.empty())
+    return;
+
+  Profiler::log(profilers, 20);
+
+  if(!fileName.empty()) {
+    std::ofstream out(fileName);
+    Profiler::writeTrace(profilers, out);
+  }
+}
 }
@@ -2,17 +2,26 @@
 
 #include <fstream>
 #include <map>
+#include <mutex>
 #include <unordered_set>
 
 #include "3rd_party/cnpy/cnpy.h"
 #include "3rd_party/threadpool.h"
+#include "common/arena_allocator.h"
 #include "common/config.h"
 #include "common/definitions.h"
 #include "data/batch_generator.h"
 #include "graph/backend.h"
 #include "graph/chainable.h"
+#include "graph/checkpointing.h"
+#include "graph/fusion.h"
+#include "graph/health_monitor.h"
+#include "graph/memory_planner.h"
 #include "graph/node_operators.h"
 #include "graph/parameters.h"
+#include "graph/profiler.h"
+#include "graph/scheduler.h"
+#include "graph/tape_cache.h"
 #include "layers/param_initializers.h"
 #include "tensors/tensor_allocator.h"
 
@@ -21,6 +30,11 @@ namespace marian {
 template <class T, typename... Args>
 Expr Expression(Args&&... args);
 
+namespace cpu {
+class QuantizedMatrix;
+class HalfMatrix;
+}
+
 /**
  * @brief Represents a computation graph of expressions, over which algorithmic
  * differentiation may be performed.
@@ -29,6 +43,9 @@ class ExpressionGraph : public std::enable_shared_from_this<ExpressionGraph> {
 private:
   size_t count_{0};
 
+  // nodes other than parameters, owned by the graph, see ~ExpressionGraph
+  Arena* arena_;
+
   std::list<Expr> nodesForward_;
   std::list<Expr> nodesBackward_;
 
@@ -37,6 +54,7 @@ private:
   Ptr<TensorAllocator> tensors_;
 
   size_t device_;
+  DeviceType type_{DeviceType::gpu};
   Ptr<Backend> backend_;
 
   std::unordered_map<size_t, std::vector<WExpr>> hashMap_;
@@ -46,6 +64,151 @@ private:
   std::string namespace_;
 
   bool throwNaN_{false};
+  bool fusion_{false};
+
+  bool eagerRelease_{false};
+  // nodes with smaller ids have been through a forward pass
+  size_t forwarded_{0};
+
+  bool int8_{false};
+  std::map<std::pair<Chainable<Tensor>*, bool>, Ptr<cpu::QuantizedMatrix>>
+      quantized_;
+  std::string half_;
+  std::map<std::pair<Chainable<Tensor>*, bool>, Ptr<cpu::HalfMatrix>> halves_;
+  std::mutex quantizedMutex_;
+
+  Ptr<MemoryPlanner> planner_;
+  Ptr<TapeCache> tapes_;
+  Ptr<Profiler> profiler_;
+  Ptr<Checkpointing> checkpoints_;
+  bool recompute_{false};
+  Ptr<Scheduler> scheduler_;
+  Ptr<HealthMonitor> monitor_;
+
+  // steps scheduled concurrently may allocate, e.g. Concatenate's backward
+  std::mutex tensorsMutex_;
+
+  void append(Expr node) {
+    nodesForward_.push_back(node);
+    if(!inferenceOnly_ && node->trainable()) {
+      nodesBackward_.push_back(node);
+      topNodes_.insert(node);
+    }
+  }
+
+  // Adjoints of a replayed tape are still allocated from the previous pass
+  // and set_zero_adjoint() would not reset them
+  void resetAdjoints() {
+    for(auto&& v : nodesBackward_)
+      if(!v->viewOf() && v->grad())
+        v->grad()->set(0);
+
+    for(auto&& v : topNodes_) {
+      Expr owner = v->memoryOwner();
+      if(owner->grad())
+        owner->grad()->set(1);
+    }
+  }
+
+  // Returns the values v was the last reader of to the workspace
+  void releaseChildren(Expr v) {
+    for(auto&& child : v->children()) {
+      Expr o = child->memoryOwner();
+      o->decreaseEdges();
+      if(o->edges() == 0 && !o->persistent() && o->val()
+         && o->type() != "param") {
+        free(o->val());
+        o->val() = nullptr;
+      }
+    }
+  }
+
+  // Runs one step of node v, timed if profiling is enabled. The device is
+  // synchronized around the step so that kernels are attributed to the step
+  // that launched them.
+  template <class Step>
+  void profile(Expr v, Profiler::Phase phase, Step step) {
+    if(!profiler_) {
+      step();
+      return;
+    }
+    backend_->synchronize();
+    auto begin = Profiler::Clock::now();
+    step();
+    backend_->synchronize();
+    profiler_->record(v, phase, begin, Profiler::Clock::now());
+  }
+
+  // Steps that time, release or recompute nodes rely on the tape order
+  bool concurrent(bool taped, bool release) {
+    return scheduler_ && type_ == DeviceType::cpu && !profiler_ && !planner_
+           && !taped && !release && !recompute_;
+  }
+
+  // Runs the forward steps of the tape on the scheduler. Leaves are
+  // allocated and initialized in order, other nodes allocate their value
+  // when their step becomes ready and, in inference, drop their children
+  // after it, so values that have been read are reused as in the sequential
+  // pass. The workspace is grown up front so that it does not move under
+  // running steps.
+  void forwardConcurrent() {
+    size_t bytes = 0;
+    for(auto&& v : nodesForward_) {
+      if(v->children().empty()) {
+        v->allocate();
+        v->init();
+      } else if(!v->val()) {
+        bytes += tensors_->capacity(v->shape());
+      }
+    }
+    tensors_->ensure(bytes);
+
+    std::list<Expr> nodes;
+    nodes.swap(nodesForward_);
+    scheduler_->forward(std::move(nodes), [this](Expr v) {
+      v->allocate();
+      v->init();
+      v->forward();
+
+      checkNan(v->val());
+
+      if(v->marked_for_debug()) {
+        std::cerr << "Debug: " << v->debug_message() << std::endl;
+        std::cerr << v->val()->debug() << std::endl;
+      }
+
+      if(inferenceOnly_)
+        v->children().clear();
+    });
+  }
+
+  // Allocates the adjoints of the backward tape in order, then runs the
+  // backward steps on the scheduler
+  void backwardConcurrent() {
+    for(auto it = nodesBackward_.rbegin(); it != nodesBackward_.rend(); ++it)
+      for(auto&& child : (*it)->children())
+        if(child->trainable())
+          child->set_zero_adjoint();
+
+    scheduler_->backward(nodesBackward_, [](Expr v) {
+      if(v->trainable())
+        v->backward();
+    });
+
+    while(!nodesBackward_.empty()) {
+      auto v = nodesBackward_.back();
+      nodesBackward_.pop_back();
+
+      checkNan(v->grad());
+
+      if(v->trainable() && v->marked_for_debug()) {
+        std::cerr << "Debug Grad: " << v->debug_message() << std::endl;
+        std::cerr << v->grad()->debug() << std::endl;
+      }
+
+      v->children().clear();
+    }
+  }
 
 protected:
   // Delete, copy and move constructors
@@ -62,10 +225,19 @@ public:
   ~ExpressionGraph() {
     clear();
     params_->clear();
+    // nodes still referenced elsewhere keep the arena alive
+    arena_->release();
   }
 
-  void setDevice(size_t device = 0);
+  /**
+   * @brief Selects the memory space and device the graph is executed on.
+   *
+   * With DeviceType::cpu tensors are kept in host memory, the device number is
+   * then only used for bookkeeping.
+   */
+  void setDevice(size_t device = 0, DeviceType type = DeviceType::gpu);
   size_t getDevice() { return device_; }
+  DeviceType getDeviceType() { return type_; }
 
   Ptr<Backend> getBackend() { return backend_; }
 
@@ -79,6 +251,8 @@ public:
   }
 
   void copyParams(Ptr<ExpressionGraph> graph) {
+    quantized_.clear();
+    halves_.clear();
     for(auto p : *graph->params())
       param(p->name(), p->shape());
     params()->allocateForward();
@@ -89,6 +263,8 @@ public:
     tensors_ = graph->tensors_;
   }
 
+  Ptr<TensorAllocator> getWorkspace() { return tensors_; }
+
   /**
    * @brief Performs backpropogation on this expression graph.
    *
@@ -101,16 +277,24 @@ public:
     backward();
   }
 
+  /**
+   * @brief Runs a trial forward and backward pass, false if the workspace
+   * would have to grow. The tape of a trial build is dropped, so later trials
+   * are measured without the tensors of earlier ones.
+   */
   bool fits() {
+    bool fits = true;
     try {
       tensors_->throwAtReallocation(true);
       backprop();
       tensors_->throwAtReallocation(false);
     } catch(AllocationException& e) {
       tensors_->throwAtReallocation(false);
-      return false;
+      fits = false;
     }
-    return true;
+    if(tapes_)
+      tapes_->drop();
+    return fits;
   }
 
   /**
@@ -140,11 +324,38 @@ public:
     // @TODO: check if allocation works properly
     hashMap_.clear();
 
+    // nodes of a tape keep their children and tensors for the next replay
+    bool taped = tapes_ && tapes_->active();
+    if(tapes_)
+      tapes_->finish();
+
+    // the nodes of a tape have to stay as they were captured
+    if(fusion_ && !taped)
+      fuseElementwise(nodesForward_, nodesBackward_);
+
+    if(planner_)
+      planner_->prepare(nodesForward_, nodesBackward_, topNodes_, tensors_);
+
+    // released values have no place in a plan or a tape
+    recompute_ = checkpoints_ && !inferenceOnly_ && !planner_ && !taped
+                 && checkpoints_->prepare(nodesForward_);
+
+    bool release = eagerRelease_ && inferenceOnly_ && !planner_ && !taped;
+    if(release)
+      for(auto&& v : nodesForward_)
+        for(auto&& child : v->children())
+          child->memoryOwner()->increaseEdges();
+
+    if(concurrent(taped, release))
+      forwardConcurrent();
+
     while(!nodesForward_.empty()) {
       auto v = nodesForward_.front();
-      v->allocate();
-      v->init();
-      v->forward();
+      if(planner_)
+        planner_->bindValue(v);
+      profile(v, Profiler::Allocate, [&] { v->allocate(); });
+      profile(v, Profiler::Init, [&] { v->init(); });
+      profile(v, Profiler::Forward, [&] { v->forward(); });
 
       checkNan(v->val());
 
@@ -153,10 +364,16 @@ public:
         std::cerr << v->val()->debug() << std::endl;
       }
 
-      if(inferenceOnly_)
+      if(recompute_)
+        checkpoints_->forwarded(v);
+      if(release)
+        releaseChildren(v);
+
+      if(inferenceOnly_ && !taped)
         v->children().clear();
       nodesForward_.pop_front();
     }
+    forwarded_ = count_;
   }
 
   /**
@@ -182,23 +399,53 @@ public:
     params_->allocateBackward();
     params_->set_zero_adjoint();
 
-    for(auto&& v : topNodes_)
+    bool taped = tapes_ && tapes_->active();
+    if(taped)
+      resetAdjoints();
+
+    // values and children are gone after the backward pass
+    bool sampled = monitor_ && monitor_->due();
+    std::vector<Expr> tops;
+    if(sampled) {
+      tops.assign(topNodes_.begin(), topNodes_.end());
+      monitor_->capture(nodesBackward_);
+    }
+
+    for(auto&& v : topNodes_) {
+      if(planner_)
+        planner_->bindGradient(v, 1.f);
       v->init_dependent();
+    }
 
     // named_.clear();
     topNodes_.clear();
     hashMap_.clear();
 
+    if(concurrent(taped, false))
+      backwardConcurrent();
+
     while(!nodesBackward_.empty()) {
       auto v = nodesBackward_.back();
       nodesBackward_.pop_back();
 
       for(auto&& child : v->children()) {
-        if(child->trainable())
-          child->set_zero_adjoint();
+        if(child->trainable()) {
+          if(planner_)
+            planner_->bindGradient(child, 0.f);
+          profile(child, Profiler::Allocate, [&] {
+            child->set_zero_adjoint();
+          });
+        }
       }
+      if(recompute_)
+        checkpoints_->restore(v, [&](Expr node) {
+          profile(node, Profiler::Allocate, [&] { node->allocate(); });
+          profile(node, Profiler::Forward, [&] { node->forward(); });
+        });
       if(v->trainable())
-        v->backward();
+        profile(v, Profiler::Backward, [&] { v->backward(); });
+      if(recompute_)
+        checkpoints_->backwarded(v);
 
       checkNan(v->grad());
 
@@ -207,8 +454,15 @@ public:
         std::cerr << v->grad()->debug() << std::endl;
       }
 
-      v->children().clear();
+      if(!taped)
+        v->children().clear();
     }
+
+    if(sampled)
+      monitor_->sample(std::vector<Expr>(params_->begin(), params_->end()),
+                       params_->vals(),
+                       params_->grads(),
+                       tops);
   }
 
   /**
@@ -285,9 +539,10 @@ public:
                    "Non-parameter with name " << name << "already exists");
 
 
-    // create parameter node (adds to tape)
-    p = Expression<ParamNode>(
-        shared_from_this(), keywords::shape = shape, args...);
+    // create parameter node (adds to tape), parameters outlive clear() and
+    // are not placed in the node arena
+    p = add(New<ParamNode>(
+        shared_from_this(), keywords::shape = shape, args...));
 
     // add to list of parameters
     p->set_name(name);
@@ -382,6 +637,14 @@ public:
   Expr add(Expr node) {
     // size_t group = 0;
 
+    if(tapes_ && tapes_->replaying()) {
+      bool onTape;
+      auto captured = tapes_->replay(node, onTape);
+      count_ = std::max(count_, captured->getId() + 1);
+      if(onTape)
+        append(captured);
+      return captured;
+    }
 
     size_t hash = node->hash();
     auto it = hashMap_.find(hash);
@@ -389,8 +652,11 @@ public:
 
       for(auto foundWeak : it->second) {
         auto found = foundWeak.lock();
-        if(node->equal(found))
+        if(node->equal(found)) {
+          if(tapes_)
+            tapes_->capture(found, false);
           return found;
+        }
       }
 
       //auto f = it->second.lock();
@@ -408,15 +674,25 @@ public:
       //return it->second.lock();
     }
 
+    if(eagerRelease_ && inferenceOnly_)
+      for(auto&& child : node->children()) {
+        Expr o = child->memoryOwner();
+        UTIL_THROW_IF2(o->getId() < forwarded_ && !o->val()
+                           && o->type() != "param",
+                       "Value of " << o->type() << " node " << o->getId()
+                                   << " was released after its last reader, "
+                                      "it has to be marked as persistent");
+      }
+
     hashMap_[hash].push_back(node);
 
     node->setId(count_++);
 
-    nodesForward_.push_back(node);
-    if(!inferenceOnly_ && node->trainable()) {
-      nodesBackward_.push_back(node);
-      topNodes_.insert(node);
-    }
+    append(node);
+    if(tapes_)
+      tapes_->capture(node, true);
+    if(checkpoints_)
+      checkpoints_->record(node);
 
     return node;
   }
@@ -425,10 +701,16 @@ public:
 
   template <class... Args>
   void tensor(Tensor& t, Args&&... args) {
+    std::lock_guard<std::mutex> lock(tensorsMutex_);
     tensors_->allocate(t, args...);
+    if(planner_)
+      planner_->relocate();
   }
 
   void free(Tensor& t) {
+    if(planner_ && planner_->owns(t))
+      return;
+    std::lock_guard<std::mutex> lock(tensorsMutex_);
     if(tensors_)
       tensors_->free(t);
   }
@@ -436,29 +718,240 @@ public:
   void clear() {
     // clear everything apart from parameters
     count_ = 0;
+    forwarded_ = 0;
     nodesForward_.clear();
     nodesBackward_.clear();
 
     topNodes_.clear();
     hashMap_.clear();
-    tensors_->clear();
+    if(planner_)
+      planner_->clear();
+    if(profiler_)
+      profiler_->clear();
+    if(checkpoints_)
+      checkpoints_->clear();
+    recompute_ = false;
+
+    // captured tapes own tensors in the workspace, the remaining nodes free
+    // theirs when they are destroyed
+    if(tapes_)
+      tapes_->end();
+    if(!tapes_ || tapes_->size() == 0)
+      tensors_->clear();
+  }
+
+  void clearParameters() {
+    params_->clear();
+    // quantized and 16-bit copies are keyed by the address of their parameter
+    quantized_.clear();
+    halves_.clear();
   }
 
-  void clearParameters() { params_->clear(); }
+  /**
+   * @brief Arena the nodes of the graph are placed in. Chunks of the arena
+   * are reused once all nodes placed in them are gone, usually after clear().
+   */
+  Arena* getArena() { return arena_; }
+
+  /**
+   * @brief Usage, fragmentation and per-operation statistics of the
+   * workspace and parameter allocators as a JSON object.
+   */
+  std::string memoryStats() {
+    std::stringstream json;
+    json << "{\"workspace\": " << tensors_->statsJson()
+         << ", \"params\": " << params_->getValsAlloc()->statsJson()
+         << ", \"grads\": " << params_->getGradsAlloc()->statsJson() << "}";
+    return json.str();
+  }
 
   void setReloaded(bool reloaded) {
     reloaded_ = reloaded;
   }
 
+  /**
+   * @brief Runs products with parameters in 8-bit integer arithmetic.
+   *
+   * Only applies to inference graphs on the CPU. Parameters are quantized
+   * once, on their first use after loading.
+   */
+  void setInt8(bool int8) {
+    int8_ = int8;
+    quantized_.clear();
+  }
+
+  /**
+   * @brief 8-bit version of op(weights) as the right operand of a product,
+   * null if weights is not a parameter or setInt8 does not apply
+   */
+  Ptr<cpu::QuantizedMatrix> quantized(Expr weights, bool trans);
+
+  /**
+   * @brief Stores parameters used in products as "bf16" or "fp16", products
+   * compute in single precision. An empty type turns this off.
+   *
+   * Only applies to inference graphs on the CPU, setInt8 takes precedence.
+   * Parameters are converted once, on their first use after loading.
+   */
+  void setHalfPrecision(const std::string& type) {
+    UTIL_THROW_IF2(!type.empty() && type != "bf16" && type != "fp16",
+                   "Unknown 16-bit type " << type);
+    half_ = type;
+    halves_.clear();
+  }
+
+  /**
+   * @brief 16-bit version of op(weights) as the right operand of a product,
+   * null if weights is not a parameter or setHalfPrecision does not apply
+   */
+  Ptr<cpu::HalfMatrix> halfPrecision(Expr weights, bool trans);
+
+  /**
+   * @brief Checks the value and gradient of every node for NaNs, which
+   * synchronizes the device after each step. See setHealthMonitor for a
+   * sampled alternative.
+   */
   void setThrowNaN(bool throwNaN) {
     throwNaN_ = throwNaN;
   }
 
+  /**
+   * @brief Samples the parameters, their gradients and the top node every
+   * N-th backward pass and computes value statistics on a worker thread, see
+   * HealthMonitor. Nodes around tensors with NaNs or infinities are dumped
+   * to dumpPrefix.device.step.dot if dumpPrefix is not empty. 0 disables
+   * sampling.
+   */
+  void setHealthMonitor(size_t every, const std::string& dumpPrefix = "") {
+    monitor_ = every > 0 ? New<HealthMonitor>(device_, every, dumpPrefix)
+                         : nullptr;
+  }
+
+  Ptr<HealthMonitor> getHealthMonitor() { return monitor_; }
+
+  /**
+   * @brief Folds chains of element-wise nodes into single kernels before
+   * each forward pass, see fuseElementwise in graph/fusion.h
+   */
+  void setFusion(bool fusion) {
+    fusion_ = fusion;
+  }
+
+  /**
+   * @brief Enables static workspace planning: tensor lifetimes are computed
+   * from the tape before each forward pass, tensors are placed at fixed
+   * offsets of a single arena and plans are reused for tapes of identical
+   * shape.
+   *
+   * Meant for training graphs. In forward-only graphs every value may still
+   * be read by the caller, e.g. decoder states by the next search step, so
+   * planned values live until the graph is cleared; such graphs return
+   * tensors early with setEagerRelease instead.
+   */
+  void setMemoryPlanning(bool planning) {
+    planner_ = planning ? New<MemoryPlanner>() : nullptr;
+    if(planner_)
+      tapes_ = nullptr;
+  }
+
+  /**
+   * @brief Enables capture and replay of graph builds: after beginTape(key)
+   * the first build for a key is captured and later builds for the same key
+   * reuse its nodes and tensors, see TapeCache. Up to maxTapes tapes are
+   * kept, 0 disables capturing. Tensor assignments are part of the tape, so
+   * this replaces memory planning.
+   */
+  void setGraphCapture(size_t maxTapes) {
+    tapes_ = maxTapes ? New<TapeCache>(maxTapes) : nullptr;
+    if(tapes_)
+      planner_ = nullptr;
+  }
+
+  /**
+   * @brief Selects the tape for the following build of a cleared graph. The
+   * key has to determine the topology of the graph, e.g. a hash of the batch
+   * dimensions. Does nothing if graph capture is disabled.
+   */
+  void beginTape(size_t key) {
+    if(!tapes_)
+      return;
+    UTIL_THROW_IF2(!nodesForward_.empty(),
+                   "Tapes can only be started on a cleared graph");
+    tapes_->begin(key);
+  }
+
+  Ptr<TapeCache> getTapes() { return tapes_; }
+
+  /**
+   * @brief Times every step of every node from now on, see Profiler. Has to
+   * be called after setDevice.
+   */
+  void setProfiling(bool profiling) {
+    profiler_ = profiling ? New<Profiler>(device_) : nullptr;
+  }
+
+  Ptr<Profiler> getProfiler() { return profiler_; }
+
+  /**
+   * @brief Returns the value of a node of an inference graph to the
+   * workspace as soon as the last node reading it in a forward pass has run.
+   * Values read in later forward passes, like decoder states and the encoder
+   * context during beam search, have to be marked with setPersistent; using
+   * a released value is an error. Values without readers are kept. Does not
+   * apply with memory planning or graph capture.
+   */
+  void setEagerRelease(bool eagerRelease) {
+    eagerRelease_ = eagerRelease;
+  }
+
+  /**
+   * @brief Enables recomputation of segments marked with beginSegment and
+   * endSegment in the backward pass instead of keeping their values, see
+   * Checkpointing. Does not apply to inference graphs, with memory planning
+   * or with graph capture.
+   */
+  void setCheckpointing(bool checkpointing) {
+    checkpoints_ = checkpointing ? New<Checkpointing>() : nullptr;
+  }
+
+  /** @brief Starts a recomputed segment if checkpointing is enabled */
+  void beginSegment() {
+    if(checkpoints_)
+      checkpoints_->begin();
+  }
+
+  /**
+   * @brief Ends the current segment, the values of keep are retained after
+   * the forward pass and the segment is recomputed from them
+   */
+  void endSegment(const std::vector<Expr>& keep) {
+    if(checkpoints_)
+      checkpoints_->end(keep);
+  }
+
+  Ptr<Checkpointing> getCheckpointing() { return checkpoints_; }
+
+  /**
+   * @brief Runs independent nodes of the forward and backward passes
+   * concurrently on the host thread pool, see Scheduler. With deterministic
+   * gradients are accumulated in tape order and match the sequential backward
+   * pass bit for bit. Only applies to graphs on the CPU without profiling,
+   * eager release, checkpointing, memory planning or graph capture. All
+   * values of a forward pass are allocated before its first step runs.
+   */
+  void setConcurrency(bool concurrent, bool deterministic = false) {
+    scheduler_ = concurrent ? New<Scheduler>(deterministic) : nullptr;
+  }
+
+  Ptr<Scheduler> getScheduler() { return scheduler_; }
+
   void load(const std::string& name) {
     using namespace keywords;
 
     LOG(info)->info("Loading model from {}", name);
     setReloaded(false);
+    quantized_.clear();
+    halves_.clear();
 
     auto numpy = cnpy::npz_load(name);
 
@@ -533,11 +1026,45 @@ public:
   }
 };
 
+/**
+ * @brief Logs a summary of the workspace usage of the given graphs and, if
+ * a file name is given, writes their full memory statistics as JSON array.
+ */
+void dumpMemoryStats(const std::vector<Ptr<ExpressionGraph>>& graphs,
+                     const std::string& fileName = "");
+
+/**
+ * @brief Logs the most expensive operations and parameter scopes of the
+ * given graphs and, if a file name is given, writes their profiles as a
+ * Chrome trace. Graphs without profiling are skipped.
+ */
+void dumpProfile(const std::vector<Ptr<ExpressionGraph>>& graphs,
+                 const std::string& fileName = "");
+
+// The graph a node belongs to, given the first argument of its constructor
+inline Ptr<ExpressionGraph> graphOf(const Ptr<ExpressionGraph>& graph) {
+  return graph;
+}
+
+inline Ptr<ExpressionGraph> graphOf(const Expr& node) {
+  return node->graph();
+}
+
+inline Ptr<ExpressionGraph> graphOf(const std::vector<Expr>& nodes) {
+  return nodes.front()->graph();
+}
+
+template <class Head, typename... Tail>
+Ptr<ExpressionGraph> graphOfArgs(const Head& head, const Tail&...) {
+  return graphOf(head);
+}
+
 template <class T, typename... Args>
 Expr Expression(Args&&... args) {
   // @TODO check hash, if exists do not add and return
   // cached node to minimize calculations
-  auto e = Expr(new T(std::forward<Args>(args)...));
-  return e->graph()->add(e);
+  auto graph = graphOfArgs(args...);
+  auto e = Expr(NewInArena<T>(graph->getArena(), std::forward<Args>(args)...));
+  return graph->add(e);
 }
 }
@@ -0,0 +1,165 @@
+#include "graph/fusion.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace marian {
+
+namespace {
+
+typedef Chainable<Tensor>* NodePtr;
+
+bool isBinary(ElementCode code) {
+  return code == ElementCode::Add || code == ElementCode::Sub
+         || code == ElementCode::Mul || code == ElementCode::Div;
+}
+
+// Builds the program for the chain ending in one node, children of the
+// chain that cannot be folded become inputs
+class ChainBuilder {
+private:
+  const std::unordered_map<NodePtr, size_t>& readers_;
+  const std::unordered_set<NodePtr>& backward_;
+  Shape shape_;
+
+  ElementProgram program_;
+  std::unordered_map<NodePtr, int> inputIndex_;
+  bool overflow_{false};
+
+  bool foldable(const Expr& node) {
+    auto it = readers_.find(node.get());
+    if(it == readers_.end() || it->second != 1)
+      return false;
+    if(node->elementOp().code == ElementCode::None)
+      return false;
+    if(node->shape() != shape_ || node->marked_for_debug())
+      return false;
+    // referenced by the forward tape, the backward tape and the consumer
+    long refs = 2 + backward_.count(node.get());
+    return node.use_count() == refs;
+  }
+
+  // inputs of another shape are read with broadcasting, e.g. a bias row
+  bool broadcastable(const Shape& shape) {
+    for(int i = 0; i < (int)shape.size(); ++i)
+      if(shape[i] != shape_[i] && shape[i] != 1)
+        return false;
+    return true;
+  }
+
+  int push(ElementCode code, int a, int b, float scalar) {
+    if(program_.size == ElementProgram::MAX_INSTRS) {
+      overflow_ = true;
+      return 0;
+    }
+    program_.instrs[program_.size] = {code, (uint8_t)a, (uint8_t)b, scalar};
+    return program_.size++;
+  }
+
+  int input(const Expr& node) {
+    auto it = inputIndex_.find(node.get());
+    if(it != inputIndex_.end())
+      return it->second;
+
+    if(!broadcastable(node->shape())
+       || inputs.size() == ElementProgram::MAX_INPUTS) {
+      overflow_ = true;
+      return 0;
+    }
+    int j = push(ElementCode::Input, inputs.size(), 0, 0.f);
+    inputs.push_back(node);
+    inputIndex_[node.get()] = j;
+    return j;
+  }
+
+  int emit(const Expr& node, bool root) {
+    if(overflow_)
+      return 0;
+    if(!root && !foldable(node))
+      return input(node);
+    if(!root)
+      folded.push_back(node.get());
+
+    auto op = node->elementOp();
+    auto& children = node->children();
+    if(isBinary(op.code)) {
+      int a = emit(children[0], false);
+      int b = emit(children[1], false);
+      return push(op.code, a, b, op.scalar);
+    }
+
+    // unary operations of several children apply to their sum
+    int a = emit(children[0], false);
+    for(size_t i = 1; i < children.size(); ++i)
+      a = push(ElementCode::Add, a, emit(children[i], false), 0.f);
+    return push(op.code, a, a, op.scalar);
+  }
+
+public:
+  std::vector<Expr> inputs;
+  std::vector<NodePtr> folded;
+
+  ChainBuilder(const std::unordered_map<NodePtr, size_t>& readers,
+               const std::unordered_set<NodePtr>& backward)
+      : readers_(readers), backward_(backward) {}
+
+  // false if nothing could be folded into node
+  bool build(const Expr& node) {
+    shape_ = node->shape();
+    program_.size = 0;
+    inputIndex_.clear();
+    inputs.clear();
+    folded.clear();
+    overflow_ = false;
+
+    emit(node, true);
+    program_.inputs = inputs.size();
+    return !overflow_ && !folded.empty();
+  }
+
+  const ElementProgram& program() { return program_; }
+};
+}
+
+size_t fuseElementwise(std::list<Expr>& nodesForward,
+                       std::list<Expr>& nodesBackward) {
+  // readers of nodes on the forward tape, nodes computed in earlier passes
+  // are not in the map
+  std::unordered_map<NodePtr, size_t> readers;
+  for(auto& v : nodesForward)
+    readers[v.get()] = 0;
+  for(auto& v : nodesForward)
+    for(auto& child : v->children()) {
+      auto it = readers.find(child.get());
+      if(it != readers.end())
+        it->second++;
+    }
+
+  std::unordered_set<NodePtr> backward;
+  for(auto& v : nodesBackward)
+    backward.insert(v.get());
+
+  // the last node of a chain comes after all nodes folded into it
+  std::unordered_set<NodePtr> folded;
+  ChainBuilder chain(readers, backward);
+  for(auto it = nodesForward.rbegin(); it != nodesForward.rend(); ++it) {
+    const Expr& v = *it;
+    if(folded.count(v.get()) || v->elementOp().code == ElementCode::None)
+      continue;
+    if(v->val() || !chain.build(v))
+      continue;
+
+    folded.insert(chain.folded.begin(), chain.folded.end());
+    v->fuse(chain.program(), chain.inputs);
+  }
+
+  if(folded.empty())
+    return 0;
+
+  auto isFolded = [&folded](const Expr& v) { return folded.count(v.get()); };
+  nodesForward.remove_if(isFolded);
+  nodesBackward.remove_if(isFolded);
+  return folded.size();
+}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <list>
+
+#include "common/definitions.h"
+#include "graph/chainable.h"
+
+namespace marian {
+
+/**
+ * @brief Folds chains of element-wise nodes on the forward tape into the
+ * last node of each chain.
+ *
+ * A node is folded into the node consuming it if both are element-wise (see
+ * Chainable::elementOp), both have the same shape, the consumer is its only
+ * reader and nothing outside the tape holds a reference to it, so its value
+ * is never observed. The consumer then reads the inputs of the whole chain,
+ * which have its shape or are broadcast to it like a bias, and evaluates it
+ * with FusedElement and FusedElementGrad. Folded nodes are removed from both
+ * tapes and never get tensors. A chain is only given up if it needs more
+ * inputs or instructions than an ElementProgram holds.
+ *
+ * @return the number of nodes removed from the forward tape
+ */
+size_t fuseElementwise(std::list<Expr>& nodesForward,
+                       std::list<Expr>& nodesBackward);
+}
@@ -0,0 +1,226 @@
+#include "graph/health_monitor.h"
+
+#include <fstream>
+#include <limits>
+#include <unordered_set>
+
+#include "common/logging.h"
+#include "kernels/stats.h"
+#include "kernels/stats_cpu.h"
+#include "tensors/tensor.h"
+
+namespace marian {
+
+namespace {
+
+// Combines statistics of several tensors, the mean is over finite values
+HealthMonitor::Stats merge(const std::string& name,
+                           const std::vector<HealthMonitor::Stats>& stats,
+                           size_t begin,
+                           size_t end) {
+  HealthMonitor::Stats all;
+  all.name = name;
+  all.min = std::numeric_limits<float>::max();
+  all.max = std::numeric_limits<float>::lowest();
+  double sum = 0;
+  size_t finite = 0;
+  for(size_t i = begin; i < end; ++i) {
+    auto& s = stats[i];
+    size_t n = s.elements - s.nans - s.infs;
+    if(n > 0) {
+      all.min = std::min(all.min, s.min);
+      all.max = std::max(all.max, s.max);
+      sum += (double)s.mean * n;
+      finite += n;
+    }
+    all.elements += s.elements;
+    all.nans += s.nans;
+    all.infs += s.infs;
+  }
+  if(finite == 0)
+    all.min = all.max = 0;
+  all.mean = finite ? sum / finite : 0;
+  return all;
+}
+
+// Statistics of a tensor of size elements from the output of ValueStats
+HealthMonitor::Stats fromValueStats(const std::string& name,
+                                    size_t size,
+                                    const float* values) {
+  HealthMonitor::Stats stats;
+  stats.name = name;
+  stats.elements = size;
+  stats.nans = values[STAT_NANS];
+  stats.infs = values[STAT_INFS];
+  size_t finite = size - stats.nans - stats.infs;
+  stats.min = finite ? values[STAT_MIN] : 0;
+  stats.max = finite ? values[STAT_MAX] : 0;
+  stats.mean = finite ? values[STAT_SUM] / finite : 0;
+  return stats;
+}
+}
+
+HealthMonitor::Stats HealthMonitor::compute(const std::string& name,
+                                            const float* data,
+                                            size_t size) {
+  float stats[VALUE_STATS];
+  cpu::valueStats(data, size, stats);
+  return fromValueStats(name, size, stats);
+}
+
+void HealthMonitor::capture(const std::list<Expr>& nodes) {
+  tape_.clear();
+  if(dumpPrefix_.empty())
+    return;
+  for(auto& node : nodes) {
+    NodeInfo info{node.get(), {}, node->graphviz()};
+    for(auto& child : node->children())
+      info.children.push_back(child.get());
+    tape_.push_back(std::move(info));
+  }
+}
+
+void HealthMonitor::sample(const std::vector<Expr>& params,
+                           Tensor vals,
+                           Tensor grads,
+                           const std::vector<Expr>& tops) {
+  auto groups = std::make_shared<std::vector<Group>>();
+
+  // one call per group, only the statistics are copied from the device
+  auto group = [&](Tensor all, bool gradient) {
+    groups->push_back({gradient ? "gradients" : "values", {}, {}});
+    std::vector<size_t> slices;
+    for(auto& p : params) {
+      Tensor t = gradient ? p->grad() : p->val();
+      slices.push_back(t->data() - all->data());
+      slices.push_back(t->size());
+      groups->back().slices.push_back(
+          {gradient ? p->name() + ".grad" : p->name(), t->size(), p.get()});
+    }
+    ValueStats(groups->back().stats, all, slices);
+  };
+
+  if(vals && !params.empty())
+    group(vals, false);
+  if(grads && !params.empty())
+    group(grads, true);
+
+  groups->push_back({"top", {}, {}});
+  auto& stats = groups->back().stats;
+  for(auto& top : tops) {
+    if(!top->val())
+      continue;
+    std::vector<float> values;
+    ValueStats(values, top->val(), {0, top->val()->size()});
+    groups->back().slices.push_back(
+        {"top:" + top->type(), top->val()->size(), top.get()});
+    stats.insert(stats.end(), values.begin(), values.end());
+  }
+
+  // the worker handles samples in order
+  size_t step = steps_;
+  auto tape = std::make_shared<std::vector<NodeInfo>>(std::move(tape_));
+  tape_.clear();
+  pending_ = worker_.enqueue([this, step, groups, tape] {
+    process(step, *groups, *tape);
+  });
+}
+
+void HealthMonitor::process(size_t step,
+                            const std::vector<Group>& groups,
+                            const std::vector<NodeInfo>& tape) {
+  Sample sample{step, {}};
+  std::vector<const void*> bad;
+  std::string summary;
+  for(auto& group : groups) {
+    size_t begin = sample.stats.size();
+    for(size_t i = 0; i < group.slices.size(); ++i) {
+      auto& slice = group.slices[i];
+      auto stats = fromValueStats(
+          slice.name, slice.size, group.stats.data() + i * VALUE_STATS);
+      if(stats.anomaly()) {
+        LOG(health)->warn("Device {} step {}: {} has {} NaNs and {} "
+                          "infinities in {} values",
+                          device_,
+                          step,
+                          stats.name,
+                          stats.nans,
+                          stats.infs,
+                          stats.elements);
+        bad.push_back(slice.node);
+      }
+      sample.stats.push_back(stats);
+    }
+
+    if(sample.stats.size() > begin) {
+      auto all = merge(group.name, sample.stats, begin, sample.stats.size());
+      summary += fmt::format(", {} [{:.4g}, {:.4g}] mean {:.4g}",
+                             all.name,
+                             all.min,
+                             all.max,
+                             all.mean);
+    }
+  }
+  LOG(health)->info("Device {} step {}: {} tensors with NaNs or infinities{}",
+                    device_,
+                    step,
+                    bad.size(),
+                    summary);
+
+  if(!bad.empty() && !tape.empty())
+    dump(step, bad, tape);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  anomalies_ += bad.size();
+  samples_.push_back(std::move(sample));
+  while(samples_.size() > capacity_)
+    samples_.pop_front();
+}
+
+void HealthMonitor::dump(size_t step,
+                         const std::vector<const void*>& bad,
+                         const std::vector<NodeInfo>& tape) {
+  // the bad nodes, the nodes reading them and the inputs of those
+  std::unordered_set<const void*> keep(bad.begin(), bad.end());
+  std::unordered_set<const void*> readers;
+  for(auto& info : tape)
+    for(auto child : info.children)
+      if(keep.count(child))
+        readers.insert(info.node);
+  for(auto& info : tape)
+    if(readers.count(info.node)) {
+      keep.insert(info.node);
+      keep.insert(info.children.begin(), info.children.end());
+    }
+
+  std::string fileName = dumpPrefix_ + "." + std::to_string(device_) + "."
+                         + std::to_string(step) + ".dot";
+  std::ofstream out(fileName);
+  out << "digraph ExpressionGraph {" << std::endl;
+  out << "rankdir=LR" << std::endl;
+  for(auto& info : tape)
+    if(keep.count(info.node))
+      out << info.dot;
+  out << "}" << std::endl;
+  LOG(health)->warn("Device {} step {}: nodes around the bad tensors written "
+                    "to {}",
+                    device_,
+                    step,
+                    fileName);
+}
+
+void HealthMonitor::flush() {
+  if(pending_.valid())
+    pending_.get();
+}
+
+std::vector<HealthMonitor::Sample> HealthMonitor::samples() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::vector<Sample>(samples_.begin(), samples_.end());
+}
+
+size_t HealthMonitor::anomalies() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return anomalies_;
+}
+}
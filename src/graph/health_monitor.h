@@ -0,0 +1,135 @@
+#pragma once
+
+#include <deque>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "3rd_party/threadpool.h"
+#include "common/definitions.h"
+#include "graph/chainable.h"
+
+namespace marian {
+
+/**
+ * @brief Samples value statistics of selected tensors of a graph every N
+ * steps, as a cheap replacement for checking every node for NaNs.
+ *
+ * On a sampled step minimum, maximum, sum and the counts of NaNs and
+ * infinities of every watched tensor are computed on its device with one
+ * ValueStats call per group, see kernels/stats.h, and only these statistics
+ * are copied to the host. Logging and dumps are left to a worker thread. The
+ * last samples are kept in a ring buffer and summarized in the "health" log. Tensors holding NaNs or infinities are logged as
+ * warnings and, if a dump prefix is given, the nodes around them are written
+ * to prefix.device.step.dot in graphviz notation.
+ */
+class HealthMonitor {
+public:
+  struct Stats {
+    std::string name;
+    size_t elements{0};
+    float min{0};
+    float max{0};
+    float mean{0};
+    size_t nans{0};
+    size_t infs{0};
+
+    bool anomaly() const { return nans > 0 || infs > 0; }
+  };
+
+  struct Sample {
+    size_t step;
+    std::vector<Stats> stats;
+  };
+
+  /** @brief Statistics of the finite values of data[0, size) */
+  static Stats compute(const std::string& name, const float* data, size_t size);
+
+private:
+  // a watched tensor
+  struct Slice {
+    std::string name;
+    size_t size;
+    const void* node;
+  };
+
+  // tensors summarized together, VALUE_STATS floats per slice
+  struct Group {
+    std::string name;
+    std::vector<float> stats;
+    std::vector<Slice> slices;
+  };
+
+  // a node of the tape, kept to dump the neighbourhood of a bad tensor
+  struct NodeInfo {
+    const void* node;
+    std::vector<const void*> children;
+    std::string dot;
+  };
+
+  size_t device_;
+  size_t every_;
+  size_t capacity_;
+  std::string dumpPrefix_;
+
+  size_t steps_{0};
+  std::vector<NodeInfo> tape_;
+
+  std::mutex mutex_;
+  std::deque<Sample> samples_;
+  size_t anomalies_{0};
+
+  ThreadPool worker_{1};
+  std::future<void> pending_;
+
+  void process(size_t step,
+               const std::vector<Group>& groups,
+               const std::vector<NodeInfo>& tape);
+
+  void dump(size_t step,
+            const std::vector<const void*>& bad,
+            const std::vector<NodeInfo>& tape);
+
+public:
+  HealthMonitor(size_t device,
+                size_t every,
+                const std::string& dumpPrefix = "",
+                size_t capacity = 16)
+      : device_(device),
+        every_(every),
+        capacity_(capacity),
+        dumpPrefix_(dumpPrefix) {}
+
+  ~HealthMonitor() { flush(); }
+
+  /** @brief Counts a step, true if it is sampled */
+  bool due() { return every_ > 0 && ++steps_ % every_ == 0; }
+
+  /**
+   * @brief Remembers the structure of the tape of a sampled step for dumps,
+   * called before the backward pass consumes it
+   */
+  void capture(const std::list<Expr>& nodes);
+
+  /**
+   * @brief Samples the parameter values and gradients and the values of the
+   * top nodes, params is the graph's parameter list with its contiguous
+   * value and gradient memory
+   */
+  void sample(const std::vector<Expr>& params,
+              Tensor vals,
+              Tensor grads,
+              const std::vector<Expr>& tops);
+
+  /** @brief Waits for the statistics of the last sample */
+  void flush();
+
+  /** @brief The last samples, oldest first */
+  std::vector<Sample> samples();
+
+  /** @brief Number of tensors with NaNs or infinities seen so far */
+  size_t anomalies();
+};
+}
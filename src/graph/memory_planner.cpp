@@ -0,0 +1,358 @@
+#include "graph/memory_planner.h"
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <set>
+
+namespace marian {
+
+namespace {
+
+// Best-fit placement of byte ranges in a growing arena, used to simulate
+// the allocation sequence of one forward/backward pass.
+class OffsetAllocator {
+private:
+  size_t top_{0};
+  std::set<std::pair<size_t, size_t>> bySize_;
+  std::map<size_t, size_t> byOffset_;
+
+  void add(size_t offset, size_t bytes) {
+    bySize_.insert({bytes, offset});
+    byOffset_[offset] = bytes;
+  }
+
+  void remove(size_t offset, size_t bytes) {
+    bySize_.erase({bytes, offset});
+    byOffset_.erase(offset);
+  }
+
+public:
+  size_t alloc(size_t bytes) {
+    auto it = bySize_.lower_bound({bytes, 0});
+    if(it != bySize_.end()) {
+      size_t offset = it->second;
+      size_t size = it->first;
+      remove(offset, size);
+      if(size > bytes)
+        add(offset + bytes, size - bytes);
+      return offset;
+    }
+
+    // extend a gap at the end of the arena instead of leaving it unused
+    if(!byOffset_.empty()) {
+      auto last = std::prev(byOffset_.end());
+      if(last->first + last->second == top_) {
+        size_t offset = last->first;
+        remove(last->first, last->second);
+        top_ = offset + bytes;
+        return offset;
+      }
+    }
+
+    size_t offset = top_;
+    top_ += bytes;
+    return offset;
+  }
+
+  void free(size_t offset, size_t bytes) {
+    auto next = byOffset_.lower_bound(offset);
+    if(next != byOffset_.end() && next->first == offset + bytes) {
+      bytes += next->second;
+      remove(next->first, next->second);
+    }
+    auto prev = byOffset_.lower_bound(offset);
+    if(prev != byOffset_.begin()) {
+      --prev;
+      if(prev->first + prev->second == offset) {
+        offset = prev->first;
+        bytes += prev->second;
+        remove(prev->first, prev->second);
+      }
+    }
+    add(offset, bytes);
+  }
+
+  size_t size() { return top_; }
+};
+
+struct Lifetime {
+  size_t birth;
+  size_t death;
+  size_t bytes;
+  size_t* offset;
+};
+}
+
+MemoryPlanner::Signature MemoryPlanner::signature(
+    const std::list<Expr>& nodesForward,
+    const std::list<Expr>& nodesBackward,
+    const std::unordered_set<Expr>& topNodes) {
+  std::unordered_map<Chainable<Tensor>*, size_t> positions;
+  Signature sig = {nodesForward.size(), nodesBackward.size()};
+
+  size_t i = 0;
+  for(auto& v : nodesForward) {
+    positions[v.get()] = i;
+    auto type = types_.emplace(v->type(), types_.size()).first;
+    sig.push_back(type->second);
+    sig.push_back(v->shape().size());
+    for(auto d : v->shape())
+      sig.push_back(d);
+    sig.push_back(v->trainable());
+    sig.push_back((bool)v->viewOf());
+    sig.push_back(v->viewOf() ? false : (bool)v->val());
+    sig.push_back(topNodes.count(v));
+
+    sig.push_back(v->children().size());
+    for(auto& c : v->children()) {
+      auto it = positions.find(c.get());
+      if(it != positions.end()) {
+        sig.push_back(i - it->second);
+      } else {
+        // nodes computed by an earlier pass, only their shape matters
+        sig.push_back((size_t)-1);
+        sig.push_back(c->shape().size());
+        for(auto d : c->shape())
+          sig.push_back(d);
+      }
+    }
+    ++i;
+  }
+
+  for(auto& v : nodesBackward) {
+    auto it = positions.find(v.get());
+    sig.push_back(it != positions.end() ? it->second : (size_t)-1);
+  }
+
+  return sig;
+}
+
+Ptr<MemoryPlan> MemoryPlanner::plan(const std::list<Expr>& nodesForward,
+                                    const std::list<Expr>& nodesBackward,
+                                    const std::unordered_set<Expr>& topNodes,
+                                    Ptr<TensorAllocator> tensors) {
+  const size_t npos = MemoryPlan::npos;
+
+  size_t steps = nodesForward.size();
+  std::vector<Expr> tape(nodesForward.begin(), nodesForward.end());
+
+  auto plan = New<MemoryPlan>();
+  plan->valOffsets.resize(steps, npos);
+  plan->adjOffsets.resize(steps, npos);
+
+  std::vector<size_t> valDeath(steps, 0);
+  std::vector<bool> consumed(steps, false);
+  std::vector<size_t> adjBirth(steps, npos);
+  std::vector<size_t> adjDeath(steps, 0);
+
+  auto position = [this](Expr node) -> size_t {
+    auto it = index_.find(node->memoryOwner().get());
+    return it != index_.end() ? it->second : npos;
+  };
+
+  for(size_t i = 0; i < steps; ++i) {
+    valDeath[i] = i;
+    for(auto& c : tape[i]->children()) {
+      size_t j = position(c);
+      if(j != npos) {
+        valDeath[j] = std::max(valDeath[j], i);
+        consumed[j] = true;
+      }
+    }
+  }
+
+  // backward lifetimes are only known if the whole backward tape is covered
+  // by this forward pass
+  bool backward = !nodesBackward.empty()
+                  && std::all_of(nodesBackward.begin(),
+                                 nodesBackward.end(),
+                                 [&](Expr v) { return position(v) != npos; });
+
+  size_t end = steps;
+  if(backward) {
+    size_t step = steps;
+    for(auto& v : topNodes) {
+      size_t j = position(v);
+      if(j != npos && adjBirth[j] == npos)
+        adjBirth[j] = step;
+    }
+
+    for(auto it = nodesBackward.rbegin(); it != nodesBackward.rend(); ++it) {
+      auto v = *it;
+      for(auto& c : v->children()) {
+        size_t j = position(c);
+        if(j == npos)
+          continue;
+        if(c->trainable() && adjBirth[j] == npos)
+          adjBirth[j] = step;
+        if(v->trainable())
+          valDeath[j] = std::max(valDeath[j], step);
+      }
+      if(v->trainable()) {
+        size_t j = position(v);
+        valDeath[j] = std::max(valDeath[j], step);
+        adjDeath[j] = std::max(adjDeath[j], step);
+      }
+      ++step;
+    }
+    end = step;
+  }
+
+  std::vector<Lifetime> lifetimes;
+  for(size_t i = 0; i < steps; ++i) {
+    auto v = tape[i];
+    if(v->viewOf() || v->val() || v->type() == "param")
+      continue;
+
+    // values without consumers or of forward-only graphs are results
+    // the caller may read, keep them until the graph is cleared
+    size_t death = valDeath[i];
+    if(!backward || !consumed[i] || topNodes.count(v)
+       || v->marked_for_debug())
+      death = end;
+
+    lifetimes.push_back({i, death, tensors->capacity(v->shape()),
+                         &plan->valOffsets[i]});
+
+    if(backward && adjBirth[i] != npos && !v->grad())
+      lifetimes.push_back({adjBirth[i], std::max(adjBirth[i], adjDeath[i]),
+                           tensors->capacity(v->shape()),
+                           &plan->adjOffsets[i]});
+  }
+
+  std::stable_sort(
+      lifetimes.begin(), lifetimes.end(), [](const Lifetime& a,
+                                             const Lifetime& b) {
+        return a.birth < b.birth;
+      });
+
+  auto later = [](const Lifetime* a, const Lifetime* b) {
+    return a->death > b->death;
+  };
+  std::priority_queue<Lifetime*, std::vector<Lifetime*>, decltype(later)>
+      live(later);
+
+  OffsetAllocator arena;
+  for(auto& l : lifetimes) {
+    while(!live.empty() && live.top()->death < l.birth) {
+      arena.free(*live.top()->offset, live.top()->bytes);
+      live.pop();
+    }
+    *l.offset = arena.alloc(l.bytes);
+    live.push(&l);
+  }
+
+  plan->bytes = arena.size();
+  return plan;
+}
+
+void MemoryPlanner::prepare(const std::list<Expr>& nodesForward,
+                            const std::list<Expr>& nodesBackward,
+                            const std::unordered_set<Expr>& topNodes,
+                            Ptr<TensorAllocator> tensors) {
+  current_.reset();
+  index_.clear();
+
+  if(nodesForward.empty())
+    return;
+
+  size_t i = 0;
+  for(auto& v : nodesForward)
+    index_[v.get()] = i++;
+
+  auto key = signature(nodesForward, nodesBackward, topNodes);
+  Ptr<MemoryPlan> plan;
+  auto it = plans_.find(key);
+  if(it != plans_.end()) {
+    plan = it->second;
+    hits_++;
+  } else {
+    plan = this->plan(nodesForward, nodesBackward, topNodes, tensors);
+    if(plans_.size() >= MAX_PLANS)
+      plans_.clear();
+    plans_[key] = plan;
+    misses_++;
+  }
+
+  if(plan->bytes == 0)
+    return;
+
+  Tensor arena;
+  tensors->allocate(
+      arena, {1, (int)(plan->bytes / sizeof(float))}, "memory_plan");
+  // growing the workspace for the new arena may have moved the older ones
+  relocate();
+  arenas_.push_back({arena, arena->memory()->data(), {}});
+  current_ = plan;
+}
+
+Tensor MemoryPlanner::slice(size_t offset, const Shape& shape) {
+  auto& arena = arenas_.back();
+  auto mem = NewPooled<MemoryPiece>(arena.data + offset,
+                                    shape.elements() * sizeof(float));
+  arena.slices.push_back({mem, offset});
+  return NewPooled<TensorBase>(mem,
+                               shape,
+                               arena.tensor->getDevice(),
+                               arena.tensor->getDeviceType());
+}
+
+void MemoryPlanner::bindValue(Expr node) {
+  if(!current_ || node->viewOf() || node->val())
+    return;
+  auto it = index_.find(node.get());
+  if(it == index_.end())
+    return;
+  size_t offset = current_->valOffsets[it->second];
+  if(offset != MemoryPlan::npos)
+    node->val() = slice(offset, node->shape());
+}
+
+void MemoryPlanner::bindGradient(Expr node, float init) {
+  if(!current_)
+    return;
+  node = node->memoryOwner();
+  if(node->grad())
+    return;
+  auto it = index_.find(node.get());
+  if(it == index_.end())
+    return;
+  size_t offset = current_->adjOffsets[it->second];
+  if(offset != MemoryPlan::npos) {
+    node->grad() = slice(offset, node->shape());
+    node->grad()->set(init);
+  }
+}
+
+bool MemoryPlanner::owns(Tensor t) {
+  if(!t || !t->memory())
+    return false;
+  uint8_t* ptr = t->memory()->data();
+  for(auto& arena : arenas_) {
+    uint8_t* begin = arena.tensor->memory()->data();
+    if(ptr >= begin && ptr < begin + arena.tensor->memory()->size())
+      return true;
+  }
+  return false;
+}
+
+void MemoryPlanner::relocate() {
+  // the allocator updates the memory of the arena itself, not of the
+  // slices pointing into it
+  for(auto& arena : arenas_) {
+    uint8_t* data = arena.tensor->memory()->data();
+    if(data == arena.data)
+      continue;
+    for(auto& slice : arena.slices)
+      slice.first->setPtr(data + slice.second);
+    arena.data = data;
+  }
+}
+
+void MemoryPlanner::clear() {
+  current_.reset();
+  arenas_.clear();
+  index_.clear();
+}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include "common/definitions.h"
+#include "graph/chainable.h"
+#include "tensors/tensor_allocator.h"
+
+namespace marian {
+
+/**
+ * @brief Fixed workspace layout for one tape of an expression graph.
+ *
+ * Offsets are in bytes relative to the start of a single arena allocated
+ * from the workspace; tensors that are never live at the same time share
+ * memory. Entries are indexed by position in the forward tape, npos marks
+ * tensors that are not planned and go through the allocator as usual.
+ */
+struct MemoryPlan {
+  static const size_t npos = (size_t)-1;
+
+  size_t bytes{0};
+  std::vector<size_t> valOffsets;
+  std::vector<size_t> adjOffsets;
+};
+
+/**
+ * @brief Plans and applies static workspace layouts for the forward and
+ * backward pass of an expression graph.
+ *
+ * Lifetimes are derived from the tape: a value lives from the forward step of
+ * its node to the last step that reads it (forward steps of its consumers and,
+ * when training, backward steps of its consumers and of the node itself); an
+ * adjoint lives from the backward step that first accumulates into it to the
+ * backward step of its node. Values of nodes without consumers in the tape
+ * and all values of forward-only graphs live until the graph is cleared, so
+ * they can still be read by the caller.
+ *
+ * Plans are cached by a signature of the tape (node types, shapes and
+ * connectivity) which is identical for batches with identical shapes. The
+ * full signature is kept with the plan and compared on lookup.
+ */
+class MemoryPlanner {
+private:
+  const size_t MAX_PLANS = 256;
+
+  typedef std::vector<size_t> Signature;
+
+  std::unordered_map<Signature, Ptr<MemoryPlan>, boost::hash<Signature>>
+      plans_;
+  // node types are numbered in order of appearance for signatures
+  std::unordered_map<std::string, size_t> types_;
+
+  // an arena and the tensors placed in it, which have to move along with it
+  // when the workspace is reallocated
+  struct Arena {
+    Tensor tensor;
+    uint8_t* data;
+    std::vector<std::pair<Ptr<MemoryPiece>, size_t>> slices;
+  };
+
+  Ptr<MemoryPlan> current_;
+  std::unordered_map<Chainable<Tensor>*, size_t> index_;
+  std::vector<Arena> arenas_;
+
+  size_t hits_{0};
+  size_t misses_{0};
+
+  Signature signature(const std::list<Expr>& nodesForward,
+                      const std::list<Expr>& nodesBackward,
+                      const std::unordered_set<Expr>& topNodes);
+
+  Ptr<MemoryPlan> plan(const std::list<Expr>& nodesForward,
+                       const std::list<Expr>& nodesBackward,
+                       const std::unordered_set<Expr>& topNodes,
+                       Ptr<TensorAllocator> tensors);
+
+  Tensor slice(size_t offset, const Shape& shape);
+
+public:
+  /**
+   * @brief Looks up or computes the plan for the current tape and allocates
+   * its arena from the workspace. Has to be called before the forward pass.
+   */
+  void prepare(const std::list<Expr>& nodesForward,
+               const std::list<Expr>& nodesBackward,
+               const std::unordered_set<Expr>& topNodes,
+               Ptr<TensorAllocator> tensors);
+
+  /** @brief Binds the planned value tensor of a node, if any */
+  void bindValue(Expr node);
+
+  /**
+   * @brief Binds the planned adjoint tensor of a node (or the node it is a
+   * view of) and fills it with init, if any
+   */
+  void bindGradient(Expr node, float init);
+
+  /** @brief True if the tensor lives in one of the arenas of this planner */
+  bool owns(Tensor t);
+
+  /**
+   * @brief Moves the planned tensors along with their arenas, has to be
+   * called after allocations that may have reallocated the workspace
+   */
+  void relocate();
+
+  /** @brief Forgets arenas and per-pass state, cached plans are kept */
+  void clear();
+
+  size_t hits() { return hits_; }
+  size_t misses() { return misses_; }
+};
+}
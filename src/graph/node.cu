@@ -7,7 +7,7 @@ namespace marian {
 size_t Node::allocate() {
   size_t elements = 0;
   if(!val_) {
-    graph()->tensor(val_, shape_);
+    graph()->tensor(val_, shape_, type());
     elements = val_->shape().elements();
   }
   return elements;
@@ -24,14 +24,14 @@ void Node::free() {
 
 void Node::init_dependent() {
   if(!adj_) {
-    graph()->tensor(adj_, shape_);
+    graph()->tensor(adj_, shape_, type());
     adj_->set(1);
   }
 }
 
 void Node::set_zero_adjoint() {
   if(!adj_) {
-    graph()->tensor(adj_, shape_);
+    graph()->tensor(adj_, shape_, type());
     adj_->set(0);
   }
 }
@@ -44,6 +44,30 @@ Ptr<Backend> Node::getBackend() {
   return graph()->getBackend();
 }
 
+Ptr<cpu::QuantizedMatrix> Node::getQuantized(Expr weights, bool trans) {
+  return graph()->quantized(weights, trans);
+}
+
+Ptr<cpu::HalfMatrix> Node::getHalfPrecision(Expr weights, bool trans) {
+  return graph()->halfPrecision(weights, trans);
+}
+
+void Node::fusedForward() {
+  std::vector<Tensor> inputs;
+  for(auto&& child : children_)
+    inputs.push_back(child->val());
+  FusedElement(val_, inputs, *fused_);
+}
+
+void Node::fusedBackward() {
+  std::vector<Tensor> inputs, grads;
+  for(auto&& child : children_) {
+    inputs.push_back(child->val());
+    grads.push_back(child->trainable() ? child->grad() : nullptr);
+  }
+  FusedElementGrad(grads, adj_, inputs, *fused_);
+}
+
 void NaryNodeOp::remove_children_from_top_nodes() {
   for(auto child : children_)
     graph()->remove_top_node(child);
@@ -11,12 +11,18 @@
 
 namespace marian {
 
+namespace cpu {
+class QuantizedMatrix;
+class HalfMatrix;
+}
+
 class Node : public Chainable<Tensor>,
              public keywords::Keywords,
              public std::enable_shared_from_this<Node> {
 protected:
   size_t id_{0};
   size_t edges_{0};
+  bool persistent_{false};
   bool trainable_{true};
   bool destroy_{true};
   std::vector<Expr> children_;
@@ -31,6 +37,12 @@ protected:
   bool markedForDebug_{false};
   std::string debugMessage_;
 
+  // set if the node evaluates a chain of element-wise nodes folded into it
+  Ptr<ElementProgram> fused_;
+
+  void fusedForward();
+  void fusedBackward();
+
 public:
   template <typename... Args>
   Node(Ptr<ExpressionGraph> graph, Args... args)
@@ -61,9 +73,25 @@ public:
         op();
   }
 
-  virtual void forward() { runForward(forwardOps()); }
+  virtual void forward() {
+    if(fused_)
+      fusedForward();
+    else
+      runForward(forwardOps());
+  }
+
+  virtual void backward() {
+    if(fused_)
+      fusedBackward();
+    else
+      runBackward(backwardOps());
+  }
 
-  virtual void backward() { runBackward(backwardOps()); }
+  virtual void fuse(const ElementProgram& program,
+                    const std::vector<Expr>& inputs) {
+    fused_ = New<ElementProgram>(program);
+    children_ = inputs;
+  }
 
   virtual bool trainable() { return trainable_; }
 
@@ -77,6 +105,22 @@ public:
   virtual void decreaseEdges(size_t edges = 1) { edges_ -= edges; };
   virtual size_t edges() { return edges_; };
 
+  // a view is only kept if the node it shares memory with is kept
+  virtual void setPersistent(bool persistent) {
+    persistent_ = persistent;
+    if(viewOf())
+      viewOf()->setPersistent(persistent);
+  }
+
+  virtual bool persistent() { return persistent_; }
+
+  virtual Expr memoryOwner() {
+    Expr node = shared_from_this();
+    while(Expr viewed = node->viewOf())
+      node = viewed;
+    return node;
+  }
+
   virtual Ptr<ExpressionGraph> graph() { return graph_.lock(); }
 
   virtual void debug(const std::string& message) {
@@ -137,6 +181,18 @@ public:
   virtual Expr child(size_t i) { return children_[i]; }
 
   Ptr<Backend> getBackend();
+
+  /**
+   * @brief 8-bit weights for a product with weights, null unless the graph
+   * runs 8-bit integer inference on the CPU
+   */
+  Ptr<cpu::QuantizedMatrix> getQuantized(Expr weights, bool trans);
+
+  /**
+   * @brief 16-bit weights for a product with weights, null unless the graph
+   * stores parameters in half precision on the CPU
+   */
+  Ptr<cpu::HalfMatrix> getHalfPrecision(Expr weights, bool trans);
 };
 
 struct NaryNodeOp : public Node {
@@ -7,7 +7,7 @@ size_t ConstantNode::allocate() {
   // @TODO params
   size_t elements = 0;
   if(!val_) {
-    graph()->tensor(val_, shape_);
+    graph()->tensor(val_, shape_, type());
     elements = val_->shape().elements();
   }
   return elements;
@@ -24,7 +24,7 @@ size_t ParamNode::allocate() {
   // @TODO params
   size_t elements = 0;
   if(!val_) {
-    graph()->tensor(val_, shape_);
+    graph()->tensor(val_, shape_, type());
     elements = val_->shape().elements();
   }
   return elements;
@@ -38,6 +38,12 @@ struct ConstantNode : public Node {
     return this == node.get();
   }
 
+  // the constant is filled from the initializer of node on the next pass
+  virtual void rebind(Expr node) {
+    init_ = std::static_pointer_cast<ConstantNode>(node)->init_;
+    initialized_ = false;
+  }
+
 private:
   std::function<void(Tensor)> init_;
   bool initialized_;
@@ -4,6 +4,8 @@
 
 #include "graph/backend_gpu.h"
 #include "graph/node.h"
+#include "kernels/prod_half_cpu.h"
+#include "kernels/prod_int8_cpu.h"
 #include "kernels/tensor_operators.h"
 #include "kernels/thrust_functions.h"
 
@@ -59,8 +61,15 @@ public:
 
   NodeOps forwardOps() {
     // C = alpha * dot(op(A), op(B))
+    if(auto quantized = getQuantized(child(1), transB_))
+      return {NodeOp(cpu::ProdInt8(
+          val_, child(0)->val(), *quantized, transA_, 0.f, scalar_))};
+    if(auto half = getHalfPrecision(child(1), transB_))
+      return {NodeOp(cpu::ProdHalf(
+          val_, child(0)->val(), *half, transA_, 0.f, scalar_))};
+
     return {NodeOp(Prod(
-        std::static_pointer_cast<BackendGPU>(getBackend())->getCublasHandle(),
+        BackendGPU::getCublasHandle(getBackend()),
         val_,
         child(0)->val(),
         child(1)->val(),
@@ -76,8 +85,7 @@ public:
     // df/dB += alpha * dot(op(A).T, D)
     // beta set to 1.0 in gemm, C = alpha * dot(op(A), op(B)) + beta * C
     // to sum gradients from different graph parts
-    return {NodeOp(Prod(std::static_pointer_cast<BackendGPU>(getBackend())
-                            ->getCublasHandle(),
+    return {NodeOp(Prod(BackendGPU::getCublasHandle(getBackend()),
                         child(0)->grad(),
                         adj_,
                         child(1)->val(),
@@ -85,8 +93,7 @@ public:
                         !transB_,
                         1.0,
                         scalar_)),
-            NodeOp(Prod(std::static_pointer_cast<BackendGPU>(getBackend())
-                            ->getCublasHandle(),
+            NodeOp(Prod(BackendGPU::getCublasHandle(getBackend()),
                         child(1)->grad(),
                         child(0)->val(),
                         adj_,
@@ -138,7 +145,7 @@ public:
   NodeOps forwardOps() {
     // C = alpha * dot(op(A), op(B))
     return {NodeOp(ProdBatched(
-        std::static_pointer_cast<BackendGPU>(getBackend())->getCublasHandle(),
+        BackendGPU::getCublasHandle(getBackend()),
         val_,
         child(0)->val(),
         child(1)->val(),
@@ -154,8 +161,7 @@ public:
     // df/dB += alpha * dot(op(A).T, D)
     // beta set to 1.0 in gemm, C = alpha * dot(op(A), op(B)) + beta * C
     // to sum gradients from different graph parts
-    return {NodeOp(ProdBatched(std::static_pointer_cast<BackendGPU>(getBackend())
-                            ->getCublasHandle(),
+    return {NodeOp(ProdBatched(BackendGPU::getCublasHandle(getBackend()),
                         child(0)->grad(),
                         adj_,
                         child(1)->val(),
@@ -163,8 +169,7 @@ public:
                         !transB_,
                         1.0,
                         scalar_)),
-            NodeOp(ProdBatched(std::static_pointer_cast<BackendGPU>(getBackend())
-                            ->getCublasHandle(),
+            NodeOp(ProdBatched(BackendGPU::getCublasHandle(getBackend()),
                         child(1)->grad(),
                         child(0)->val(),
                         adj_,
@@ -250,6 +255,8 @@ struct PlusNodeOp : public ElementBinaryNodeOp {
             NodeOp(Add(_1, child(1)->grad(), adj_))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Add, 0.f}; }
+
   const std::string type() { return "+"; }
 };
 
@@ -267,6 +274,8 @@ struct MinusNodeOp : public ElementBinaryNodeOp {
             NodeOp(Add(-_1, child(1)->grad(), adj_))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Sub, 0.f}; }
+
   const std::string type() { return "-"; }
 };
 
@@ -284,6 +293,8 @@ struct MultNodeOp : public ElementBinaryNodeOp {
             NodeOp(Add(_1 * _2, child(1)->grad(), adj_, child(0)->val()))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Mul, 0.f}; }
+
   const std::string type() { return "×"; }
 };
 
@@ -306,6 +317,8 @@ struct DivNodeOp : public ElementBinaryNodeOp {
                    child(1)->val()))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Div, 0.f}; }
+
   const std::string type() { return "÷"; }
 };
 
@@ -370,6 +383,8 @@ struct ConcatenateNodeOp : public NaryNodeOp {
     Deconcatenate(deconcatenees, adj_, ax_);
   }
 
+  bool backwardReadsValues() { return false; }
+
   virtual size_t hash() {
     size_t seed = NaryNodeOp::hash();
     boost::hash_combine(seed, ax_);
@@ -448,9 +463,15 @@ struct AffineNodeOp : public NaryNodeOp {
   }
 
   NodeOps forwardOps() {
+    if(auto quantized = getQuantized(child(1), false))
+      return {NodeOp(cpu::ProdInt8(val_, child(0)->val(), *quantized, false);
+                     Add(_1, val_, child(2)->val());)};
+    if(auto half = getHalfPrecision(child(1), false))
+      return {NodeOp(cpu::ProdHalf(val_, child(0)->val(), *half, false);
+                     Add(_1, val_, child(2)->val());)};
+
     return {
-      NodeOp(Prod(std::static_pointer_cast<BackendGPU>(getBackend())
-                      ->getCublasHandle(),
+      NodeOp(Prod(BackendGPU::getCublasHandle(getBackend()),
                   val_,
                   child(0)->val(),
                   child(1)->val(),
@@ -467,16 +488,14 @@ struct AffineNodeOp : public NaryNodeOp {
     // beta set to 1.0 in gemm, C = dot(A,B) + beta * C
     // to sum gradients from different graph parts
 
-    return {NodeOp(Prod(std::static_pointer_cast<BackendGPU>(getBackend())
-                            ->getCublasHandle(),
+    return {NodeOp(Prod(BackendGPU::getCublasHandle(getBackend()),
                         child(0)->grad(),
                         adj_,
                         child(1)->val(),
                         false,
                         true,
                         1.0)),
-            NodeOp(Prod(std::static_pointer_cast<BackendGPU>(getBackend())
-                            ->getCublasHandle(),
+            NodeOp(Prod(BackendGPU::getCublasHandle(getBackend()),
                         child(1)->grad(),
                         child(0)->val(),
                         adj_,
@@ -46,6 +46,12 @@ public:
 
   NodeOps backwardOps() { return {NodeOp(Add(_1, child(0)->grad(), adj_))}; }
 
+  ElementOp elementOp() { return {ElementCode::AddScalar, scalar_}; }
+
+  void rebind(Expr node) {
+    scalar_ = std::static_pointer_cast<ScalarAddNodeOp>(node)->scalar_;
+  }
+
   const std::string type() { return "scalar_add"; }
 };
 
@@ -66,6 +72,12 @@ public:
     return {NodeOp(Add(scalar_ * _1, child(0)->grad(), adj_))};
   }
 
+  ElementOp elementOp() { return {ElementCode::MulScalar, scalar_}; }
+
+  void rebind(Expr node) {
+    scalar_ = std::static_pointer_cast<ScalarMultNodeOp>(node)->scalar_;
+  }
+
   const std::string type() { return "scalar_add"; }
 };
 
@@ -81,6 +93,8 @@ struct LogitNodeOp : public UnaryNodeOp {
     return {NodeOp(Add(_1 * _2 * (1.0f - _2), child(0)->grad(), adj_, val_))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Sigmoid, 0.f}; }
+
   const std::string type() { return "logit"; }
 };
 
@@ -139,6 +153,8 @@ struct TanhNodeOp : public NaryNodeOp {
 
   const std::string color() { return "yellow"; }
 
+  ElementOp elementOp() { return {ElementCode::Tanh, 0.f}; }
+
   const std::string type() { return "tanh"; }
 };
 
@@ -173,6 +189,8 @@ struct ReLUNodeOp : public UnaryNodeOp {
         Add(_1 * ReLUback(_2), child(0)->grad(), adj_, child(0)->val()))};
   }
 
+  ElementOp elementOp() { return {ElementCode::ReLU, 0.f}; }
+
   const std::string type() { return "ReLU"; }
 };
 
@@ -214,6 +232,11 @@ struct SoftmaxNodeOp : public NaryNodeOp {
     return true;
   }
 
+  void rebind(Expr node) {
+    mask_ = std::static_pointer_cast<SoftmaxNodeOp>(node)->mask_;
+    hash_ = 0;
+  }
+
   NodeOps backwardOps() {
     // For each row, the Jacobian times vector is given by:
     // J * dy = p .* (dy - avg*1)
@@ -374,6 +397,8 @@ struct LogNodeOp : public UnaryNodeOp {
         NodeOp(Add(_1 * (1.f / _2), child(0)->grad(), adj_, child(0)->val()))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Log, 0.f}; }
+
   const std::string type() { return "log"; }
 };
 
@@ -389,6 +414,8 @@ struct ExpNodeOp : public UnaryNodeOp {
     return {NodeOp(Add(_1 * Exp(_2), child(0)->grad(), adj_, child(0)->val()))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Exp, 0.f}; }
+
   const std::string type() { return "exp"; }
 };
 
@@ -407,6 +434,8 @@ struct SqrtNodeOp : public UnaryNodeOp {
     return {NodeOp(Add(0.5f * (1.f / _1) * _2, child(0)->grad(), val_, adj_))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Sqrt, epsilon_}; }
+
   const std::string type() { return "sqrt"; }
 
   virtual size_t hash() {
@@ -445,6 +474,8 @@ struct SquareNodeOp : public UnaryNodeOp {
         NodeOp(Add(2.f * _1 * _2, child(0)->grad(), child(0)->val(), adj_))};
   }
 
+  ElementOp elementOp() { return {ElementCode::Square, 0.f}; }
+
   const std::string type() { return "square"; }
 };
 
@@ -458,6 +489,8 @@ struct NegNodeOp : public UnaryNodeOp {
 
   NodeOps backwardOps() { return {NodeOp(Add(-_1, child(0)->grad(), adj_))}; }
 
+  ElementOp elementOp() { return {ElementCode::Neg, 0.f}; }
+
   const std::string type() { return "-"; }
 };
 
@@ -511,6 +544,11 @@ struct RowsNodeOp : public UnaryNodeOp {
     return true;
   }
 
+  void rebind(Expr node) {
+    indeces_ = std::static_pointer_cast<RowsNodeOp>(node)->indeces_;
+    hash_ = 0;
+  }
+
   std::vector<size_t> indeces_;
 };
 
@@ -562,6 +600,11 @@ struct ColsNodeOp : public UnaryNodeOp {
     return true;
   }
 
+  void rebind(Expr node) {
+    indeces_ = std::static_pointer_cast<ColsNodeOp>(node)->indeces_;
+    hash_ = 0;
+  }
+
   std::vector<size_t> indeces_;
 };
 
@@ -572,14 +615,14 @@ struct TransposeNodeOp : public UnaryNodeOp {
 
   NodeOps forwardOps() {
     return {NodeOp(Transpose(
-        std::static_pointer_cast<BackendGPU>(getBackend())->getCublasHandle(),
+        BackendGPU::getCublasHandle(getBackend()),
         val_,
         child(0)->val()))};
   }
 
   NodeOps backwardOps() {
     return {NodeOp(Transpose(
-        std::static_pointer_cast<BackendGPU>(getBackend())->getCublasHandle(),
+        BackendGPU::getCublasHandle(getBackend()),
         child(0)->grad(),
         adj_))};
   }
@@ -621,17 +664,23 @@ public:
 
   void set_zero_adjoint() { reshapee_->set_zero_adjoint(); }
 
+  Expr viewOf() { return reshapee_; }
+
   Tensor& val() {
     auto childVal = reshapee_->val();
-    val_.reset(
-        new TensorBase(childVal->memory(), shape(), childVal->getDevice()));
+    val_ = NewPooled<TensorBase>(childVal->memory(),
+                                   shape(),
+                                   childVal->getDevice(),
+                                   childVal->getDeviceType());
     return val_;
   };
 
   Tensor& grad() {
     auto childGrad = reshapee_->grad();
-    adj_.reset(
-        new TensorBase(childGrad->memory(), shape(), childGrad->getDevice()));
+    adj_ = NewPooled<TensorBase>(childGrad->memory(),
+                                   shape(),
+                                   childGrad->getDevice(),
+                                   childGrad->getDeviceType());
     return adj_;
   };
 
@@ -691,21 +740,25 @@ public:
 
   void set_zero_adjoint() { stepNode_->set_zero_adjoint(); }
 
+  Expr viewOf() { return stepNode_; }
+
   Tensor& val() {
     auto childVal = stepNode_->val();
     size_t offset = step_ * shape().elements() * sizeof(float);
-    auto mem = New<MemoryPiece>(childVal->memory()->data() + offset,
-                                childVal->memory()->size());
-    val_.reset(new TensorBase(mem, shape(), childVal->getDevice()));
+    auto mem = NewPooled<MemoryPiece>(childVal->memory()->data() + offset,
+                                      childVal->memory()->size());
+    val_ = NewPooled<TensorBase>(
+        mem, shape(), childVal->getDevice(), childVal->getDeviceType());
     return val_;
   };
 
   Tensor& grad() {
     auto childGrad = stepNode_->grad();
     size_t offset = step_ * shape().elements() * sizeof(float);
-    auto mem = New<MemoryPiece>(childGrad->memory()->data() + offset,
-                                childGrad->memory()->size());
-    adj_.reset(new TensorBase(mem, shape(), childGrad->getDevice()));
+    auto mem = NewPooled<MemoryPiece>(childGrad->memory()->data() + offset,
+                                      childGrad->memory()->size());
+    adj_ = NewPooled<TensorBase>(
+        mem, shape(), childGrad->getDevice(), childGrad->getDeviceType());
     return adj_;
   };
 
@@ -19,9 +19,9 @@ private:
   Ptr<TensorAllocator> grads_;
 
 public:
-  void init(size_t device) {
-    vals_ = New<TensorAllocator>(device);
-    grads_ = New<TensorAllocator>(device);
+  void init(size_t device, DeviceType type = DeviceType::gpu) {
+    vals_ = New<TensorAllocator>(device, type);
+    grads_ = New<TensorAllocator>(device, type);
   }
 
   auto begin() -> decltype(params_.begin()) { return params_.begin(); }
@@ -61,7 +61,7 @@ public:
       vals_->reserveExact(totalCapacity(vals_));
       for(auto p : params_)
         if(!p->val())
-          vals_->allocate(p->val(), p->shape());
+          vals_->allocate(p->val(), p->shape(), p->type());
     }
   }
 
@@ -70,7 +70,7 @@ public:
       grads_->reserveExact(totalCapacity(grads_));
       for(auto p : params_)
         if(!p->grad())
-          grads_->allocate(p->grad(), p->shape());
+          grads_->allocate(p->grad(), p->shape(), p->type());
     }
   }
 
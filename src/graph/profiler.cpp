@@ -0,0 +1,214 @@
+#include "graph/profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#include "common/logging.h"
+
+namespace marian {
+
+namespace {
+
+std::string escape(const std::string& s) {
+  std::string escaped;
+  for(char c : s) {
+    if(c == '"' || c == '\\')
+      escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+void logTable(const std::string& title,
+              const std::map<std::string, Profiler::Total>& totals,
+              double seconds,
+              size_t topN) {
+  typedef std::pair<std::string, Profiler::Total> Row;
+  std::vector<Row> rows(totals.begin(), totals.end());
+  std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+    return a.second.total() > b.second.total();
+  });
+  if(rows.size() > topN)
+    rows.resize(topN);
+
+  LOG(profile)->info("{:<32} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>6}",
+                     title,
+                     "forwards",
+                     "alloc ms",
+                     "init ms",
+                     "fwd ms",
+                     "bwd ms",
+                     "total ms",
+                     "%");
+  for(auto& row : rows) {
+    auto& t = row.second;
+    LOG(profile)->info(
+        "{:<32} {:>10} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} "
+        "{:>6.1f}",
+        row.first.empty() ? "(none)" : row.first,
+        t.calls[Profiler::Forward],
+        1000 * t.seconds[Profiler::Allocate],
+        1000 * t.seconds[Profiler::Init],
+        1000 * t.seconds[Profiler::Forward],
+        1000 * t.seconds[Profiler::Backward],
+        1000 * t.total(),
+        seconds > 0 ? 100 * t.total() / seconds : 0.);
+  }
+}
+}
+
+const size_t Profiler::MAX_EVENTS;
+
+double Profiler::Total::total() const {
+  double sum = 0;
+  for(int i = 0; i < PHASES; ++i)
+    sum += seconds[i];
+  return sum;
+}
+
+void Profiler::Total::add(const Total& other) {
+  for(int i = 0; i < PHASES; ++i) {
+    calls[i] += other.calls[i];
+    seconds[i] += other.seconds[i];
+  }
+}
+
+const char* Profiler::phaseName(Phase phase) {
+  switch(phase) {
+    case Allocate: return "allocate";
+    case Init: return "init";
+    case Forward: return "forward";
+    case Backward: return "backward";
+    default: return "unknown";
+  }
+}
+
+uint32_t Profiler::intern(const std::string& s) {
+  auto it = ids_.find(s);
+  if(it != ids_.end())
+    return it->second;
+  uint32_t id = strings_.size();
+  strings_.push_back(s);
+  ids_[s] = id;
+  return id;
+}
+
+uint32_t Profiler::scope(Expr node) {
+  auto it = scopes_.find(node.get());
+  if(it != scopes_.end())
+    return it->second;
+
+  uint32_t s = 0;
+  if(node->type() == "param") {
+    const std::string& name = node->name();
+    s = intern(name.substr(0, name.rfind('_')));
+  } else if(node->name() != "none") {
+    s = intern(node->name());
+  } else {
+    // a parameter read by the node decides, otherwise the child created last
+    Expr inherit;
+    for(auto& child : node->children()) {
+      if(child->type() == "param") {
+        inherit = child;
+        break;
+      }
+      if(!inherit || child->getId() > inherit->getId())
+        inherit = child;
+    }
+    if(inherit)
+      s = scope(inherit);
+  }
+
+  scopes_[node.get()] = s;
+  return s;
+}
+
+void Profiler::record(Expr node,
+                      Phase phase,
+                      Clock::time_point begin,
+                      Clock::time_point end) {
+  uint32_t type = intern(node->type());
+  uint32_t nodeScope = scope(node);
+  double seconds = std::chrono::duration<double>(end - begin).count();
+
+  auto& byType = byType_[strings_[type]];
+  byType.calls[phase]++;
+  byType.seconds[phase] += seconds;
+
+  auto& byScope = byScope_[strings_[nodeScope]];
+  byScope.calls[phase]++;
+  byScope.seconds[phase] += seconds;
+
+  if(events_.size() < MAX_EVENTS)
+    events_.push_back(
+        {type, nodeScope, phase, node->getId(), begin, end - begin});
+  else
+    dropped_++;
+}
+
+void Profiler::log(const std::vector<Ptr<Profiler>>& profilers, size_t topN) {
+  std::map<std::string, Total> types;
+  std::map<std::string, Total> scopes;
+  Total all;
+  size_t dropped = 0;
+  for(auto& p : profilers) {
+    for(auto& t : p->byType_) {
+      types[t.first].add(t.second);
+      all.add(t.second);
+    }
+    for(auto& s : p->byScope_)
+      scopes[s.first].add(s.second);
+    dropped += p->dropped_;
+  }
+
+  LOG(profile)->info(
+      "Profile of {} graph(s): allocate {:.2f}s, init {:.2f}s, forward "
+      "{:.2f}s, backward {:.2f}s",
+      profilers.size(),
+      all.seconds[Allocate],
+      all.seconds[Init],
+      all.seconds[Forward],
+      all.seconds[Backward]);
+  logTable("operation", types, all.total(), topN);
+  logTable("scope", scopes, all.total(), topN);
+
+  if(dropped)
+    LOG(profile)->info("{} steps were not kept for the trace, only the first "
+                       "{} per graph are",
+                       dropped,
+                       MAX_EVENTS);
+}
+
+void Profiler::writeTrace(const std::vector<Ptr<Profiler>>& profilers,
+                          std::ostream& out) {
+  Clock::time_point origin = Clock::time_point::max();
+  for(auto& p : profilers)
+    if(!p->events_.empty())
+      origin = std::min(origin, p->events_.front().begin);
+
+  auto micros = [](Clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+  };
+
+  out << std::fixed << std::setprecision(3);
+  out << "{\"traceEvents\": [";
+  bool first = true;
+  for(auto& p : profilers) {
+    out << (first ? "\n" : ",\n") << "{\"name\": \"process_name\", \"ph\": "
+        << "\"M\", \"pid\": " << p->device_ << ", \"args\": {\"name\": "
+        << "\"device " << p->device_ << "\"}}";
+    first = false;
+
+    for(auto& e : p->events_) {
+      out << ",\n{\"name\": \"" << escape(p->strings_[e.type])
+          << "\", \"cat\": \"" << phaseName(e.phase)
+          << "\", \"ph\": \"X\", \"pid\": " << p->device_
+          << ", \"tid\": 0, \"ts\": " << micros(e.begin - origin)
+          << ", \"dur\": " << micros(e.duration)
+          << ", \"args\": {\"scope\": \"" << escape(p->strings_[e.scope])
+          << "\", \"id\": " << e.id << "}}";
+    }
+  }
+  out << "\n]}" << std::endl;
+}
+}
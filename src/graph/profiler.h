@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/definitions.h"
+#include "graph/chainable.h"
+
+namespace marian {
+
+/**
+ * @brief Times the allocate, init, forward and backward steps of the nodes of
+ * an expression graph.
+ *
+ * Times are aggregated by node type and by parameter scope. The scope of a
+ * parameter is its name up to the last underscore (decoder_ff_logit_l2_W
+ * belongs to decoder_ff_logit_l2); other nodes take the scope of a parameter
+ * they read or, failing that, of their most recently created child. The first
+ * MAX_EVENTS steps are also kept as events for a Chrome trace.
+ *
+ * A profiler belongs to a single graph and is not thread-safe.
+ */
+class Profiler {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum Phase { Allocate, Init, Forward, Backward, PHASES };
+
+  struct Total {
+    size_t calls[PHASES] = {0};
+    double seconds[PHASES] = {0};
+
+    double total() const;
+    void add(const Total& other);
+  };
+
+  static const char* phaseName(Phase phase);
+
+private:
+  static const size_t MAX_EVENTS = 1 << 20;
+
+  struct Event {
+    uint32_t type;
+    uint32_t scope;
+    Phase phase;
+    size_t id;
+    Clock::time_point begin;
+    Clock::duration duration;
+  };
+
+  size_t device_;
+
+  std::vector<std::string> strings_;
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::unordered_map<Chainable<Tensor>*, uint32_t> scopes_;
+
+  std::map<std::string, Total> byType_;
+  std::map<std::string, Total> byScope_;
+
+  std::vector<Event> events_;
+  size_t dropped_{0};
+
+  uint32_t intern(const std::string& s);
+  uint32_t scope(Expr node);
+
+public:
+  Profiler(size_t device) : device_(device) { intern(""); }
+
+  /** @brief Adds one step of node that ran from begin to end */
+  void record(Expr node,
+              Phase phase,
+              Clock::time_point begin,
+              Clock::time_point end);
+
+  /**
+   * @brief Forgets the scopes of the nodes of the current graph, called when
+   * the graph is cleared and node addresses can be reused
+   */
+  void clear() { scopes_.clear(); }
+
+  size_t getDevice() { return device_; }
+
+  const std::map<std::string, Total>& byType() { return byType_; }
+  const std::map<std::string, Total>& byScope() { return byScope_; }
+
+  /**
+   * @brief Logs the topN most expensive node types and scopes summed over
+   * profilers
+   */
+  static void log(const std::vector<Ptr<Profiler>>& profilers, size_t topN);
+
+  /**
+   * @brief Writes the recorded events of profilers in Chrome trace_event
+   * format, one process per device
+   */
+  static void writeTrace(const std::vector<Ptr<Profiler>>& profilers,
+                         std::ostream& out);
+};
+}
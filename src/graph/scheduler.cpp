@@ -0,0 +1,199 @@
+#include "graph/scheduler.h"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+#include "3rd_party/exception.h"
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+
+Scheduler::Scheduler(bool deterministic)
+    : deterministic_(deterministic), workers_(cpu::numThreads() - 1) {}
+
+void Scheduler::runStep(Run& run, size_t i, const Step& step) {
+  bool executing = false;
+  try {
+    // adjoints are locked in index order, so steps cannot deadlock
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for(size_t a : run.locks[i])
+      locks.emplace_back(run.adjoints[a]);
+
+    Expr node;
+    node.swap(run.nodes[i]);
+    executing = true;
+    if(run.active++ > 0)
+      run.overlapped++;
+    step(node);
+    executing = false;
+    run.active--;
+  } catch(...) {
+    if(executing)
+      run.active--;
+    std::lock_guard<std::mutex> lock(run.mutex);
+    if(!run.error)
+      run.error = std::current_exception();
+  }
+}
+
+void Scheduler::complete(Run& run, size_t i) {
+  run.finished++;
+  run.running--;
+  for(size_t d : run.dependents[i])
+    if(--run.pending[d] == 0)
+      run.ready.push(d);
+  run.changed.notify_all();
+}
+
+void Scheduler::worker(Run& run, size_t i, const Step& step) {
+  bool& inside = cpu::insideParallelFor();
+  bool wasInside = inside;
+  inside = true;
+
+  // a worker follows the chain it is on as long as it has ready steps, the
+  // run may be gone once the last step has completed and the lock is dropped
+  for(;;) {
+    runStep(run, i, step);
+
+    std::lock_guard<std::mutex> lock(run.mutex);
+    complete(run, i);
+    if(run.error || run.ready.empty())
+      break;
+    i = run.ready.top();
+    run.ready.pop();
+    run.running++;
+  }
+
+  inside = wasInside;
+}
+
+void Scheduler::execute(Run& run, const Step& step) {
+  size_t n = run.nodes.size();
+  for(size_t i = 0; i < n; ++i)
+    if(run.pending[i] == 0)
+      run.ready.push(i);
+
+  std::unique_lock<std::mutex> lock(run.mutex);
+  for(;;) {
+    run.changed.wait(lock, [&] {
+      return run.running == 0 || (!run.error && !run.ready.empty());
+    });
+    if(run.error || run.ready.empty())
+      break;
+
+    size_t i = run.ready.top();
+    run.ready.pop();
+    run.running++;
+
+    // without workers the calling thread runs everything
+    std::vector<size_t> others;
+    while(!run.ready.empty() && cpu::numThreads() > 1) {
+      others.push_back(run.ready.top());
+      run.ready.pop();
+      run.running++;
+    }
+    lock.unlock();
+
+    for(size_t j : others)
+      workers_.enqueue([this, &run, &step, j] { worker(run, j, step); });
+    runStep(run, i, step);
+
+    lock.lock();
+    complete(run, i);
+  }
+
+  overlapped_ = run.overlapped;
+  if(run.error)
+    std::rethrow_exception(run.error);
+  UTIL_THROW_IF2(run.finished != n,
+                 "Scheduler ran " << run.finished << " of " << n
+                                  << " steps, the graph has a cycle");
+}
+
+void Scheduler::forward(std::list<Expr> nodesForward, const Step& step) {
+  Run run;
+  run.nodes.assign(std::make_move_iterator(nodesForward.begin()),
+                   std::make_move_iterator(nodesForward.end()));
+  nodesForward.clear();
+  size_t n = run.nodes.size();
+  run.dependents.resize(n);
+  run.pending.resize(n, 0);
+  run.locks.resize(n);
+
+  // children that are not on the tape have been computed before
+  std::unordered_map<Chainable<Tensor>*, size_t> index;
+  for(size_t i = 0; i < n; ++i) {
+    for(auto& child : run.nodes[i]->children()) {
+      auto it = index.find(child.get());
+      if(it != index.end()) {
+        run.dependents[it->second].push_back(i);
+        run.pending[i]++;
+      }
+    }
+    index[run.nodes[i].get()] = i;
+  }
+
+  execute(run, step);
+}
+
+void Scheduler::backward(const std::list<Expr>& nodesBackward,
+                         const Step& step) {
+  Run run;
+  run.nodes.assign(nodesBackward.rbegin(), nodesBackward.rend());
+  size_t n = run.nodes.size();
+  run.dependents.resize(n);
+  run.pending.resize(n, 0);
+  run.locks.resize(n);
+
+  auto dependOn = [&](size_t i, size_t on) {
+    run.dependents[on].push_back(i);
+    run.pending[i]++;
+  };
+
+  typedef Chainable<Tensor>* Key;
+  std::unordered_map<Key, size_t> lastWriter;
+  std::unordered_map<Key, std::vector<size_t>> writers;
+  std::unordered_map<Key, size_t> adjoints;
+
+  for(size_t i = 0; i < n; ++i) {
+    Key self = run.nodes[i]->memoryOwner().get();
+    if(deterministic_) {
+      auto it = lastWriter.find(self);
+      if(it != lastWriter.end())
+        dependOn(i, it->second);
+    } else {
+      for(size_t w : writers[self])
+        dependOn(i, w);
+    }
+
+    if(!run.nodes[i]->trainable())
+      continue;
+
+    for(auto& child : run.nodes[i]->children()) {
+      if(!child->trainable())
+        continue;
+      Key o = child->memoryOwner().get();
+      if(deterministic_) {
+        auto it = lastWriter.find(o);
+        if(it != lastWriter.end() && it->second != i)
+          dependOn(i, it->second);
+        lastWriter[o] = i;
+      } else {
+        auto& w = writers[o];
+        if(w.empty() || w.back() != i)
+          w.push_back(i);
+        auto a = adjoints.emplace(o, adjoints.size()).first;
+        run.locks[i].push_back(a->second);
+      }
+    }
+
+    auto& locks = run.locks[i];
+    std::sort(locks.begin(), locks.end());
+    locks.erase(std::unique(locks.begin(), locks.end()), locks.end());
+  }
+  run.adjoints = std::vector<std::mutex>(adjoints.size());
+
+  execute(run, step);
+}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "3rd_party/threadpool.h"
+#include "common/definitions.h"
+#include "graph/chainable.h"
+
+namespace marian {
+
+/**
+ * @brief Runs the forward and backward steps of the nodes of a host graph as
+ * a dependency graph, so that independent branches (the two directions of a
+ * bidirectional encoder, the encoders of a multi-source model, the scorers of
+ * an ensemble) overlap on the host thread pool.
+ *
+ * A forward step waits for the steps of its children. A backward step waits
+ * for the steps that write into its own adjoint and, if the scheduler is
+ * deterministic, for the previous writer of each adjoint it accumulates into,
+ * so gradients are summed in the same order as by the sequential backward
+ * pass and are bitwise identical. Otherwise writers of an adjoint only
+ * exclude each other and their order depends on timing. Adjoints and views
+ * are keyed by the node owning the memory.
+ *
+ * The calling thread follows the tape, running the earliest ready step
+ * itself, while other ready steps go to the scheduler's own workers, one
+ * fewer than cpu::numThreads(). Steps on workers do not split their kernels
+ * further, steps on the calling thread split them across cpu::threadPool(),
+ * which never waits for steps, so the chunks cannot queue behind steps
+ * waiting for adjoints. The scheduler drops its reference to a node once
+ * the node's step has run. Steps must not allocate from the graph, except
+ * through the graph's own (locked) allocator.
+ */
+class Scheduler {
+private:
+  typedef std::function<void(Expr)> Step;
+
+  bool deterministic_;
+  size_t overlapped_{0};
+  ThreadPool workers_;
+
+  // state of the current run
+  struct Run {
+    std::vector<Expr> nodes;
+    std::vector<std::vector<size_t>> dependents;
+    std::vector<size_t> pending;
+    // adjoints a backward step accumulates into, if not deterministic
+    std::vector<std::vector<size_t>> locks;
+    std::vector<std::mutex> adjoints;
+
+    // ready steps, earliest on the tape first
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>>
+        ready;
+    size_t finished{0};
+    size_t running{0};
+    std::exception_ptr error;
+
+    // steps executing right now and steps started while others executed
+    std::atomic<size_t> active{0};
+    std::atomic<size_t> overlapped{0};
+
+    std::mutex mutex;
+    std::condition_variable changed;
+  };
+
+  void runStep(Run& run, size_t i, const Step& step);
+  void complete(Run& run, size_t i);
+  void execute(Run& run, const Step& step);
+  void worker(Run& run, size_t i, const Step& step);
+
+public:
+  Scheduler(bool deterministic);
+
+  bool deterministic() { return deterministic_; }
+
+  /**
+   * @brief Number of steps of the last forward or backward run that started
+   * while another step was executing
+   */
+  size_t overlapped() { return overlapped_; }
+
+  /**
+   * @brief Runs step for the nodes of the forward tape, nodes that are only
+   * referenced by the tape are released once their step has run
+   */
+  void forward(std::list<Expr> nodesForward, const Step& step);
+
+  /** @brief Runs step for the nodes of the backward tape, last node first */
+  void backward(const std::list<Expr>& nodesBackward, const Step& step);
+};
+}
@@ -0,0 +1,127 @@
+#include "graph/tape_cache.h"
+
+#include <typeinfo>
+
+#include "3rd_party/exception.h"
+
+namespace marian {
+
+bool TapeCache::matches(Expr captured, Expr node) {
+  if(captured == node)
+    return true;
+  // rebind() relies on both nodes being of the same class
+  if(typeid(*captured) != typeid(*node) || captured->shape() != node->shape())
+    return false;
+  if(captured->children().size() != node->children().size())
+    return false;
+  for(size_t i = 0; i < captured->children().size(); ++i)
+    if(captured->children()[i] != node->children()[i])
+      return false;
+  return true;
+}
+
+void TapeCache::begin(size_t key) {
+  end();
+
+  for(auto it = tapes_.begin(); it != tapes_.end(); ++it) {
+    if((*it)->key == key) {
+      current_ = *it;
+      tapes_.erase(it);
+      break;
+    }
+  }
+
+  if(current_ && current_->complete) {
+    replaying_ = true;
+    hits_++;
+  } else {
+    current_ = New<Tape>();
+    current_->key = key;
+    capturing_ = true;
+    misses_++;
+  }
+  cursor_ = 0;
+
+  // the current tape goes to the front, the least recently used one is
+  // dropped if there are too many
+  tapes_.push_front(current_);
+  while(tapes_.size() > maxTapes_)
+    tapes_.pop_back();
+}
+
+void TapeCache::capture(Expr node, bool onTape) {
+  if(!capturing_)
+    return;
+
+  size_t slot;
+  auto it = slots_.find(node.get());
+  if(it != slots_.end()) {
+    slot = it->second;
+  } else {
+    slot = current_->nodes.size();
+    current_->nodes.push_back(node);
+    slots_[node.get()] = slot;
+  }
+  current_->steps.push_back({slot, onTape});
+}
+
+Expr TapeCache::replay(Expr node, bool& onTape) {
+  UTIL_THROW_IF2(cursor_ >= current_->steps.size(),
+                 "Graph build adds more nodes than the tape captured for its "
+                 "shape signature");
+
+  auto& step = current_->steps[cursor_];
+  Expr captured = current_->nodes[step.slot];
+
+  UTIL_THROW_IF2(!matches(captured, node),
+                 "Graph build does not match the tape captured for its shape "
+                 "signature: node "
+                     << cursor_ << " is " << node->type() << " "
+                     << node->shape() << ", captured " << captured->type()
+                     << " " << captured->shape());
+
+  // a duplicate is only a duplicate if it carries the same data
+  UTIL_THROW_IF2(!step.onTape && captured != node && !captured->equal(node),
+                 "Graph build does not match the tape captured for its shape "
+                 "signature: node "
+                     << cursor_ << " (" << node->type()
+                     << ") is no longer a duplicate");
+
+  if(step.onTape && captured != node)
+    captured->rebind(node);
+
+  onTape = step.onTape;
+  cursor_++;
+  return captured;
+}
+
+void TapeCache::finish() {
+  if(replaying_)
+    UTIL_THROW_IF2(cursor_ != current_->steps.size(),
+                   "Graph build adds fewer nodes than the tape captured for "
+                   "its shape signature");
+  if(capturing_)
+    current_->complete = true;
+
+  capturing_ = false;
+  replaying_ = false;
+  slots_.clear();
+}
+
+void TapeCache::end() {
+  // a capture that never reached a forward pass is incomplete
+  if(capturing_)
+    tapes_.remove(current_);
+
+  current_.reset();
+  capturing_ = false;
+  replaying_ = false;
+  cursor_ = 0;
+  slots_.clear();
+}
+
+void TapeCache::drop() {
+  tapes_.remove(current_);
+  end();
+}
+}
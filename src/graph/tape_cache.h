@@ -0,0 +1,112 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "common/definitions.h"
+#include "graph/chainable.h"
+
+namespace marian {
+
+/**
+ * @brief Captured build of an expression graph for one shape signature.
+ *
+ * Nodes are the distinct nodes the build put on the tape or returned from
+ * add(), in order of their first appearance; they keep their tensors between
+ * passes. Steps record, for every call of add(), which node was returned and
+ * whether it was appended to the tape or found as a duplicate.
+ */
+struct Tape {
+  struct Step {
+    size_t slot;
+    bool onTape;
+  };
+
+  size_t key{0};
+  bool complete{false};
+  std::vector<Expr> nodes;
+  std::vector<Step> steps;
+};
+
+/**
+ * @brief Captures and replays graph builds keyed by a shape signature.
+ *
+ * The first build for a key is captured as it is executed. Later builds for
+ * the same key still run the model code, but every node it creates is only a
+ * shadow: add() returns the captured node at the same position, after it has
+ * taken over the per-batch data of the shadow (constant initializers, row
+ * indices, masks) through rebind(). Hashing, allocation and tensor assignment
+ * are skipped and the captured nodes run on the tensors they were given in
+ * the first pass. A build that diverges from the captured tape is an error,
+ * the key has to determine the topology of the graph.
+ *
+ * At most maxTapes tapes are kept, the least recently used one is dropped
+ * together with its tensors.
+ */
+class TapeCache {
+private:
+  size_t maxTapes_;
+
+  std::list<Ptr<Tape>> tapes_;
+
+  Ptr<Tape> current_;
+  bool capturing_{false};
+  bool replaying_{false};
+  size_t cursor_{0};
+  std::unordered_map<Chainable<Tensor>*, size_t> slots_;
+
+  size_t hits_{0};
+  size_t misses_{0};
+
+  static bool matches(Expr captured, Expr node);
+
+public:
+  TapeCache(size_t maxTapes) : maxTapes_(maxTapes) {}
+
+  /**
+   * @brief Selects the tape for key, it is replayed if it has been captured
+   * before and captured by the following build otherwise
+   */
+  void begin(size_t key);
+
+  /**
+   * @brief Records the result of add() while capturing, onTape is false if
+   * node was found as a duplicate of an earlier node
+   */
+  void capture(Expr node, bool onTape);
+
+  /**
+   * @brief Returns the captured node for the next call of add() while
+   * replaying, rebound to the data of node
+   */
+  Expr replay(Expr node, bool& onTape);
+
+  /**
+   * @brief Ends capturing or replaying at the start of the forward pass,
+   * nodes added afterwards are not part of the tape
+   */
+  void finish();
+
+  /** @brief Detaches the current tape, captured tapes are kept */
+  void end();
+
+  /**
+   * @brief Detaches the current tape and drops it, its nodes free their
+   * tensors when they are destroyed
+   */
+  void drop();
+
+  bool capturing() { return capturing_; }
+  bool replaying() { return replaying_; }
+
+  /** @brief True if the nodes of the current build belong to a tape */
+  bool active() { return (bool)current_; }
+
+  /** @brief Number of kept tapes */
+  size_t size() { return tapes_.size(); }
+
+  size_t hits() { return hits_; }
+  size_t misses() { return misses_; }
+};
+}
@@ -0,0 +1,214 @@
+#include "kernels/attention_cpu.h"
+
+#include <algorithm>
+
+#include "kernels/math_cpu.h"
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+// Partial sums over the hidden dimension are kept in LANES independent
+// lanes, so that the reduction is vectorised
+const int LANES = 16;
+
+// Bytes of context (and coverage) rows scored by all beam entries of a
+// sentence before moving on, about half of a typical L2
+const int TILE_BYTES = 1 << 17;
+
+// Columns of the hidden dimension owned by one task in the backward pass
+const int HIDDEN_BLOCK = 64;
+
+// Every element evaluates a tanh, so tasks are split well below
+// MIN_ELEMENTS_PER_THREAD
+const int MIN_TANH_PER_THREAD = MIN_ELEMENTS_PER_THREAD / 8;
+
+template <bool withCoverage>
+float score(const float* __restrict__ context,
+            const float* __restrict__ state,
+            const float* __restrict__ coverage,
+            const float* __restrict__ va,
+            int k) {
+  float sum[LANES] = {};
+  int blocks = k / LANES;
+  for(int b = 0; b < blocks; ++b) {
+    int i0 = b * LANES;
+    for(int l = 0; l < LANES; ++l) {
+      float z = context[i0 + l] + state[i0 + l];
+      if(withCoverage)
+        z += coverage[i0 + l];
+      sum[l] += fastTanh(z) * va[i0 + l];
+    }
+  }
+  for(int i = blocks * LANES; i < k; ++i) {
+    float z = context[i] + state[i];
+    if(withCoverage)
+      z += coverage[i];
+    sum[i % LANES] += fastTanh(z) * va[i];
+  }
+
+  float total = 0;
+  for(int l = 0; l < LANES; ++l)
+    total += sum[l];
+  return total;
+}
+
+template <bool withCoverage>
+void attForward(float* out,
+                const float* va,
+                const float* context,
+                const float* state,
+                const float* coverage,
+                int dimBatch,
+                int dimHidden,
+                int dimSrc,
+                int dimBeam) {
+  int k = dimHidden;
+  int rowBytes = k * sizeof(float) * (withCoverage ? 2 : 1);
+  int tile = std::max(1, TILE_BYTES / rowBytes);
+
+  // A task is one beam entry of one sentence, consecutive tasks share the
+  // sentence and thereby its context
+  int grain = std::max(1, MIN_TANH_PER_THREAD / std::max(1, dimSrc * k));
+  parallelFor(dimBatch * dimBeam, grain, [&](int begin, int end) {
+    for(int task = begin; task < end;) {
+      int s = task / dimBeam;
+      int h0 = task % dimBeam;
+      int h1 = std::min(dimBeam, h0 + end - task);
+
+      for(int t0 = 0; t0 < dimSrc; t0 += tile) {
+        int t1 = std::min(dimSrc, t0 + tile);
+        for(int h = h0; h < h1; ++h) {
+          const float* sRow = state + ((size_t)h * dimBatch + s) * k;
+          for(int t = t0; t < t1; ++t) {
+            size_t c = (size_t)t * dimBatch + s;
+            out[((size_t)h * dimSrc + t) * dimBatch + s]
+                = score<withCoverage>(context + c * k,
+                                      sRow,
+                                      withCoverage ? coverage + c * k : nullptr,
+                                      va,
+                                      k);
+          }
+        }
+      }
+
+      task += h1 - h0;
+    }
+  });
+}
+
+template <bool withCoverage>
+void attBackward(float* gVa,
+                 float* gContext,
+                 float* gState,
+                 float* gCoverage,
+                 const float* va,
+                 const float* context,
+                 const float* state,
+                 const float* coverage,
+                 const float* adj,
+                 int dimBatch,
+                 int dimHidden,
+                 int dimSrc,
+                 int dimBeam) {
+  int k = dimHidden;
+  int rows = dimBatch * dimSrc * dimBeam;
+
+  int blocks = (k + HIDDEN_BLOCK - 1) / HIDDEN_BLOCK;
+  int grain = std::max(
+      1, MIN_TANH_PER_THREAD / std::max(1, rows * std::min(k, HIDDEN_BLOCK)));
+  parallelFor(blocks, grain, [&](int begin, int end) {
+    float dVa[HIDDEN_BLOCK], dZ[HIDDEN_BLOCK];
+
+    for(int c0 = begin * HIDDEN_BLOCK; c0 < std::min(k, end * HIDDEN_BLOCK);
+        c0 += HIDDEN_BLOCK) {
+      int n = std::min(HIDDEN_BLOCK, k - c0);
+      std::fill(dVa, dVa + n, 0.f);
+
+      for(int j = 0; j < rows; ++j) {
+        int s = j % dimBatch;
+        int t = (j / dimBatch) % dimSrc;
+        int h = j / (dimBatch * dimSrc);
+        size_t c = ((size_t)t * dimBatch + s) * k + c0;
+        size_t r = ((size_t)h * dimBatch + s) * k + c0;
+        float a = adj[j];
+
+        const float* cRow = context + c;
+        const float* sRow = state + r;
+        const float* vaRow = va + c0;
+        for(int i = 0; i < n; ++i) {
+          float z = cRow[i] + sRow[i];
+          if(withCoverage)
+            z += coverage[c + i];
+          float th = fastTanh(z);
+          dZ[i] = vaRow[i] * (1.f - th * th) * a;
+          dVa[i] += th * a;
+        }
+
+        for(int i = 0; i < n; ++i)
+          gContext[c + i] += dZ[i];
+        for(int i = 0; i < n; ++i)
+          gState[r + i] += dZ[i];
+        if(gCoverage)
+          for(int i = 0; i < n; ++i)
+            gCoverage[c + i] += dZ[i];
+      }
+
+      for(int i = 0; i < n; ++i)
+        gVa[c0 + i] += dVa[i];
+    }
+  });
+}
+}
+
+void Att(Tensor out, Tensor va, Tensor context, Tensor state, Tensor coverage) {
+  int dimBatch = context->shape()[0];
+  int dimHidden = context->shape()[1];
+  int dimSrc = context->shape()[2];
+  int dimBeam = out->shape()[3];
+
+  auto forward = coverage ? attForward<true> : attForward<false>;
+  forward(out->data(),
+          va->data(),
+          context->data(),
+          state->data(),
+          coverage ? coverage->data() : nullptr,
+          dimBatch,
+          dimHidden,
+          dimSrc,
+          dimBeam);
+}
+
+void AttBack(Tensor gVa,
+             Tensor gContext,
+             Tensor gState,
+             Tensor gCoverage,
+             Tensor va,
+             Tensor context,
+             Tensor state,
+             Tensor coverage,
+             Tensor adj) {
+  int dimBatch = context->shape()[0];
+  int dimHidden = context->shape()[1];
+  int dimSrc = context->shape()[2];
+  int dimBeam = adj->shape()[3];
+
+  auto backward = coverage ? attBackward<true> : attBackward<false>;
+  backward(gVa->data(),
+           gContext->data(),
+           gState->data(),
+           gCoverage ? gCoverage->data() : nullptr,
+           va->data(),
+           context->data(),
+           state->data(),
+           coverage ? coverage->data() : nullptr,
+           adj->data(),
+           dimBatch,
+           dimHidden,
+           dimSrc,
+           dimBeam);
+}
+}
+}
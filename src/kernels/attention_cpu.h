@@ -0,0 +1,35 @@
+#pragma once
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief Host counterpart of Att in kernels/tensor_operators.h.
+ *
+ * out[beam, t, b] = sum over the hidden dimension of
+ * tanh(context[t, b] + state[beam, b] + coverage[t, b]) * va, coverage may
+ * be null. Source positions are processed in tiles that are reused by all
+ * beam entries of a sentence while they are in L2; sentences and beam
+ * entries are spread across threads.
+ */
+void Att(Tensor out, Tensor va, Tensor context, Tensor state, Tensor coverage);
+
+/**
+ * @brief Host counterpart of AttBack in kernels/tensor_operators.h,
+ * gradients are added to gVa, gContext, gState and gCoverage if it is not
+ * null. Threads work on disjoint blocks of the hidden dimension so that no
+ * gradient needs synchronisation.
+ */
+void AttBack(Tensor gVa,
+             Tensor gContext,
+             Tensor gState,
+             Tensor gCoverage,
+             Tensor va,
+             Tensor context,
+             Tensor state,
+             Tensor coverage,
+             Tensor adj);
+}
+}
@@ -0,0 +1,22 @@
+#include "kernels/dropout_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+void Dropout(Tensor tensor, float p, std::mt19937& gen) {
+  int n = tensor->size();
+  float* data = tensor->data();
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  for(int i = 0; i < n; ++i)
+    data[i] = (uniform(gen) < 1.f - p) / (1.f - p);
+}
+
+void Gaussian(Tensor tensor, float mean, float stddev, std::mt19937& gen) {
+  int n = tensor->size();
+  float* data = tensor->data();
+  std::normal_distribution<float> normal(mean, stddev);
+  for(int i = 0; i < n; ++i)
+    data[i] = normal(gen);
+}
+}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <random>
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief Host counterpart of Dropout in kernels/dropout.h, fills tensor with
+ * a mask of 1/(1-p) for kept and 0 for dropped elements drawn from gen.
+ */
+void Dropout(Tensor tensor, float p, std::mt19937& gen);
+
+/**
+ * @brief Host counterpart of Gaussian in kernels/dropout.h, fills tensor with
+ * normally distributed values drawn from gen.
+ */
+void Gaussian(Tensor tensor, float mean, float stddev, std::mt19937& gen);
+}
+}
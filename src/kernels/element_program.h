@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+namespace marian {
+
+/** @brief Operations of fused element-wise programs */
+enum class ElementCode : uint8_t {
+  None,
+  Input,
+  Add,
+  Sub,
+  Mul,
+  Div,
+  AddScalar,
+  MulScalar,
+  Tanh,
+  Sigmoid,
+  ReLU,
+  Neg,
+  Exp,
+  Log,
+  Sqrt,
+  Square
+};
+
+/**
+ * @brief Element-wise operation of a node applied to its children. Unary
+ * operations of nodes with several children (tanh(a + b + c)) apply to the
+ * sum of the children.
+ */
+struct ElementOp {
+  ElementCode code;
+  float scalar;
+};
+
+/**
+ * @brief Instruction of an ElementProgram. Operands a and b are indices of
+ * earlier instructions, a is the index of the input for ElementCode::Input.
+ * scalar is the constant of AddScalar and MulScalar and the epsilon of Sqrt.
+ */
+struct ElementInstr {
+  ElementCode code;
+  uint8_t a;
+  uint8_t b;
+  float scalar;
+};
+
+/**
+ * @brief Straight-line program evaluated for every element by FusedElement
+ * in kernels/tensor_operators.h, the last instruction is the result. Inputs
+ * have the shape of the result or are broadcast to it like the inputs of
+ * Element.
+ */
+struct ElementProgram {
+  static const int MAX_INSTRS = 32;
+  static const int MAX_INPUTS = 8;
+
+  int size;
+  int inputs;
+  ElementInstr instrs[MAX_INSTRS];
+};
+}
@@ -0,0 +1,397 @@
+#include "kernels/fused_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#include "kernels/math_cpu.h"
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+// Elements evaluated per instruction before moving on to the next one, the
+// values of all instructions of a block fit into L1
+const int BLOCK = 128;
+
+// Instructions per element below which splitting work does not pay off
+const int MIN_INSTRS_PER_THREAD = MIN_ELEMENTS_PER_THREAD;
+
+// Input of a program, inputs of another shape than the result are broadcast
+struct Operand {
+  const float* data;
+  float* grad;
+  Shape shape;
+  bool broadcast;
+};
+
+std::vector<Operand> operands(const std::vector<Tensor>& inputs,
+                              const std::vector<Tensor>& grads,
+                              const Shape& shape) {
+  std::vector<Operand> ops;
+  for(size_t k = 0; k < inputs.size(); ++k) {
+    float* grad = k < grads.size() && grads[k] ? grads[k]->data() : nullptr;
+    ops.push_back({inputs[k]->data(),
+                   grad,
+                   inputs[k]->shape(),
+                   inputs[k]->shape() != shape});
+  }
+  return ops;
+}
+
+// Calls f(i, k) for every element offset + i of a block of the result and
+// the element k of a broadcast operand of shape in it reads
+template <class F>
+void forEachBroadcast(const Shape& in,
+                      const Shape& out,
+                      size_t offset,
+                      int n,
+                      F f) {
+  int cols = out[1];
+  int row = offset / cols;
+  int col = offset % cols;
+  int base = rowOffset(in, out, row);
+  int step = in.bstride(1);
+  for(int i = 0; i < n; ++i) {
+    f(i, base + col * step);
+    if(++col == cols) {
+      col = 0;
+      base = rowOffset(in, out, ++row);
+    }
+  }
+}
+
+// Values of all instructions for one block of elements, inputs of the
+// result's shape are read in place
+struct Values {
+  const float* ptr[ElementProgram::MAX_INSTRS];
+  float scratch[ElementProgram::MAX_INSTRS][BLOCK];
+};
+
+void evaluate(Values& v,
+              const ElementProgram& program,
+              const std::vector<Operand>& inputs,
+              const Shape& shape,
+              size_t offset,
+              int n) {
+  for(int j = 0; j < program.size; ++j) {
+    const ElementInstr& instr = program.instrs[j];
+    if(instr.code == ElementCode::Input) {
+      const Operand& in = inputs[instr.a];
+      if(!in.broadcast) {
+        v.ptr[j] = in.data + offset;
+        continue;
+      }
+      float* y = v.scratch[j];
+      forEachBroadcast(in.shape, shape, offset, n, [&](int i, int k) {
+        y[i] = in.data[k];
+      });
+      v.ptr[j] = y;
+      continue;
+    }
+
+    const float* __restrict__ a = v.ptr[instr.a];
+    const float* __restrict__ b = v.ptr[instr.b];
+    float* __restrict__ y = v.scratch[j];
+    float s = instr.scalar;
+
+    switch(instr.code) {
+      case ElementCode::Add:
+        for(int i = 0; i < n; ++i)
+          y[i] = a[i] + b[i];
+        break;
+      case ElementCode::Sub:
+        for(int i = 0; i < n; ++i)
+          y[i] = a[i] - b[i];
+        break;
+      case ElementCode::Mul:
+        for(int i = 0; i < n; ++i)
+          y[i] = a[i] * b[i];
+        break;
+      case ElementCode::Div:
+        for(int i = 0; i < n; ++i)
+          y[i] = a[i] / b[i];
+        break;
+      case ElementCode::AddScalar:
+        for(int i = 0; i < n; ++i)
+          y[i] = a[i] + s;
+        break;
+      case ElementCode::MulScalar:
+        for(int i = 0; i < n; ++i)
+          y[i] = a[i] * s;
+        break;
+      case ElementCode::Tanh:
+        for(int i = 0; i < n; ++i)
+          y[i] = fastTanh(a[i]);
+        break;
+      case ElementCode::Sigmoid:
+        for(int i = 0; i < n; ++i)
+          y[i] = fastSigmoid(a[i]);
+        break;
+      case ElementCode::ReLU:
+        for(int i = 0; i < n; ++i)
+          y[i] = a[i] > 0.f ? a[i] : 0.f;
+        break;
+      case ElementCode::Neg:
+        for(int i = 0; i < n; ++i)
+          y[i] = -a[i];
+        break;
+      case ElementCode::Exp:
+        for(int i = 0; i < n; ++i)
+          y[i] = fastExp(a[i]);
+        break;
+      case ElementCode::Log:
+        for(int i = 0; i < n; ++i)
+          y[i] = std::log(a[i]);
+        break;
+      case ElementCode::Sqrt:
+        for(int i = 0; i < n; ++i)
+          y[i] = std::sqrt(a[i] + s);
+        break;
+      case ElementCode::Square:
+        for(int i = 0; i < n; ++i)
+          y[i] = a[i] * a[i];
+        break;
+      default: break;
+    }
+    v.ptr[j] = y;
+  }
+}
+
+// Adjoints of all instructions for one block, zeroed on first use
+struct Adjoints {
+  bool used[ElementProgram::MAX_INSTRS];
+  float g[ElementProgram::MAX_INSTRS][BLOCK];
+
+  float* get(int j, int n) {
+    if(!used[j]) {
+      std::fill(g[j], g[j] + n, 0.f);
+      used[j] = true;
+    }
+    return g[j];
+  }
+};
+
+void propagate(Adjoints& d,
+               const Values& v,
+               const ElementProgram& program,
+               const std::vector<Operand>& inputs,
+               const Shape& shape,
+               size_t offset,
+               int n) {
+  for(int j = program.size - 1; j >= 0; --j) {
+    if(!d.used[j])
+      continue;
+
+    const ElementInstr& instr = program.instrs[j];
+    const float* __restrict__ g = d.g[j];
+
+    if(instr.code == ElementCode::Input) {
+      const Operand& in = inputs[instr.a];
+      if(!in.grad)
+        continue;
+      if(!in.broadcast) {
+        float* __restrict__ out = in.grad + offset;
+        for(int i = 0; i < n; ++i)
+          out[i] += g[i];
+      } else {
+        forEachBroadcast(in.shape, shape, offset, n, [&](int i, int k) {
+          in.grad[k] += g[i];
+        });
+      }
+      continue;
+    }
+
+    const float* __restrict__ a = v.ptr[instr.a];
+    const float* __restrict__ b = v.ptr[instr.b];
+    const float* __restrict__ y = v.ptr[j];
+    float s = instr.scalar;
+    float* ga = d.get(instr.a, n);
+
+    switch(instr.code) {
+      case ElementCode::Add:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i];
+        break;
+      case ElementCode::Sub:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i];
+        break;
+      case ElementCode::Mul:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i] * b[i];
+        break;
+      case ElementCode::Div:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i] / b[i];
+        break;
+      case ElementCode::AddScalar:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i];
+        break;
+      case ElementCode::MulScalar:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i] * s;
+        break;
+      case ElementCode::Tanh:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i] * (1.f - y[i] * y[i]);
+        break;
+      case ElementCode::Sigmoid:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i] * y[i] * (1.f - y[i]);
+        break;
+      case ElementCode::ReLU:
+        for(int i = 0; i < n; ++i)
+          ga[i] += a[i] > 0.f ? g[i] : 0.f;
+        break;
+      case ElementCode::Neg:
+        for(int i = 0; i < n; ++i)
+          ga[i] -= g[i];
+        break;
+      case ElementCode::Exp:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i] * y[i];
+        break;
+      case ElementCode::Log:
+        for(int i = 0; i < n; ++i)
+          ga[i] += g[i] / a[i];
+        break;
+      case ElementCode::Sqrt:
+        for(int i = 0; i < n; ++i)
+          ga[i] += 0.5f * g[i] / y[i];
+        break;
+      case ElementCode::Square:
+        for(int i = 0; i < n; ++i)
+          ga[i] += 2.f * g[i] * a[i];
+        break;
+      default: break;
+    }
+
+    // the second operand of binary operations
+    switch(instr.code) {
+      case ElementCode::Add: {
+        float* gb = d.get(instr.b, n);
+        for(int i = 0; i < n; ++i)
+          gb[i] += g[i];
+      } break;
+      case ElementCode::Sub: {
+        float* gb = d.get(instr.b, n);
+        for(int i = 0; i < n; ++i)
+          gb[i] -= g[i];
+      } break;
+      case ElementCode::Mul: {
+        float* gb = d.get(instr.b, n);
+        for(int i = 0; i < n; ++i)
+          gb[i] += g[i] * a[i];
+      } break;
+      case ElementCode::Div: {
+        float* gb = d.get(instr.b, n);
+        for(int i = 0; i < n; ++i)
+          gb[i] -= g[i] * a[i] / (b[i] * b[i]);
+      } break;
+      default: break;
+    }
+  }
+}
+
+// Number of blocks of elements and blocks per thread
+int blocksOf(size_t elements) {
+  return (elements + BLOCK - 1) / BLOCK;
+}
+
+int grainOf(const ElementProgram& program) {
+  return std::max(1,
+                  MIN_INSTRS_PER_THREAD / (BLOCK * std::max(1, program.size)));
+}
+
+template <class Body>
+void forEachBlock(size_t elements, const ElementProgram& program, Body body) {
+  parallelFor(blocksOf(elements), grainOf(program), [&](int begin, int end) {
+    for(int blk = begin; blk < end; ++blk) {
+      size_t offset = (size_t)blk * BLOCK;
+      body(offset, (int)std::min<size_t>(BLOCK, elements - offset));
+    }
+  });
+}
+}
+
+void FusedElement(Tensor out,
+                  const std::vector<Tensor>& inputs,
+                  const ElementProgram& program) {
+  auto in = operands(inputs, {}, out->shape());
+  const Shape& shape = out->shape();
+
+  float* o = out->data();
+  forEachBlock(out->size(), program, [&](size_t offset, int n) {
+    Values v;
+    evaluate(v, program, in, shape, offset, n);
+    std::copy(v.ptr[program.size - 1], v.ptr[program.size - 1] + n, o + offset);
+  });
+}
+
+void FusedElementGrad(const std::vector<Tensor>& grads,
+                      Tensor adj,
+                      const std::vector<Tensor>& inputs,
+                      const ElementProgram& program) {
+  auto in = operands(inputs, grads, adj->shape());
+  const Shape& shape = adj->shape();
+  const float* a = adj->data();
+  size_t elements = adj->size();
+
+  auto run = [&](const std::vector<Operand>& ops, int begin, int end) {
+    for(int blk = begin; blk < end; ++blk) {
+      size_t offset = (size_t)blk * BLOCK;
+      int n = std::min<size_t>(BLOCK, elements - offset);
+
+      Values v;
+      evaluate(v, program, ops, shape, offset, n);
+
+      Adjoints d;
+      std::fill(d.used, d.used + program.size, false);
+      std::copy(a + offset, a + offset + n, d.get(program.size - 1, n));
+      propagate(d, v, program, ops, shape, offset, n);
+    }
+  };
+
+  bool broadcast = false;
+  for(auto& op : in)
+    broadcast = broadcast || (op.broadcast && op.grad);
+
+  if(!broadcast) {
+    parallelFor(blocksOf(elements), grainOf(program), [&](int begin, int end) {
+      run(in, begin, end);
+    });
+    return;
+  }
+
+  // Gradients of broadcast inputs are summed over many elements of the
+  // result. Every thread sums into its own copy, the copies are added in
+  // the order of their blocks so that results do not depend on timing.
+  std::mutex mutex;
+  std::map<int, std::vector<std::vector<float>>> partials;
+  parallelFor(blocksOf(elements), grainOf(program), [&](int begin, int end) {
+    auto ops = in;
+    std::vector<std::vector<float>> sums(ops.size());
+    for(size_t k = 0; k < ops.size(); ++k) {
+      if(ops[k].broadcast && ops[k].grad) {
+        sums[k].assign(ops[k].shape.elements(), 0.f);
+        ops[k].grad = sums[k].data();
+      }
+    }
+    run(ops, begin, end);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    partials[begin] = std::move(sums);
+  });
+
+  for(auto& partial : partials)
+    for(size_t k = 0; k < in.size(); ++k)
+      for(size_t i = 0; i < partial.second[k].size(); ++i)
+        in[k].grad[i] += partial.second[k][i];
+}
+}
+}
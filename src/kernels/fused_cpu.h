@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "kernels/element_program.h"
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief Host counterpart of FusedElement in kernels/tensor_operators.h.
+ *
+ * The program is interpreted one instruction at a time over blocks of
+ * elements that stay in L1, so the dispatch on the operation is paid once per
+ * block and the loop over the block is vectorised. Blocks are spread across
+ * threads. Broadcast inputs are gathered into the block before it is
+ * evaluated.
+ */
+void FusedElement(Tensor out,
+                  const std::vector<Tensor>& inputs,
+                  const ElementProgram& program);
+
+/**
+ * @brief Host counterpart of FusedElementGrad in kernels/tensor_operators.h,
+ * the forward values of a block are recomputed and the adjoint is propagated
+ * back through the program. Gradients are added to the non-null grads, those
+ * of broadcast inputs are summed per thread first.
+ */
+void FusedElementGrad(const std::vector<Tensor>& grads,
+                      Tensor adj,
+                      const std::vector<Tensor>& inputs,
+                      const ElementProgram& program);
+}
+}
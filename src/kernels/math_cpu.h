@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace marian {
+namespace cpu {
+
+// Clamps x to the range of exp for normal floats and splits it into
+// x = n * ln(2) + r with |r| <= ln(2)/2 (Cephes range reduction)
+inline int32_t reduceExp(float& x) {
+  x = x < 88.37f ? x : 88.37f;
+  x = x > -87.33f ? x : -87.33f;
+
+  // rounds to the nearest integer by truncating a positive value, which is
+  // vectorised as a conversion. floorf is not vectorised without -ffast-math
+  // and adding and subtracting 1.5 * 2^23 is folded away with it.
+  int32_t n = (int32_t)(x * 1.44269504088896341f + 127.5f) - 127;
+  float fn = (float)n;
+  // ln(2) split into a part exact in float and the remainder. The part with
+  // the remainder must be added last, -ffast-math reorders it unless both
+  // are fused multiply-adds.
+#if defined(__FMA__)
+  x = std::fma(-fn, 0.693359375f, x);
+  x = std::fma(fn, 2.12194440e-4f, x);
+#else
+  x = x - fn * 0.693359375f;
+  x = x + fn * 2.12194440e-4f;
+#endif
+  return n;
+}
+
+// 2^n for n in the range of normal floats
+inline float pow2(int32_t n) {
+  int32_t bits = (n + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return scale;
+}
+
+/**
+ * @brief exp(x) to within 2 ulp, written without branches or library calls
+ * so that loops over it are vectorised by the compiler.
+ *
+ * Uses a degree 5 polynomial for exp(r) after range reduction. Arguments are
+ * clamped to the range of normal floats, so the result is never inf or a
+ * denormal.
+ */
+inline float fastExp(float x) {
+  int32_t n = reduceExp(x);
+
+  float p = 1.9875691500E-4f;
+  p = p * x + 1.3981999507E-3f;
+  p = p * x + 8.3334519073E-3f;
+  p = p * x + 4.1665795894E-2f;
+  p = p * x + 1.6666665459E-1f;
+  p = p * x + 5.0000001201E-1f;
+  p = p * x * x + x + 1.f;
+
+  return p * pow2(n);
+}
+
+/**
+ * @brief exp(x) to within 1e-4 relative error with a degree 3 polynomial,
+ * about half the cost of fastExp
+ */
+inline float approxExp(float x) {
+  int32_t n = reduceExp(x);
+
+  float p = 0.165419362f;
+  p = p * x + 0.504949177f;
+  p = p * x + 1.000186226f;
+  p = p * x + 0.999928923f;
+
+  return p * pow2(n);
+}
+
+/** @brief Accuracy of the exponentials in the host softmax kernels */
+enum class ExpAccuracy { full, approximate };
+
+/**
+ * @brief Process-wide accuracy setting, ExpAccuracy::full by default.
+ * approximate trades about 1e-4 relative error for speed and is meant for
+ * decoding.
+ */
+inline ExpAccuracy& expAccuracy() {
+  static ExpAccuracy accuracy = ExpAccuracy::full;
+  return accuracy;
+}
+
+struct FullExp {
+  float operator()(float x) const { return fastExp(x); }
+};
+
+struct ApproxExp {
+  float operator()(float x) const { return approxExp(x); }
+};
+
+inline float fastSigmoid(float x) {
+  return 1.f / (1.f + fastExp(-x));
+}
+
+/** @brief tanh(x) to within 2e-7 absolute */
+inline float fastTanh(float x) {
+  return 1.f - 2.f / (fastExp(2.f * x) + 1.f);
+}
+}
+}
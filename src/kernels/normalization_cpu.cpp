@@ -0,0 +1,201 @@
+#include "kernels/normalization_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+// Welford updates run in LANES independent lanes that are vectorised and
+// merged at the end of a row
+const int LANES = 16;
+const int COLUMN_BLOCK = 256;
+
+// Count, mean and sum of squared deviations of x, and optionally mean of a
+// and co-moment sum((a - meanA) * (x - mean)) of a second sequence
+struct Moments {
+  float n{0};
+  float mean{0};
+  float m2{0};
+  float meanA{0};
+  float co{0};
+};
+
+// Chan et al.'s combination of the moments of two disjoint sets
+inline Moments merge(const Moments& a, const Moments& b) {
+  if(a.n == 0)
+    return b;
+  if(b.n == 0)
+    return a;
+
+  Moments m;
+  m.n = a.n + b.n;
+  float dx = b.mean - a.mean;
+  float da = b.meanA - a.meanA;
+  float f = a.n * b.n / m.n;
+  m.mean = a.mean + dx * b.n / m.n;
+  m.m2 = a.m2 + b.m2 + dx * dx * f;
+  m.meanA = a.meanA + da * b.n / m.n;
+  m.co = a.co + b.co + dx * da * f;
+  return m;
+}
+
+template <bool withA>
+Moments moments(const float* __restrict__ x, const float* __restrict__ a, int n) {
+  float mean[LANES] = {}, m2[LANES] = {}, meanA[LANES] = {}, co[LANES] = {};
+
+  int blocks = n / LANES;
+  for(int b = 0; b < blocks; ++b) {
+    // all lanes have seen the same number of values
+    float inv = 1.f / (b + 1);
+    const float* xb = x + b * LANES;
+    const float* ab = a + b * LANES;
+    for(int l = 0; l < LANES; ++l) {
+      float dx = xb[l] - mean[l];
+      mean[l] += dx * inv;
+      m2[l] += dx * (xb[l] - mean[l]);
+      if(withA) {
+        meanA[l] += (ab[l] - meanA[l]) * inv;
+        co[l] += dx * (ab[l] - meanA[l]);
+      }
+    }
+  }
+
+  Moments total;
+  for(int l = 0; l < LANES && blocks > 0; ++l) {
+    Moments lane;
+    lane.n = blocks;
+    lane.mean = mean[l];
+    lane.m2 = m2[l];
+    lane.meanA = meanA[l];
+    lane.co = co[l];
+    total = merge(total, lane);
+  }
+  for(int i = blocks * LANES; i < n; ++i) {
+    Moments one;
+    one.n = 1;
+    one.mean = x[i];
+    one.meanA = withA ? a[i] : 0.f;
+    total = merge(total, one);
+  }
+  return total;
+}
+
+inline int rows(Tensor t) {
+  return t->shape()[0] * t->shape()[2] * t->shape()[3];
+}
+}
+
+void LayerNormalization(
+    Tensor out, Tensor in, Tensor gamma, Tensor beta, float eps) {
+  int m = rows(in);
+  int k = in->shape()[1];
+
+  float* o = out->data();
+  const float* x = in->data();
+  const float* g = gamma->data();
+  const float* b = beta ? beta->data() : nullptr;
+
+  int grain = std::max(1, MIN_ELEMENTS_PER_THREAD / std::max(1, k));
+  parallelFor(m, grain, [&](int begin, int end) {
+    for(int j = begin; j < end; ++j) {
+      const float* xRow = x + (size_t)j * k;
+      float* oRow = o + (size_t)j * k;
+
+      Moments stats = moments<false>(xRow, nullptr, k);
+      float mean = stats.mean;
+      float rstd = 1.f / std::sqrt(eps + stats.m2 / k);
+
+      if(b) {
+        for(int i = 0; i < k; ++i)
+          oRow[i] = g[i] * ((xRow[i] - mean) * rstd) + b[i];
+      } else {
+        for(int i = 0; i < k; ++i)
+          oRow[i] = g[i] * ((xRow[i] - mean) * rstd);
+      }
+    }
+  });
+}
+
+void LayerNormalizationGrad(Tensor gradX,
+                            Tensor gradGamma,
+                            Tensor gradBeta,
+                            Tensor adj,
+                            Tensor y,
+                            Tensor x,
+                            Tensor gamma,
+                            Tensor beta,
+                            float eps) {
+  int m = rows(y);
+  int k = y->shape()[1];
+
+  float* gx = gradX->data();
+  float* gg = gradGamma->data();
+  float* gb = beta && gradBeta ? gradBeta->data() : nullptr;
+  const float* a = adj->data();
+  const float* xs = x->data();
+  const float* g = gamma->data();
+
+  // mean and 1/sigma of each row, shared with the second phase
+  static thread_local std::vector<float> stats;
+  stats.resize(2 * m);
+  float* st = stats.data();
+
+  // Gradients of x are local to rows. As in the GPU kernel the reductions
+  // are over adj and adj * x_hat, gamma is applied afterwards.
+  int grain = std::max(1, MIN_ELEMENTS_PER_THREAD / std::max(1, k));
+  parallelFor(m, grain, [&](int begin, int end) {
+    for(int j = begin; j < end; ++j) {
+      const float* xRow = xs + (size_t)j * k;
+      const float* adjRow = a + (size_t)j * k;
+      float* gxRow = gx + (size_t)j * k;
+
+      Moments mom = moments<true>(xRow, adjRow, k);
+      float mean = mom.mean;
+      float sigma = std::sqrt(eps + mom.m2 / k);
+      float rstd = 1.f / sigma;
+      float sumAdj = mom.meanA * k;
+      // sum(adj * (x - mean)) equals the co-moment as sum(x - mean) is 0
+      float sumAdjX = mom.co * rstd;
+      float scale = 1.f / (k * sigma);
+
+      for(int i = 0; i < k; ++i) {
+        float xHat = (xRow[i] - mean) * rstd;
+        float grad = (k * adjRow[i] - sumAdj - sumAdjX * xHat) * scale;
+        gxRow[i] += g[i] * grad;
+      }
+
+      st[2 * j] = mean;
+      st[2 * j + 1] = rstd;
+    }
+  });
+
+  // Gradients of gamma and beta sum over rows, threads take disjoint
+  // column blocks instead of synchronising
+  int blocks = (k + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+  int blockGrain = std::max(
+      1, MIN_ELEMENTS_PER_THREAD / std::max(1, m * std::min(k, COLUMN_BLOCK)));
+  parallelFor(blocks, blockGrain, [&](int begin, int end) {
+    int c0 = begin * COLUMN_BLOCK;
+    int c1 = std::min(k, end * COLUMN_BLOCK);
+    for(int j = 0; j < m; ++j) {
+      const float* xRow = xs + (size_t)j * k;
+      const float* adjRow = a + (size_t)j * k;
+      float mean = st[2 * j];
+      float rstd = st[2 * j + 1];
+
+      for(int i = c0; i < c1; ++i)
+        gg[i] += adjRow[i] * ((xRow[i] - mean) * rstd);
+      if(gb)
+        for(int i = c0; i < c1; ++i)
+          gb[i] += adjRow[i];
+    }
+  });
+}
+}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief Host counterpart of LayerNormalization in kernels/tensor_operators.h.
+ *
+ * Mean and variance of each row are computed in a single Welford pass, the
+ * second pass applies gamma and beta. Rows are spread across threads.
+ */
+void LayerNormalization(
+    Tensor out, Tensor in, Tensor gamma, Tensor beta, float eps = 1e-9);
+
+/**
+ * @brief Host counterpart of LayerNormalizationGrad in
+ * kernels/tensor_operators.h with the same semantics as the GPU kernel.
+ *
+ * The row statistics and the sums over the adjoint are gathered in one pass
+ * over x and adj, the normalised input is recomputed from x instead of being
+ * recovered from y.
+ */
+void LayerNormalizationGrad(Tensor gradX,
+                            Tensor gradGamma,
+                            Tensor gradBeta,
+                            Tensor adj,
+                            Tensor y,
+                            Tensor x,
+                            Tensor gamma,
+                            Tensor beta,
+                            float eps = 1e-9);
+}
+}
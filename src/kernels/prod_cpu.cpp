@@ -0,0 +1,308 @@
+#include "kernels/prod_cpu.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if BLAS_FOUND
+#include <cblas.h>
+#endif
+
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+// Register tile of the micro-kernel and cache blocking, sized for AVX2 and
+// AVX-512: a 6x16 tile of C stays in vector registers while panels of A
+// (MC x KC) and B (KC x NC) are streamed from L2 and L3.
+const int MR = 6;
+const int NR = 16;
+const int MC = 96;
+const int KC = 256;
+const int NC = 3072;
+
+// Packs the block of op(A) starting at (i0, k0) into panels of MR rows stored
+// column by column, padding the last panel with zeros.
+void packA(bool trans, const float* A, int lda,
+           int i0, int k0, int mc, int kc, float* packed) {
+  for(int i = 0; i < mc; i += MR) {
+    int rows = std::min(MR, mc - i);
+    for(int k = 0; k < kc; ++k) {
+      for(int r = 0; r < rows; ++r) {
+        int row = i0 + i + r;
+        int col = k0 + k;
+        packed[r] = trans ? A[col * lda + row] : A[row * lda + col];
+      }
+      for(int r = rows; r < MR; ++r)
+        packed[r] = 0;
+      packed += MR;
+    }
+  }
+}
+
+// Packs the block of op(B) starting at (k0, j0) into panels of NR columns
+// stored row by row, padding the last panel with zeros.
+void packB(bool trans, const float* B, int ldb,
+           int k0, int j0, int kc, int nc, float* packed) {
+  for(int j = 0; j < nc; j += NR) {
+    int cols = std::min(NR, nc - j);
+    for(int k = 0; k < kc; ++k) {
+      int row = k0 + k;
+      if(trans) {
+        for(int c = 0; c < cols; ++c)
+          packed[c] = B[(j0 + j + c) * ldb + row];
+      } else {
+        const float* src = B + row * ldb + j0 + j;
+        for(int c = 0; c < cols; ++c)
+          packed[c] = src[c];
+      }
+      for(int c = cols; c < NR; ++c)
+        packed[c] = 0;
+      packed += NR;
+    }
+  }
+}
+
+// One row of the register tile. GCC and clang lower this to two AVX2 or one
+// AVX-512 register under -march=native.
+typedef float Row __attribute__((vector_size(NR * sizeof(float))));
+
+// C[0:rows, 0:cols] = alpha * Ap * Bp + beta * C for one MR x NR tile, rows
+// of the B panel are ldbp floats apart
+inline void microKernel(int kc,
+                        float alpha,
+                        const float* __restrict__ Ap,
+                        const float* __restrict__ Bp,
+                        int ldbp,
+                        float beta,
+                        float* C,
+                        int ldc,
+                        int rows,
+                        int cols) {
+  Row acc[MR] = {};
+  for(int k = 0; k < kc; ++k) {
+    Row b;
+    std::memcpy(&b, Bp, sizeof(Row));
+    for(int r = 0; r < MR; ++r)
+      acc[r] += Ap[r] * b;
+    Ap += MR;
+    Bp += ldbp;
+  }
+
+  for(int r = 0; r < rows; ++r) {
+    float* c = C + r * ldc;
+    if(cols == NR) {
+      Row out = alpha * acc[r];
+      if(beta != 0) {
+        Row old;
+        std::memcpy(&old, c, sizeof(Row));
+        out += beta * old;
+      }
+      std::memcpy(c, &out, sizeof(Row));
+    } else {
+      for(int j = 0; j < cols; ++j)
+        c[j] = alpha * acc[r][j] + (beta == 0 ? 0 : beta * c[j]);
+    }
+  }
+}
+
+// Single-threaded blocked product on the sub-matrix of C given by rows
+// [m0, m1) and columns [n0, n1)
+void gemmBlock(bool transA, bool transB,
+               int m0, int m1, int n0, int n1, int K,
+               float alpha, const float* A, int lda,
+               const float* B, int ldb,
+               float beta, float* C, int ldc) {
+  static thread_local std::vector<float> bufferA;
+  static thread_local std::vector<float> bufferB;
+  bufferA.resize(MC * KC);
+  bufferB.resize(KC * (NC + NR));
+
+  for(int j0 = n0; j0 < n1; j0 += NC) {
+    int nc = std::min(NC, n1 - j0);
+    for(int k0 = 0; k0 < K; k0 += KC) {
+      int kc = std::min(KC, K - k0);
+      // later blocks of K accumulate into the partial result
+      float blockBeta = k0 == 0 ? beta : 1.f;
+
+      // With few rows, as for output layers at small batch sizes, each panel
+      // of B is used by one or two tiles only and the product is bound by
+      // reading B. Full panels are then read in place and only the ragged
+      // last panel is packed.
+      bool direct = !transB && m1 - m0 <= 2 * MR;
+      int packed = direct ? nc / NR * NR : 0;
+      packB(transB, B, ldb, k0, j0 + packed, kc, nc - packed, bufferB.data());
+
+      for(int i0 = m0; i0 < m1; i0 += MC) {
+        int mc = std::min(MC, m1 - i0);
+        packA(transA, A, lda, i0, k0, mc, kc, bufferA.data());
+
+        for(int j = 0; j < nc; j += NR) {
+          const float* Bp = bufferB.data() + (j - packed) * kc;
+          int ldbp = NR;
+          if(j < packed) {
+            Bp = B + k0 * ldb + j0 + j;
+            ldbp = ldb;
+          }
+          for(int i = 0; i < mc; i += MR) {
+            const float* Ap = bufferA.data() + i * kc;
+            microKernel(kc, alpha, Ap, Bp, ldbp, blockBeta,
+                        C + (i0 + i) * ldc + j0 + j, ldc,
+                        std::min(MR, mc - i), std::min(NR, nc - j));
+          }
+        }
+      }
+    }
+  }
+}
+}
+
+void gemm(bool transA,
+          bool transB,
+          int M,
+          int N,
+          int K,
+          float alpha,
+          const float* A,
+          int lda,
+          const float* B,
+          int ldb,
+          float beta,
+          float* C,
+          int ldc) {
+  if(M == 0 || N == 0)
+    return;
+
+  if(K == 0) {
+    for(int i = 0; i < M; ++i)
+      for(int j = 0; j < N; ++j)
+        C[i * ldc + j] = beta == 0 ? 0 : beta * C[i * ldc + j];
+    return;
+  }
+
+#if BLAS_FOUND
+  cblas_sgemm(CblasRowMajor,
+              transA ? CblasTrans : CblasNoTrans,
+              transB ? CblasTrans : CblasNoTrans,
+              M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+#else
+  gemmBlocked(
+      transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+#endif
+}
+
+void gemmBlocked(bool transA,
+                 bool transB,
+                 int M,
+                 int N,
+                 int K,
+                 float alpha,
+                 const float* A,
+                 int lda,
+                 const float* B,
+                 int ldb,
+                 float beta,
+                 float* C,
+                 int ldc) {
+  // matrix-vector products, e.g. attention scores, are plain dot products
+  if(N == 1 && !transA) {
+    int step = transB ? 1 : ldb;
+    parallelFor(M, std::max(1, (1 << 16) / K), [&](int begin, int end) {
+      for(int i = begin; i < end; ++i) {
+        const float* a = A + i * lda;
+        float sum = 0;
+        if(step == 1) {
+          for(int k = 0; k < K; ++k)
+            sum += a[k] * B[k];
+        } else {
+          for(int k = 0; k < K; ++k)
+            sum += a[k] * B[k * step];
+        }
+        float& c = C[i * ldc];
+        c = alpha * sum + (beta == 0 ? 0 : beta * c);
+      }
+    });
+    return;
+  }
+
+  // Threads work on disjoint stripes of C along the larger dimension, each
+  // packing its own panels. Stripes are multiples of the register tile.
+  // a few MFLOP per thread at least
+  size_t panelFlops = N >= M ? 2ul * M * K * NR : 2ul * N * K * MR;
+  int grain = std::max<size_t>(1, (1ul << 22) / panelFlops);
+  if(N >= M) {
+    int panels = (N + NR - 1) / NR;
+    parallelFor(panels, grain, [&](int begin, int end) {
+      gemmBlock(transA, transB, 0, M, begin * NR, std::min(N, end * NR), K,
+                alpha, A, lda, B, ldb, beta, C, ldc);
+    });
+  } else {
+    int panels = (M + MR - 1) / MR;
+    parallelFor(panels, grain, [&](int begin, int end) {
+      gemmBlock(transA, transB, begin * MR, std::min(M, end * MR), 0, N, K,
+                alpha, A, lda, B, ldb, beta, C, ldc);
+    });
+  }
+}
+
+void Prod(Tensor C,
+          const Tensor A,
+          const Tensor B,
+          bool transA,
+          bool transB,
+          float beta,
+          float scalar) {
+  int m = A->shape()[0] * A->shape()[2] * A->shape()[3];
+  int k = A->shape()[1];
+  if(transA)
+    std::swap(m, k);
+
+  int n = transB ? B->shape()[0] : B->shape()[1];
+
+  gemm(transA, transB, m, n, k, scalar,
+       A->data(), A->shape()[1],
+       B->data(), B->shape()[1],
+       beta, C->data(), n);
+}
+
+void ProdBatched(Tensor C,
+                 const Tensor A,
+                 const Tensor B,
+                 bool transA,
+                 bool transB,
+                 float beta,
+                 float scalar) {
+  int batchA = A->shape()[2] * A->shape()[3];
+  int batchB = B->shape()[2] * B->shape()[3];
+  int batch = std::max(batchA, batchB);
+
+  int m = A->shape()[0];
+  int k = A->shape()[1];
+  if(transA)
+    std::swap(m, k);
+
+  int n = transB ? B->shape()[0] : B->shape()[1];
+
+  size_t strideA = batchA == 1 ? 0 : m * k;
+  size_t strideB = batchB == 1 ? 0 : n * k;
+  size_t strideC = m * n;
+
+  const float* a = A->data();
+  const float* b = B->data();
+  float* c = C->data();
+
+  // with fewer matrices than threads each product is parallelised instead
+  int grain = batch >= (int)numThreads() ? 1 : batch;
+  parallelFor(batch, grain, [&](int begin, int end) {
+    for(int i = begin; i < end; ++i)
+      gemm(transA, transB, m, n, k, scalar,
+           a + i * strideA, A->shape()[1],
+           b + i * strideB, B->shape()[1],
+           beta, c + i * strideC, n);
+  });
+}
+}
+}
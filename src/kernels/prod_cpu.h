@@ -0,0 +1,67 @@
+#pragma once
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief Single precision matrix product on row-major matrices,
+ * C = alpha * op(A) * op(B) + beta * C with op(A) of size M x K and op(B) of
+ * size K x N. Uses a system CBLAS if one was found at configure time,
+ * otherwise a blocked and packed kernel. C is not read if beta is 0.
+ */
+void gemm(bool transA,
+          bool transB,
+          int M,
+          int N,
+          int K,
+          float alpha,
+          const float* A,
+          int lda,
+          const float* B,
+          int ldb,
+          float beta,
+          float* C,
+          int ldc);
+
+/**
+ * @brief The built-in blocked kernel behind gemm, also used when a system
+ * BLAS is available for comparison. Requires M, N and K to be positive.
+ */
+void gemmBlocked(bool transA,
+                 bool transB,
+                 int M,
+                 int N,
+                 int K,
+                 float alpha,
+                 const float* A,
+                 int lda,
+                 const float* B,
+                 int ldb,
+                 float beta,
+                 float* C,
+                 int ldc);
+
+/** @brief Host counterpart of Prod in kernels/tensor_operators.h */
+void Prod(Tensor C,
+          const Tensor A,
+          const Tensor B,
+          bool transA,
+          bool transB,
+          float beta = 0,
+          float scalar = 1);
+
+/**
+ * @brief Host counterpart of ProdBatched in kernels/tensor_operators.h, the
+ * batch is spread across threads
+ */
+void ProdBatched(Tensor C,
+                 const Tensor A,
+                 const Tensor B,
+                 bool transA,
+                 bool transB,
+                 float beta = 0,
+                 float scalar = 1);
+}
+}
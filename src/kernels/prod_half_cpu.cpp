@@ -0,0 +1,224 @@
+#include "kernels/prod_half_cpu.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+// Register tile as in kernels/prod_cpu.cpp, a block of KC rows of a panel is
+// widened at a time and fits into L1 cache as float.
+const int MR = 6;
+const int NR = HalfMatrix::PANEL;
+const int KC = 256;
+
+typedef float Row __attribute__((vector_size(NR * sizeof(float))));
+
+inline uint32_t bitsOf(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+inline float floatOf(uint32_t bits) {
+  float x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+uint16_t floatToBf16(float x) {
+  uint32_t bits = bitsOf(x);
+  // keeps NaNs quiet instead of rounding them to infinity
+  if((bits & 0x7fffffff) > 0x7f800000)
+    return (bits >> 16) | 0x40;
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return bits >> 16;
+}
+
+uint16_t floatToFp16(float x) {
+  const uint32_t infinity = 255u << 23;
+  const uint32_t overflow = (127u + 16) << 23;
+  const uint32_t denormal = ((127u - 15) + (23 - 10) + 1) << 23;
+
+  uint32_t bits = bitsOf(x);
+  uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+
+  uint16_t h;
+  if(bits >= overflow) {
+    h = bits > infinity ? 0x7e00 : 0x7c00;
+  } else if(bits < (113u << 23)) {
+    // the addition rounds the mantissa into place
+    h = bitsOf(floatOf(bits) + floatOf(denormal)) - denormal;
+  } else {
+    uint32_t odd = (bits >> 13) & 1;
+    bits += ((15u - 127) << 23) + 0xfff + odd;
+    h = bits >> 13;
+  }
+  return h | (sign >> 16);
+}
+
+float fp16ToFloat(uint16_t h) {
+  const uint32_t shifted = 0x7c00u << 13;
+
+  uint32_t bits = (h & 0x7fffu) << 13;
+  uint32_t exponent = bits & shifted;
+  bits += (127u - 15) << 23;
+  if(exponent == shifted) {
+    bits += (128u - 16) << 23;
+  } else if(exponent == 0) {
+    bits += 1u << 23;
+    bits = bitsOf(floatOf(bits) - floatOf(113u << 23));
+  }
+  return floatOf(bits | (uint32_t)(h & 0x8000u) << 16);
+}
+
+// out[0, n) = in[0, n) as float
+void widen(const uint16_t* in, int n, HalfType type, float* out) {
+  if(type == HalfType::bf16) {
+    for(int i = 0; i < n; ++i) {
+      uint32_t bits = (uint32_t)in[i] << 16;
+      std::memcpy(out + i, &bits, sizeof(bits));
+    }
+    return;
+  }
+
+  int i = 0;
+#if defined(__F16C__)
+  for(; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i,
+                     _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in + i))));
+#endif
+  for(; i < n; ++i)
+    out[i] = fp16ToFloat(in[i]);
+}
+
+// C[0:rows, 0:cols] = alpha * Ap * Bp + beta * C for one MR x NR tile with
+// Ap packed by MR rows and Bp by rows of NR
+inline void microKernel(int kc,
+                        float alpha,
+                        const float* __restrict__ Ap,
+                        const float* __restrict__ Bp,
+                        float beta,
+                        float* C,
+                        int ldc,
+                        int rows,
+                        int cols) {
+  Row acc[MR] = {};
+  for(int k = 0; k < kc; ++k) {
+    Row b;
+    std::memcpy(&b, Bp, sizeof(Row));
+    for(int r = 0; r < MR; ++r)
+      acc[r] += Ap[r] * b;
+    Ap += MR;
+    Bp += NR;
+  }
+
+  for(int r = 0; r < rows; ++r) {
+    float* c = C + r * ldc;
+    for(int j = 0; j < cols; ++j)
+      c[j] = alpha * acc[r][j] + (beta == 0 ? 0 : beta * c[j]);
+  }
+}
+}
+
+uint16_t toHalf(float x, HalfType type) {
+  return type == HalfType::bf16 ? floatToBf16(x) : floatToFp16(x);
+}
+
+float fromHalf(uint16_t h, HalfType type) {
+  return type == HalfType::bf16 ? floatOf((uint32_t)h << 16) : fp16ToFloat(h);
+}
+
+HalfMatrix::HalfMatrix(Tensor B, bool transB, HalfType type) : type_(type) {
+  int rows = B->shape()[0] * B->shape()[2] * B->shape()[3];
+  int cols = B->shape()[1];
+  rows_ = transB ? cols : rows;
+  cols_ = transB ? rows : cols;
+
+  int panels = (cols_ + PANEL - 1) / PANEL;
+  data_.assign((size_t)panels * rows_ * PANEL, 0);
+
+  const float* b = B->data();
+  for(int j = 0; j < cols_; ++j) {
+    uint16_t* out = data_.data() + (size_t)(j / PANEL) * rows_ * PANEL;
+    int c = j % PANEL;
+    // column j of op(B) is column j of B or row j of B if transposed
+    for(int k = 0; k < rows_; ++k) {
+      float v = transB ? b[(size_t)j * cols + k] : b[(size_t)k * cols + j];
+      out[(size_t)k * PANEL + c] = toHalf(v, type);
+    }
+  }
+}
+
+void ProdHalf(Tensor C,
+              const Tensor A,
+              const HalfMatrix& B,
+              bool transA,
+              float beta,
+              float scalar) {
+  int rowsA = A->shape()[0] * A->shape()[2] * A->shape()[3];
+  int colsA = A->shape()[1];
+  int m = transA ? colsA : rowsA;
+  int k = transA ? rowsA : colsA;
+  int n = B.cols();
+
+  UTIL_THROW_IF2(k != B.rows(), "matrix product requires dimensions to match");
+
+  // op(A) is packed once into panels of MR rows stored column by column,
+  // A is small compared to the weights
+  int blocks = (m + MR - 1) / MR;
+  static thread_local std::vector<float> packedA;
+  packedA.assign((size_t)blocks * MR * k, 0);
+
+  const float* a = A->data();
+  for(int i = 0; i < m; ++i) {
+    float* out = &packedA[(size_t)(i / MR) * MR * k + i % MR];
+    for(int l = 0; l < k; ++l)
+      out[(size_t)l * MR] = transA ? a[(size_t)l * colsA + i]
+                                   : a[(size_t)i * colsA + l];
+  }
+
+  const float* pa = packedA.data();
+  float* c = C->data();
+
+  // Threads take panels of B, as for 8-bit products, and every block of a
+  // panel is widened once for all rows of A.
+  int panels = (n + NR - 1) / NR;
+  size_t panelOps = 2ul * blocks * MR * k * NR;
+  int grain = std::max<size_t>(1, (1ul << 21) / panelOps);
+  parallelFor(panels, grain, [&](int begin, int end) {
+    static thread_local std::vector<float> bufferB;
+    bufferB.resize(KC * NR);
+
+    for(int p = begin; p < end; ++p) {
+      const uint16_t* panel = B.panel(p);
+      int j0 = p * NR;
+      int cols = std::min(NR, n - j0);
+
+      for(int k0 = 0; k0 < k; k0 += KC) {
+        int kc = std::min(KC, k - k0);
+        // later blocks of K accumulate into the partial result
+        float blockBeta = k0 == 0 ? beta : 1.f;
+        widen(panel + (size_t)k0 * NR, kc * NR, B.type(), bufferB.data());
+
+        for(int i = 0; i < m; i += MR) {
+          const float* Ap = pa + (size_t)(i / MR) * MR * k + (size_t)k0 * MR;
+          microKernel(kc, scalar, Ap, bufferB.data(), blockBeta,
+                      c + (size_t)i * n + j0, n,
+                      std::min(MR, m - i), cols);
+        }
+      }
+    }
+  });
+}
+}
+}
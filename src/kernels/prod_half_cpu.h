@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief 16-bit floating point formats. bfloat16 keeps the exponent range of
+ * float with 8 bits of precision, float16 has 11 bits of precision but
+ * overflows beyond 65504.
+ */
+enum class HalfType { bf16, fp16 };
+
+/** @brief Rounds x to the nearest 16-bit value, ties to even */
+uint16_t toHalf(float x, HalfType type);
+
+/** @brief Exact float value of a 16-bit value */
+float fromHalf(uint16_t h, HalfType type);
+
+/**
+ * @brief Weight matrix of a product stored in 16-bit floating point, which
+ * halves the memory traffic of products that are bound by reading weights.
+ *
+ * op(B) is packed in panels of PANEL columns stored row by row, the layout
+ * read by the register tile of the float32 product.
+ */
+class HalfMatrix {
+public:
+  static const int PANEL = 16;
+
+private:
+  HalfType type_;
+  int rows_;
+  int cols_;
+  std::vector<uint16_t> data_;
+
+public:
+  /** @brief Converts op(B) of a product A * op(B) */
+  HalfMatrix(Tensor B, bool transB, HalfType type);
+
+  HalfType type() const { return type_; }
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+
+  const uint16_t* panel(int p) const {
+    return data_.data() + (size_t)p * rows_ * PANEL;
+  }
+};
+
+/**
+ * @brief C = scalar * op(A) * B + beta * C for 16-bit B.
+ *
+ * Blocks of a panel of B are widened to float right before they are used,
+ * while they are in L1 cache, and products are accumulated in float.
+ */
+void ProdHalf(Tensor C,
+              const Tensor A,
+              const HalfMatrix& B,
+              bool transA,
+              float beta = 0,
+              float scalar = 1);
+}
+}
@@ -0,0 +1,187 @@
+#include "kernels/prod_int8_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+const float INT8_RANGE = 127.f;
+
+// Rows of A handled together by the micro-kernel
+const int MR = 8;
+const int PANEL = QuantizedMatrix::PANEL;
+
+// Quantizes n values that are stride floats apart to [-127, 127] plus
+// offset, returns the scale
+float quantize(const float* in, int n, int stride, int offset, uint8_t* out) {
+  float maxAbs = 0;
+  for(int k = 0; k < n; ++k)
+    maxAbs = std::max(maxAbs, std::abs(in[k * stride]));
+  if(maxAbs == 0) {
+    std::fill(out, out + n, (uint8_t)offset);
+    return 0;
+  }
+
+  float inv = INT8_RANGE / maxAbs;
+  for(int k = 0; k < n; ++k)
+    out[k] = (uint8_t)(std::lrint(in[k * stride] * inv) + offset);
+  return maxAbs / INT8_RANGE;
+}
+
+// acc[r][c] = sum_k a[r][k] * b[k][c] for rows rows of unsigned a (each
+// paddedK bytes) and one panel of b
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+inline void microKernel(const uint8_t* a, int paddedK, int rows,
+                        const int8_t* panel, int32_t acc[MR][PANEL]) {
+  __m512i sum[MR];
+  for(int r = 0; r < MR; ++r)
+    sum[r] = _mm512_setzero_si512();
+
+  for(int k = 0; k < paddedK; k += 4) {
+    __m512i b = _mm512_loadu_si512(panel + k * PANEL);
+    for(int r = 0; r < MR; ++r) {
+      if(r < rows) {
+        int32_t quad;
+        std::memcpy(&quad, a + r * paddedK + k, sizeof(quad));
+        sum[r] = _mm512_dpbusd_epi32(sum[r], _mm512_set1_epi32(quad), b);
+      }
+    }
+  }
+
+  for(int r = 0; r < rows; ++r)
+    _mm512_storeu_si512(acc[r], sum[r]);
+}
+#else
+inline void microKernel(const uint8_t* a, int paddedK, int rows,
+                        const int8_t* panel, int32_t acc[MR][PANEL]) {
+  for(int r = 0; r < rows; ++r)
+    std::fill(acc[r], acc[r] + PANEL, 0);
+
+  for(int k = 0; k < paddedK; k += 4) {
+    const int8_t* b = panel + k * PANEL;
+    for(int r = 0; r < rows; ++r) {
+      const uint8_t* ar = a + r * paddedK + k;
+      for(int c = 0; c < PANEL; ++c)
+        acc[r][c] += ar[0] * b[4 * c] + ar[1] * b[4 * c + 1]
+                     + ar[2] * b[4 * c + 2] + ar[3] * b[4 * c + 3];
+    }
+  }
+}
+#endif
+}
+
+QuantizedMatrix::QuantizedMatrix(Tensor B, bool transB) {
+  int rows = B->shape()[0] * B->shape()[2] * B->shape()[3];
+  int cols = B->shape()[1];
+  rows_ = transB ? cols : rows;
+  cols_ = transB ? rows : cols;
+  paddedRows_ = (rows_ + 3) / 4 * 4;
+
+  int panels = (cols_ + PANEL - 1) / PANEL;
+  data_.assign((size_t)panels * paddedRows_ * PANEL, 0);
+  scales_.resize(cols_);
+  sums_.resize(cols_);
+
+  const float* b = B->data();
+  std::vector<uint8_t> column(rows_);
+  for(int j = 0; j < cols_; ++j) {
+    // column j of op(B) is column j of B or row j of B if transposed
+    if(transB)
+      scales_[j] = quantize(b + (size_t)j * cols, rows_, 1, 0, column.data());
+    else
+      scales_[j] = quantize(b + j, rows_, cols, 0, column.data());
+
+    int8_t* out = data_.data() + (size_t)(j / PANEL) * paddedRows_ * PANEL;
+    int c = j % PANEL;
+    int32_t sum = 0;
+    for(int k = 0; k < rows_; ++k) {
+      int8_t v = (int8_t)column[k];
+      out[(k / 4) * 4 * PANEL + 4 * c + k % 4] = v;
+      sum += v;
+    }
+    sums_[j] = sum;
+  }
+}
+
+void ProdInt8(Tensor C,
+              const Tensor A,
+              const QuantizedMatrix& B,
+              bool transA,
+              float beta,
+              float scalar) {
+  int rowsA = A->shape()[0] * A->shape()[2] * A->shape()[3];
+  int colsA = A->shape()[1];
+  int m = transA ? colsA : rowsA;
+  int k = transA ? rowsA : colsA;
+  int n = B.cols();
+  int paddedK = B.paddedRows();
+
+  UTIL_THROW_IF2(k != B.rows(), "matrix product requires dimensions to match");
+
+  // A is shifted by 128 into the unsigned range expected by vpdpbusd, the
+  // shift is removed again with the column sums of B. Padding of A
+  // represents 0 and meets zero padding in B.
+  const int OFFSET = 128;
+  static thread_local std::vector<uint8_t> qa;
+  static thread_local std::vector<float> scalesA;
+  qa.assign((size_t)m * paddedK, OFFSET);
+  scalesA.resize(m);
+
+  const float* a = A->data();
+  for(int i = 0; i < m; ++i) {
+    uint8_t* out = &qa[(size_t)i * paddedK];
+    if(transA)
+      scalesA[i] = quantize(a + i, k, colsA, OFFSET, out);
+    else
+      scalesA[i] = quantize(a + (size_t)i * colsA, k, 1, OFFSET, out);
+  }
+
+  const uint8_t* q = qa.data();
+  const float* sa = scalesA.data();
+  float* c = C->data();
+
+  // Threads take panels of B, which are read once while all of A stays in
+  // cache; a panel is reused across all row blocks of A.
+  int panels = (n + PANEL - 1) / PANEL;
+  size_t panelOps = 2ul * m * paddedK * PANEL;
+  int grain = std::max<size_t>(1, (1ul << 21) / panelOps);
+  parallelFor(panels, grain, [&](int begin, int end) {
+    int32_t acc[MR][PANEL];
+    for(int p = begin; p < end; ++p) {
+      const int8_t* panel = B.panel(p);
+      int j0 = p * PANEL;
+      int cols = std::min(PANEL, n - j0);
+
+      float sb[PANEL];
+      int32_t shift[PANEL];
+      for(int j = 0; j < cols; ++j) {
+        sb[j] = B.scale(j0 + j) * scalar;
+        shift[j] = OFFSET * B.sum(j0 + j);
+      }
+
+      for(int i = 0; i < m; i += MR) {
+        int rows = std::min(MR, m - i);
+        microKernel(q + (size_t)i * paddedK, paddedK, rows, panel, acc);
+        for(int r = 0; r < rows; ++r) {
+          float* out = c + (size_t)(i + r) * n + j0;
+          float s = sa[i + r];
+          for(int j = 0; j < cols; ++j)
+            out[j] = (acc[r][j] - shift[j]) * s * sb[j]
+                     + (beta == 0 ? 0 : beta * out[j]);
+        }
+      }
+    }
+  });
+}
+}
+}
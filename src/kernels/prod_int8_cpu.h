@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief Weight matrix of a product quantized to 8-bit integers.
+ *
+ * Each column j of op(B) is scaled by its own factor,
+ * op(B)[k][j] ~ q[k][j] * scale(j). Values are packed in panels of
+ * PANEL columns; within a panel, groups of four consecutive k of one column
+ * are adjacent, the layout consumed by the VNNI dot-product instructions.
+ */
+class QuantizedMatrix {
+public:
+  static const int PANEL = 16;
+
+private:
+  int rows_;
+  int cols_;
+  int paddedRows_;
+  std::vector<int8_t> data_;
+  std::vector<float> scales_;
+  std::vector<int32_t> sums_;
+
+public:
+  /** @brief Quantizes op(B) of a product A * op(B) */
+  QuantizedMatrix(Tensor B, bool transB);
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+
+  /** @brief Rows padded to a multiple of four */
+  int paddedRows() const { return paddedRows_; }
+
+  const int8_t* panel(int p) const {
+    return data_.data() + (size_t)p * paddedRows_ * PANEL;
+  }
+
+  float scale(int j) const { return scales_[j]; }
+
+  /** @brief Sum of the quantized values of column j */
+  int32_t sum(int j) const { return sums_[j]; }
+};
+
+/**
+ * @brief C = scalar * op(A) * B + beta * C for quantized B.
+ *
+ * Rows of op(A) are quantized on the fly with one scale per row and shifted
+ * to unsigned 8-bit values, products are accumulated in 32-bit integers and
+ * scaled back to float.
+ */
+void ProdInt8(Tensor C,
+              const Tensor A,
+              const QuantizedMatrix& B,
+              bool transA,
+              float beta = 0,
+              float scalar = 1);
+}
+}
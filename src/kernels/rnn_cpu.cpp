@@ -0,0 +1,479 @@
+#include "kernels/rnn_cpu.h"
+
+#include <algorithm>
+
+#include "kernels/math_cpu.h"
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+// Columns of the state handled by one task. Each element evaluates several
+// exponentials, so tasks are split well below MIN_ELEMENTS_PER_THREAD.
+const int GATE_BLOCK = 256;
+const int MIN_GATES_PER_THREAD = MIN_ELEMENTS_PER_THREAD / 8;
+
+// final is a template parameter so that the loops have no branches and are
+// vectorised
+template <bool final>
+void gruForwardRow(float* __restrict__ out,
+                   const float* __restrict__ state,
+                   const float* __restrict__ xW,
+                   const float* __restrict__ sU,
+                   const float* __restrict__ b,
+                   float m,
+                   int cols,
+                   int begin,
+                   int end) {
+  for(int i = begin; i < end; ++i) {
+    int k = i + cols;
+    int l = i + 2 * cols;
+
+    float r = fastSigmoid(xW[i] + sU[i] + b[i]);
+    float z = fastSigmoid(xW[k] + sU[k] + b[k]);
+
+    float h;
+    if(final)
+      h = fastTanh(xW[l] + (sU[l] + b[l]) * r);
+    else
+      h = fastTanh(xW[l] + sU[l] * r + b[l]);
+
+    float o = (1.0f - z) * h + z * state[i];
+    out[i] = m * o + (1 - m) * state[i];
+  }
+}
+
+// Gradients are first computed into local buffers and then added to those
+// outputs that exist, which keeps all loops free of branches
+template <bool final>
+void gruBackwardRow(float* __restrict__ outState,
+                    float* __restrict__ outXW,
+                    float* __restrict__ outSU,
+                    float* __restrict__ outB,
+                    const float* __restrict__ state,
+                    const float* __restrict__ xW,
+                    const float* __restrict__ sU,
+                    const float* __restrict__ b,
+                    const float* __restrict__ adj,
+                    float m,
+                    int cols,
+                    int begin,
+                    int end) {
+  float dState[GATE_BLOCK], dR[GATE_BLOCK], dZ[GATE_BLOCK], dX[GATE_BLOCK],
+      dXr[GATE_BLOCK];
+
+  for(int c0 = begin; c0 < end; c0 += GATE_BLOCK) {
+    int n = std::min(GATE_BLOCK, end - c0);
+    const float* xr = xW + c0;
+    const float* xz = xW + cols + c0;
+    const float* xh = xW + 2 * cols + c0;
+    const float* ur = sU + c0;
+    const float* uz = sU + cols + c0;
+    const float* uh = sU + 2 * cols + c0;
+    const float* br = b + c0;
+    const float* bz = b + cols + c0;
+    const float* bh = b + 2 * cols + c0;
+    const float* s = state + c0;
+    const float* a = adj + c0;
+
+    for(int i = 0; i < n; ++i) {
+      float r = fastSigmoid(xr[i] + ur[i] + br[i]);
+      float z = fastSigmoid(xz[i] + uz[i] + bz[i]);
+
+      float h;
+      if(final)
+        h = fastTanh(xh[i] + (uh[i] + bh[i]) * r);
+      else
+        h = fastTanh(xh[i] + uh[i] * r + bh[i]);
+
+      float t = (1 - z) * (1 - h * h);
+
+      // df/ds
+      dState[i] = (m * z - m + 1) * a[i];
+
+      // df/d(xW_r) ...
+      dR[i] = m * r * (1 - r) * t * a[i] * (final ? uh[i] + bh[i] : uh[i]);
+
+      // df/d(xW_z) ...
+      dZ[i] = m * (1 - z) * z * (s[i] - h) * a[i];
+
+      // df/d(xW_x) ...
+      dX[i] = m * t * a[i];
+      dXr[i] = dX[i] * r;
+    }
+
+    auto add = [n](float* out, const float* grad) {
+      for(int i = 0; i < n; ++i)
+        out[i] += grad[i];
+    };
+
+    if(outState)
+      add(outState + c0, dState);
+    if(outXW) {
+      add(outXW + c0, dR);
+      add(outXW + cols + c0, dZ);
+      add(outXW + 2 * cols + c0, dX);
+    }
+    if(outSU) {
+      add(outSU + c0, dR);
+      add(outSU + cols + c0, dZ);
+      add(outSU + 2 * cols + c0, dXr);
+    }
+    if(outB) {
+      add(outB + c0, dR);
+      add(outB + cols + c0, dZ);
+      add(outB + 2 * cols + c0, final ? dXr : dX);
+    }
+  }
+}
+
+// Runs body(row, c0, c1) over blocks of columns of single rows, so that
+// small batches still spread across threads
+template <class Body>
+void forEachRowBlock(int rows, int cols, Body body) {
+  int blocks = (cols + GATE_BLOCK - 1) / GATE_BLOCK;
+  int grain = std::max(1, MIN_GATES_PER_THREAD / std::min(cols, GATE_BLOCK));
+  parallelFor(rows * blocks, grain, [&](int begin, int end) {
+    for(int task = begin; task < end; ++task) {
+      int j = task / blocks;
+      int c0 = (task % blocks) * GATE_BLOCK;
+      body(j, c0, std::min(cols, c0 + GATE_BLOCK));
+    }
+  });
+}
+
+// Runs body(c0, c1) over ranges of columns, each covering all rows; the bias
+// gradient of a column is then only written by one thread.
+template <class Body>
+void forEachColumnBlock(int rows, int cols, Body body) {
+  int blocks = (cols + GATE_BLOCK - 1) / GATE_BLOCK;
+  int grain = std::max(
+      1, MIN_GATES_PER_THREAD / std::max(1, rows * std::min(cols, GATE_BLOCK)));
+  parallelFor(blocks, grain, [&](int begin, int end) {
+    body(begin * GATE_BLOCK, std::min(cols, end * GATE_BLOCK));
+  });
+}
+
+// Gates are stored as [forget | input | candidate | output] blocks of cols
+// columns each
+void lstmCellRow(float* __restrict__ out,
+                 const float* __restrict__ cell,
+                 const float* __restrict__ xW,
+                 const float* __restrict__ sU,
+                 const float* __restrict__ b,
+                 float m,
+                 int cols,
+                 int begin,
+                 int end) {
+  for(int i = begin; i < end; ++i) {
+    int k = i + cols;
+    int l = i + 2 * cols;
+
+    float gf = fastSigmoid(xW[i] + sU[i] + b[i]);
+    float gi = fastSigmoid(xW[k] + sU[k] + b[k]);
+    float gc = fastTanh(xW[l] + sU[l] + b[l]);
+
+    float c = gf * cell[i] + gi * gc;
+    out[i] = m * c + (1 - m) * cell[i];
+  }
+}
+
+void lstmOutputRow(float* __restrict__ out,
+                   const float* __restrict__ cell,
+                   const float* __restrict__ xW,
+                   const float* __restrict__ sU,
+                   const float* __restrict__ b,
+                   int cols,
+                   int begin,
+                   int end) {
+  for(int i = begin; i < end; ++i) {
+    int k = i + 3 * cols;
+    float go = fastSigmoid(xW[k] + sU[k] + b[k]);
+    out[i] = go * fastTanh(cell[i]);
+  }
+}
+
+void lstmCellBackwardRow(float* __restrict__ outCell,
+                         float* __restrict__ outXW,
+                         float* __restrict__ outSU,
+                         float* __restrict__ outB,
+                         const float* __restrict__ cell,
+                         const float* __restrict__ xW,
+                         const float* __restrict__ sU,
+                         const float* __restrict__ b,
+                         const float* __restrict__ adj,
+                         float m,
+                         int cols,
+                         int begin,
+                         int end) {
+  float dCell[GATE_BLOCK], dF[GATE_BLOCK], dI[GATE_BLOCK], dC[GATE_BLOCK];
+
+  for(int c0 = begin; c0 < end; c0 += GATE_BLOCK) {
+    int n = std::min(GATE_BLOCK, end - c0);
+    const float* xf = xW + c0;
+    const float* xi = xW + cols + c0;
+    const float* xc = xW + 2 * cols + c0;
+    const float* uf = sU + c0;
+    const float* ui = sU + cols + c0;
+    const float* uc = sU + 2 * cols + c0;
+    const float* bf = b + c0;
+    const float* bi = b + cols + c0;
+    const float* bc = b + 2 * cols + c0;
+    const float* c = cell + c0;
+    const float* a = adj + c0;
+
+    for(int i = 0; i < n; ++i) {
+      float gf = fastSigmoid(xf[i] + uf[i] + bf[i]);
+      float gi = fastSigmoid(xi[i] + ui[i] + bi[i]);
+      float gc = fastTanh(xc[i] + uc[i] + bc[i]);
+
+      // dc/dc_{t-1}
+      dCell[i] = (m * gf - m + 1) * a[i];
+
+      // dc/d(xW_f) ...
+      dF[i] = m * c[i] * gf * (1 - gf) * a[i];
+
+      // dc/d(xW_i) ...
+      dI[i] = m * gc * gi * (1 - gi) * a[i];
+
+      // dc/d(xW_c) ...
+      dC[i] = m * gi * (1 - gc * gc) * a[i];
+    }
+
+    auto add = [n](float* out, const float* grad) {
+      for(int i = 0; i < n; ++i)
+        out[i] += grad[i];
+    };
+
+    if(outCell)
+      add(outCell + c0, dCell);
+    for(float* out : {outXW, outSU, outB}) {
+      if(out) {
+        add(out + c0, dF);
+        add(out + cols + c0, dI);
+        add(out + 2 * cols + c0, dC);
+      }
+    }
+  }
+}
+
+void lstmOutputBackwardRow(float* __restrict__ outCell,
+                           float* __restrict__ outXW,
+                           float* __restrict__ outSU,
+                           float* __restrict__ outB,
+                           const float* __restrict__ cell,
+                           const float* __restrict__ xW,
+                           const float* __restrict__ sU,
+                           const float* __restrict__ b,
+                           const float* __restrict__ adj,
+                           int cols,
+                           int begin,
+                           int end) {
+  float dCell[GATE_BLOCK], dO[GATE_BLOCK];
+
+  for(int c0 = begin; c0 < end; c0 += GATE_BLOCK) {
+    int n = std::min(GATE_BLOCK, end - c0);
+    const float* xo = xW + 3 * cols + c0;
+    const float* uo = sU + 3 * cols + c0;
+    const float* bo = b + 3 * cols + c0;
+    const float* c = cell + c0;
+    const float* a = adj + c0;
+
+    for(int i = 0; i < n; ++i) {
+      float go = fastSigmoid(xo[i] + uo[i] + bo[i]);
+      float t = fastTanh(c[i]);
+
+      // dh/dc
+      dCell[i] = go * (1 - t * t) * a[i];
+
+      // dh/d(xW_o) ...
+      dO[i] = t * go * (1 - go) * a[i];
+    }
+
+    auto add = [n](float* out, const float* grad) {
+      for(int i = 0; i < n; ++i)
+        out[i] += grad[i];
+    };
+
+    if(outCell)
+      add(outCell + c0, dCell);
+    for(float* out : {outXW, outSU, outB})
+      if(out)
+        add(out + 3 * cols + c0, dO);
+  }
+}
+}
+
+void GRUFastForward(Tensor out, std::vector<Tensor> inputs, bool final) {
+  int rows = out->shape()[0] * out->shape()[2] * out->shape()[3];
+  int cols = out->shape()[1];
+
+  float* o = out->data();
+  const float* state = inputs[0]->data();
+  const float* xW = inputs[1]->data();
+  const float* sU = inputs[2]->data();
+  const float* b = inputs[3]->data();
+  const float* mask = inputs.size() > 4 ? inputs[4]->data() : nullptr;
+
+  auto row = final ? gruForwardRow<true> : gruForwardRow<false>;
+  forEachRowBlock(rows, cols, [&](int j, int c0, int c1) {
+    float m = !mask || mask[j];
+    row(o + (size_t)j * cols,
+        state + (size_t)j * cols,
+        xW + (size_t)j * cols * 3,
+        sU + (size_t)j * cols * 3,
+        b, m, cols, c0, c1);
+  });
+}
+
+void GRUFastBackward(std::vector<Tensor> outputs,
+                     std::vector<Tensor> inputs,
+                     Tensor adj,
+                     bool final) {
+  int rows = adj->shape()[0] * adj->shape()[2] * adj->shape()[3];
+  int cols = adj->shape()[1];
+
+  float* outState = outputs[0] ? outputs[0]->data() : nullptr;
+  float* outXW = outputs[1] ? outputs[1]->data() : nullptr;
+  float* outSU = outputs[2] ? outputs[2]->data() : nullptr;
+  float* outB = outputs[3] ? outputs[3]->data() : nullptr;
+
+  const float* state = inputs[0]->data();
+  const float* xW = inputs[1]->data();
+  const float* sU = inputs[2]->data();
+  const float* b = inputs[3]->data();
+  const float* mask = inputs.size() > 4 ? inputs[4]->data() : nullptr;
+  const float* a = adj->data();
+
+  auto backwardRow = final ? gruBackwardRow<true> : gruBackwardRow<false>;
+  forEachColumnBlock(rows, cols, [&](int c0, int c1) {
+    for(int j = 0; j < rows; ++j) {
+      float m = !mask || mask[j];
+      size_t row = (size_t)j * cols;
+      backwardRow(outState ? outState + row : nullptr,
+                  outXW ? outXW + row * 3 : nullptr,
+                  outSU ? outSU + row * 3 : nullptr,
+                  outB,
+                  state + row,
+                  xW + row * 3,
+                  sU + row * 3,
+                  b,
+                  a + row,
+                  m, cols, c0, c1);
+    }
+  });
+}
+
+void LSTMCellForward(Tensor out, std::vector<Tensor> inputs) {
+  int rows = out->shape()[0] * out->shape()[2] * out->shape()[3];
+  int cols = out->shape()[1];
+
+  float* o = out->data();
+  const float* cell = inputs[0]->data();
+  const float* xW = inputs[1]->data();
+  const float* sU = inputs[2]->data();
+  const float* b = inputs[3]->data();
+  const float* mask = inputs.size() > 4 ? inputs[4]->data() : nullptr;
+
+  forEachRowBlock(rows, cols, [&](int j, int c0, int c1) {
+    float m = !mask || mask[j];
+    lstmCellRow(o + (size_t)j * cols,
+                cell + (size_t)j * cols,
+                xW + (size_t)j * cols * 4,
+                sU + (size_t)j * cols * 4,
+                b, m, cols, c0, c1);
+  });
+}
+
+void LSTMOutputForward(Tensor out, std::vector<Tensor> inputs) {
+  int rows = out->shape()[0] * out->shape()[2] * out->shape()[3];
+  int cols = out->shape()[1];
+
+  float* o = out->data();
+  const float* cell = inputs[0]->data();
+  const float* xW = inputs[1]->data();
+  const float* sU = inputs[2]->data();
+  const float* b = inputs[3]->data();
+
+  forEachRowBlock(rows, cols, [&](int j, int c0, int c1) {
+    lstmOutputRow(o + (size_t)j * cols,
+                  cell + (size_t)j * cols,
+                  xW + (size_t)j * cols * 4,
+                  sU + (size_t)j * cols * 4,
+                  b, cols, c0, c1);
+  });
+}
+
+void LSTMCellBackward(std::vector<Tensor> outputs,
+                      std::vector<Tensor> inputs,
+                      Tensor adj) {
+  int rows = adj->shape()[0] * adj->shape()[2] * adj->shape()[3];
+  int cols = adj->shape()[1];
+
+  float* outCell = outputs[0] ? outputs[0]->data() : nullptr;
+  float* outXW = outputs[1] ? outputs[1]->data() : nullptr;
+  float* outSU = outputs[2] ? outputs[2]->data() : nullptr;
+  float* outB = outputs[3] ? outputs[3]->data() : nullptr;
+
+  const float* cell = inputs[0]->data();
+  const float* xW = inputs[1]->data();
+  const float* sU = inputs[2]->data();
+  const float* b = inputs[3]->data();
+  const float* mask = inputs.size() > 4 ? inputs[4]->data() : nullptr;
+  const float* a = adj->data();
+
+  forEachColumnBlock(rows, cols, [&](int c0, int c1) {
+    for(int j = 0; j < rows; ++j) {
+      float m = !mask || mask[j];
+      size_t row = (size_t)j * cols;
+      lstmCellBackwardRow(outCell ? outCell + row : nullptr,
+                          outXW ? outXW + row * 4 : nullptr,
+                          outSU ? outSU + row * 4 : nullptr,
+                          outB,
+                          cell + row,
+                          xW + row * 4,
+                          sU + row * 4,
+                          b,
+                          a + row,
+                          m, cols, c0, c1);
+    }
+  });
+}
+
+void LSTMOutputBackward(std::vector<Tensor> outputs,
+                        std::vector<Tensor> inputs,
+                        Tensor adj) {
+  int rows = adj->shape()[0] * adj->shape()[2] * adj->shape()[3];
+  int cols = adj->shape()[1];
+
+  float* outCell = outputs[0] ? outputs[0]->data() : nullptr;
+  float* outXW = outputs[1] ? outputs[1]->data() : nullptr;
+  float* outSU = outputs[2] ? outputs[2]->data() : nullptr;
+  float* outB = outputs[3] ? outputs[3]->data() : nullptr;
+
+  const float* cell = inputs[0]->data();
+  const float* xW = inputs[1]->data();
+  const float* sU = inputs[2]->data();
+  const float* b = inputs[3]->data();
+  const float* a = adj->data();
+
+  forEachColumnBlock(rows, cols, [&](int c0, int c1) {
+    for(int j = 0; j < rows; ++j) {
+      size_t row = (size_t)j * cols;
+      lstmOutputBackwardRow(outCell ? outCell + row : nullptr,
+                            outXW ? outXW + row * 4 : nullptr,
+                            outSU ? outSU + row * 4 : nullptr,
+                            outB,
+                            cell + row,
+                            xW + row * 4,
+                            sU + row * 4,
+                            b,
+                            a + row,
+                            cols, c0, c1);
+    }
+  });
+}
+}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief Host counterpart of GRUFastForward in kernels/tensor_operators.h.
+ *
+ * inputs are the previous state, x*W, s*U, the bias and optionally a mask
+ * with one value per row. Each row is processed in a single pass, the loop
+ * over the state dimension is vectorised and rows are spread across
+ * threads.
+ */
+void GRUFastForward(Tensor out, std::vector<Tensor> inputs, bool final = false);
+
+/**
+ * @brief Host counterpart of GRUFastBackward in kernels/tensor_operators.h,
+ * gradients are added to the non-null tensors in outputs. Threads work on
+ * disjoint ranges of the state dimension so that the bias gradient needs no
+ * synchronisation.
+ */
+void GRUFastBackward(std::vector<Tensor> outputs,
+                     std::vector<Tensor> inputs,
+                     Tensor adj,
+                     bool final = false);
+
+/**
+ * @brief Host counterparts of LSTMCellForward and LSTMOutputForward in
+ * kernels/tensor_operators.h.
+ *
+ * inputs are the previous cell state (the new cell state for the output),
+ * x*W, s*U, the bias and optionally a mask with one value per row. The
+ * forget, input and candidate gates of a row are computed in a single pass,
+ * the output gate in one pass over the new cell state.
+ */
+void LSTMCellForward(Tensor out, std::vector<Tensor> inputs);
+void LSTMOutputForward(Tensor out, std::vector<Tensor> inputs);
+
+/**
+ * @brief Host counterparts of LSTMCellBackward and LSTMOutputBackward in
+ * kernels/tensor_operators.h, split across threads like GRUFastBackward.
+ */
+void LSTMCellBackward(std::vector<Tensor> outputs,
+                      std::vector<Tensor> inputs,
+                      Tensor adj);
+void LSTMOutputBackward(std::vector<Tensor> outputs,
+                        std::vector<Tensor> inputs,
+                        Tensor adj);
+}
+}
@@ -0,0 +1,322 @@
+#include "kernels/softmax_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "kernels/math_cpu.h"
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+// Reductions keep LANES partial results so that they are vectorised without
+// -ffast-math. Rows are processed in chunks that stay in L1 between
+// computing their maximum and their exponentials.
+const int LANES = 16;
+const int CHUNK = 2048;
+const float LOWEST = -std::numeric_limits<float>::max();
+
+inline float maxOf(const float* __restrict__ x, int n) {
+  float m[LANES];
+  std::fill(m, m + LANES, LOWEST);
+  int i = 0;
+  for(; i + LANES <= n; i += LANES)
+    for(int l = 0; l < LANES; ++l)
+      m[l] = x[i + l] > m[l] ? x[i + l] : m[l];
+
+  float max = LOWEST;
+  for(int l = 0; l < LANES; ++l)
+    max = std::max(max, m[l]);
+  for(; i < n; ++i)
+    max = std::max(max, x[i]);
+  return max;
+}
+
+// Sums in double, the gradient of log-softmax scales every entry by the sum
+// of a row of gradients, which has a large error in float for long rows
+inline float sumOf(const float* __restrict__ x, int n) {
+  double s[LANES] = {};
+  int i = 0;
+  for(; i + LANES <= n; i += LANES)
+    for(int l = 0; l < LANES; ++l)
+      s[l] += x[i + l];
+
+  double sum = 0;
+  for(int l = 0; l < LANES; ++l)
+    sum += s[l];
+  for(; i < n; ++i)
+    sum += x[i];
+  return sum;
+}
+
+// Sum of exp(x - max), the exponentials are also stored to out if given
+template <class Exp>
+inline float sumExp(const float* __restrict__ x,
+                    int n,
+                    float max,
+                    float* __restrict__ out) {
+  Exp exp;
+  float s[LANES] = {};
+  int i = 0;
+  if(out) {
+    for(; i + LANES <= n; i += LANES) {
+      for(int l = 0; l < LANES; ++l) {
+        float e = exp(x[i + l] - max);
+        out[i + l] = e;
+        s[l] += e;
+      }
+    }
+  } else {
+    for(; i + LANES <= n; i += LANES)
+      for(int l = 0; l < LANES; ++l)
+        s[l] += exp(x[i + l] - max);
+  }
+
+  float sum = 0;
+  for(int l = 0; l < LANES; ++l)
+    sum += s[l];
+  for(; i < n; ++i) {
+    float e = exp(x[i] - max);
+    if(out)
+      out[i] = e;
+    sum += e;
+  }
+  return sum;
+}
+
+struct RowStats {
+  float max;
+  float sum;  // of exp(x - max)
+};
+
+// Maximum and sum of exponentials of a row in one pass over memory. If out
+// is given, exp(x - m) is stored for each chunk with m the running maximum
+// at that chunk, recorded in chunkMax.
+template <class Exp>
+RowStats rowStats(const float* x, int n, float* out, float* chunkMax) {
+  float max = LOWEST;
+  float sum = 0;
+  for(int c0 = 0, c = 0; c0 < n; c0 += CHUNK, ++c) {
+    int len = std::min(CHUNK, n - c0);
+    float m = std::max(max, maxOf(x + c0, len));
+    sum = sum * Exp()(max - m)
+          + sumExp<Exp>(x + c0, len, m, out ? out + c0 : nullptr);
+    max = m;
+    if(chunkMax)
+      chunkMax[c] = m;
+  }
+  return {max, sum};
+}
+
+inline int rows(Tensor t) {
+  return t->shape()[0] * t->shape()[2] * t->shape()[3];
+}
+
+inline int grain(int cols) {
+  return std::max(1, MIN_ELEMENTS_PER_THREAD / std::max(1, cols));
+}
+
+template <class Exp>
+void softmax(Tensor out, Tensor in, Tensor mask) {
+  int m = rows(out);
+  int k = out->shape()[1];
+
+  float* o = out->data();
+  const float* x = in->data();
+
+  parallelFor(m, grain(k), [&](int begin, int end) {
+    static thread_local std::vector<float> chunkMax;
+    static thread_local std::vector<float> masked;
+    chunkMax.resize(k / CHUNK + 1);
+
+    for(int j = begin; j < end; ++j) {
+      const float* row = x + (size_t)j * k;
+      float* so = o + (size_t)j * k;
+
+      // masked entries are excluded from maximum and sum and set to 0
+      const float* mrow = nullptr;
+      int mstride = 0;
+      if(mask) {
+        mrow = mask->data() + rowOffset(mask->shape(), out->shape(), j);
+        mstride = mask->shape()[1] == 1 ? 0 : 1;
+        masked.resize(k);
+        for(int i = 0; i < k; ++i)
+          masked[i] = mrow[i * mstride] ? row[i] : LOWEST;
+        row = masked.data();
+      }
+
+      RowStats stats = rowStats<Exp>(row, k, so, chunkMax.data());
+      for(int c0 = 0, c = 0; c0 < k; c0 += CHUNK, ++c) {
+        int len = std::min(CHUNK, k - c0);
+        float scale = fastExp(chunkMax[c] - stats.max) / stats.sum;
+        for(int i = c0; i < c0 + len; ++i)
+          so[i] *= scale;
+      }
+
+      if(mask)
+        for(int i = 0; i < k; ++i)
+          so[i] = mrow[i * mstride] ? so[i] : 0.f;
+    }
+  });
+}
+
+template <class Exp>
+void logSoftmax(Tensor out, Tensor in) {
+  int m = rows(out);
+  int k = out->shape()[1];
+
+  float* o = out->data();
+  const float* x = in->data();
+
+  parallelFor(m, grain(k), [&](int begin, int end) {
+    for(int j = begin; j < end; ++j) {
+      const float* row = x + (size_t)j * k;
+      float* so = o + (size_t)j * k;
+
+      RowStats stats = rowStats<Exp>(row, k, nullptr, nullptr);
+      float shift = stats.max + std::log(stats.sum);
+      for(int i = 0; i < k; ++i)
+        so[i] = row[i] - shift;
+    }
+  });
+}
+
+template <class Exp>
+void logSoftmaxGrad(Tensor grad, Tensor adj, Tensor val) {
+  int m = rows(grad);
+  int k = grad->shape()[1];
+
+  float* g = grad->data();
+  const float* a = adj->data();
+  const float* v = val->data();
+
+  parallelFor(m, grain(k), [&](int begin, int end) {
+    Exp exp;
+    for(int j = begin; j < end; ++j) {
+      float* gradRow = g + (size_t)j * k;
+      const float* adjRow = a + (size_t)j * k;
+      const float* valRow = v + (size_t)j * k;
+
+      float sum = sumOf(adjRow, k);
+      for(int i = 0; i < k; ++i)
+        gradRow[i] += adjRow[i] - exp(valRow[i]) * sum;
+    }
+  });
+}
+
+template <class Exp>
+void crossEntropyPick(Tensor out, Tensor in, Tensor pick) {
+  int m = rows(in);
+  int k = in->shape()[1];
+
+  float* o = out->data();
+  const float* x = in->data();
+  const float* p = pick->data();
+
+  parallelFor(m, grain(k), [&](int begin, int end) {
+    for(int j = begin; j < end; ++j) {
+      const float* row = x + (size_t)j * k;
+      RowStats stats = rowStats<Exp>(row, k, nullptr, nullptr);
+      o[j] = std::log(stats.sum) - row[(int)p[j]] + stats.max;
+    }
+  });
+}
+
+template <class Exp>
+void crossEntropyPickBackward(Tensor out, Tensor adj, Tensor a, Tensor pick) {
+  int m = rows(out);
+  int k = out->shape()[1];
+
+  float* o = out->data();
+  const float* d = adj->data();
+  const float* x = a->data();
+  const float* p = pick->data();
+
+  parallelFor(m, grain(k), [&](int begin, int end) {
+    Exp exp;
+    for(int j = begin; j < end; ++j) {
+      const float* row = x + (size_t)j * k;
+      float* so = o + (size_t)j * k;
+
+      RowStats stats = rowStats<Exp>(row, k, nullptr, nullptr);
+      float scale = d[j] / stats.sum;
+      for(int i = 0; i < k; ++i)
+        so[i] += scale * exp(row[i] - stats.max);
+      so[(int)p[j]] -= d[j];
+    }
+  });
+}
+}
+
+void Softmax(Tensor out, Tensor in, Tensor mask) {
+  if(expAccuracy() == ExpAccuracy::approximate)
+    softmax<ApproxExp>(out, in, mask);
+  else
+    softmax<FullExp>(out, in, mask);
+}
+
+void LogSoftmax(Tensor out, Tensor in) {
+  if(expAccuracy() == ExpAccuracy::approximate)
+    logSoftmax<ApproxExp>(out, in);
+  else
+    logSoftmax<FullExp>(out, in);
+}
+
+void SoftmaxGrad(Tensor grad, Tensor adj, Tensor val) {
+  int m = rows(grad);
+  int k = grad->shape()[1];
+
+  float* g = grad->data();
+  const float* a = adj->data();
+  const float* v = val->data();
+
+  // grad += val * (adj - sum(val * adj)) for each row
+  parallelFor(m, grain(k), [&](int begin, int end) {
+    for(int j = begin; j < end; ++j) {
+      float* gradRow = g + (size_t)j * k;
+      const float* adjRow = a + (size_t)j * k;
+      const float* valRow = v + (size_t)j * k;
+
+      float s[LANES] = {};
+      int i = 0;
+      for(; i + LANES <= k; i += LANES)
+        for(int l = 0; l < LANES; ++l)
+          s[l] += valRow[i + l] * adjRow[i + l];
+      float sum = 0;
+      for(int l = 0; l < LANES; ++l)
+        sum += s[l];
+      for(; i < k; ++i)
+        sum += valRow[i] * adjRow[i];
+
+      for(i = 0; i < k; ++i)
+        gradRow[i] += valRow[i] * (adjRow[i] - sum);
+    }
+  });
+}
+
+void LogSoftmaxGrad(Tensor grad, Tensor adj, Tensor val) {
+  if(expAccuracy() == ExpAccuracy::approximate)
+    logSoftmaxGrad<ApproxExp>(grad, adj, val);
+  else
+    logSoftmaxGrad<FullExp>(grad, adj, val);
+}
+
+void CrossEntropyPick(Tensor out, Tensor in, Tensor pick) {
+  if(expAccuracy() == ExpAccuracy::approximate)
+    crossEntropyPick<ApproxExp>(out, in, pick);
+  else
+    crossEntropyPick<FullExp>(out, in, pick);
+}
+
+void CrossEntropyPickBackward(Tensor out, Tensor adj, Tensor a, Tensor pick) {
+  if(expAccuracy() == ExpAccuracy::approximate)
+    crossEntropyPickBackward<ApproxExp>(out, adj, a, pick);
+  else
+    crossEntropyPickBackward<FullExp>(out, adj, a, pick);
+}
+}
+}
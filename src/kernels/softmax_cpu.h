@@ -0,0 +1,35 @@
+#pragma once
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * Host counterparts of the softmax kernels in kernels/tensor_operators.h.
+ *
+ * Rows are read from memory once to compute their maximum and sum of
+ * exponentials: both are kept as running values over cache-sized chunks and
+ * the sum is rescaled whenever the maximum grows. Rows are spread across
+ * threads. Exponentials use fastExp or approxExp as selected by
+ * expAccuracy() in kernels/math_cpu.h.
+ */
+
+void Softmax(Tensor out, Tensor in, Tensor mask = nullptr);
+void LogSoftmax(Tensor out, Tensor in);
+
+void SoftmaxGrad(Tensor grad, Tensor adj, Tensor val);
+void LogSoftmaxGrad(Tensor grad, Tensor adj, Tensor val);
+
+/**
+ * @brief out[j] = -log softmax(in[j])[pick[j]] without storing the softmax
+ */
+void CrossEntropyPick(Tensor out, Tensor in, Tensor pick);
+
+/**
+ * @brief out[j] += adj[j] * (softmax(a[j]) - onehot(pick[j])), recomputing
+ * the softmax on the fly
+ */
+void CrossEntropyPickBackward(Tensor out, Tensor adj, Tensor a, Tensor pick);
+}
+}
@@ -0,0 +1,120 @@
+#include "kernels/stats.h"
+
+#include <algorithm>
+
+#include "kernels/cuda_helpers.h"
+#include "kernels/stats_cpu.h"
+#include "kernels/tensor_operators.h"
+
+namespace marian {
+
+__global__ void gValueStats(float* out,
+                            const float* in,
+                            const size_t* slices,
+                            int n) {
+  for(int bid = 0; bid < n; bid += gridDim.x) {
+    int j = bid + blockIdx.x;
+    if(j < n) {
+      const float* sp = in + slices[2 * j];
+      size_t size = slices[2 * j + 1];
+
+      extern __shared__ float _share[];
+      float* _min = _share + STAT_MIN * blockDim.x;
+      float* _max = _share + STAT_MAX * blockDim.x;
+      float* _sum = _share + STAT_SUM * blockDim.x;
+      float* _nans = _share + STAT_NANS * blockDim.x;
+      float* _infs = _share + STAT_INFS * blockDim.x;
+
+      // NaNs and infinities are told apart by their bits like on the host
+      float min = 3.40282347e+38f;
+      float max = -3.40282347e+38f;
+      float sum = 0.f;
+      float nans = 0.f;
+      float infs = 0.f;
+      for(size_t tid = 0; tid < size; tid += blockDim.x) {
+        size_t id = tid + threadIdx.x;
+        if(id < size) {
+          float x = sp[id];
+          unsigned int bits = __float_as_uint(x);
+          if((bits & 0x7f800000u) == 0x7f800000u) {
+            if(bits & 0x007fffffu)
+              nans += 1.f;
+            else
+              infs += 1.f;
+          } else {
+            min = fminf(min, x);
+            max = fmaxf(max, x);
+            sum += x;
+          }
+        }
+      }
+      _min[threadIdx.x] = min;
+      _max[threadIdx.x] = max;
+      _sum[threadIdx.x] = sum;
+      _nans[threadIdx.x] = nans;
+      _infs[threadIdx.x] = infs;
+      __syncthreads();
+
+      int len = blockDim.x;
+      while(len != 1) {
+        __syncthreads();
+        int skip = (len + 1) >> 1;
+        if(threadIdx.x < (len >> 1)) {
+          int k = threadIdx.x + skip;
+          _min[threadIdx.x] = fminf(_min[threadIdx.x], _min[k]);
+          _max[threadIdx.x] = fmaxf(_max[threadIdx.x], _max[k]);
+          _sum[threadIdx.x] += _sum[k];
+          _nans[threadIdx.x] += _nans[k];
+          _infs[threadIdx.x] += _infs[k];
+        }
+        len = (len + 1) >> 1;
+      }
+      __syncthreads();
+
+      if(threadIdx.x < VALUE_STATS)
+        out[j * VALUE_STATS + threadIdx.x] = _share[threadIdx.x * blockDim.x];
+      __syncthreads();
+    }
+  }
+}
+
+void ValueStats(std::vector<float>& out,
+                Tensor in,
+                const std::vector<size_t>& slices) {
+  if(in->getDeviceType() == DeviceType::cpu) {
+    cpu::ValueStats(out, in, slices);
+    return;
+  }
+
+  cudaSetDevice(in->getDevice());
+
+  int n = slices.size() / 2;
+  out.resize(n * VALUE_STATS);
+  if(n == 0)
+    return;
+
+  int threads = MAX_THREADS;
+  int blocks = std::min(MAX_BLOCKS, n);
+  int shared = sizeof(float) * threads * VALUE_STATS;
+
+  size_t* d_slices;
+  float* d_out;
+  CUDA_CHECK(cudaMalloc(&d_slices, slices.size() * sizeof(size_t)));
+  CUDA_CHECK(cudaMalloc(&d_out, out.size() * sizeof(float)));
+  CUDA_CHECK(cudaMemcpy(d_slices,
+                        slices.data(),
+                        slices.size() * sizeof(size_t),
+                        cudaMemcpyHostToDevice));
+
+  gValueStats<<<blocks, threads, shared>>>(d_out, in->data(), d_slices, n);
+
+  // waits for the kernel, only the statistics cross the bus
+  CUDA_CHECK(cudaMemcpy(out.data(),
+                        d_out,
+                        out.size() * sizeof(float),
+                        cudaMemcpyDeviceToHost));
+
+  CUDA_CHECK(cudaFree(d_slices));
+  CUDA_CHECK(cudaFree(d_out));
+}
+}
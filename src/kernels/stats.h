@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+#include "tensors/tensor.h"
+
+namespace marian {
+
+/** @brief Layout of the statistics of a slice written by ValueStats */
+enum ValueStat {
+  STAT_MIN,
+  STAT_MAX,
+  STAT_SUM,
+  STAT_NANS,
+  STAT_INFS,
+  VALUE_STATS
+};
+
+/**
+ * @brief Minimum, maximum and sum of the finite values and the counts of NaNs
+ * and infinities of slices of in, computed on the device of in.
+ *
+ * slices holds pairs of offset and size in elements. Only the VALUE_STATS
+ * floats of each slice are copied to out, in the order of ValueStat.
+ */
+void ValueStats(std::vector<float>& out,
+                Tensor in,
+                const std::vector<size_t>& slices);
+}
@@ -0,0 +1,93 @@
+#include "kernels/stats_cpu.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "kernels/stats.h"
+#include "kernels/tensor_operators_cpu.h"
+
+namespace marian {
+namespace cpu {
+
+namespace {
+
+const size_t BLOCK = 1 << 16;
+
+struct Block {
+  size_t slice;
+  size_t begin;
+  size_t end;
+};
+
+inline void mergeStats(float* into, const float* stats) {
+  into[STAT_MIN] = std::min(into[STAT_MIN], stats[STAT_MIN]);
+  into[STAT_MAX] = std::max(into[STAT_MAX], stats[STAT_MAX]);
+  into[STAT_SUM] += stats[STAT_SUM];
+  into[STAT_NANS] += stats[STAT_NANS];
+  into[STAT_INFS] += stats[STAT_INFS];
+}
+}
+
+void valueStats(const float* data, size_t size, float* stats) {
+  float min = std::numeric_limits<float>::max();
+  float max = std::numeric_limits<float>::lowest();
+  double sum = 0;
+  size_t nans = 0;
+  size_t infs = 0;
+  for(size_t i = 0; i < size; ++i) {
+    float x = data[i];
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    if((bits & 0x7f800000u) == 0x7f800000u) {
+      if(bits & 0x007fffffu)
+        nans++;
+      else
+        infs++;
+    } else {
+      min = std::min(min, x);
+      max = std::max(max, x);
+      sum += x;
+    }
+  }
+  stats[STAT_MIN] = min;
+  stats[STAT_MAX] = max;
+  stats[STAT_SUM] = sum;
+  stats[STAT_NANS] = nans;
+  stats[STAT_INFS] = infs;
+}
+
+void ValueStats(std::vector<float>& out,
+                Tensor in,
+                const std::vector<size_t>& slices) {
+  size_t n = slices.size() / 2;
+
+  std::vector<Block> blocks;
+  for(size_t i = 0; i < n; ++i)
+    for(size_t b = 0; b == 0 || b < slices[2 * i + 1]; b += BLOCK)
+      blocks.push_back({i, b, std::min(b + BLOCK, slices[2 * i + 1])});
+
+  std::vector<float> partial(blocks.size() * VALUE_STATS);
+  const float* data = in->data();
+  parallelFor(blocks.size(), 1, [&](int begin, int end) {
+    for(int k = begin; k < end; ++k) {
+      auto& block = blocks[k];
+      valueStats(data + slices[2 * block.slice] + block.begin,
+                 block.end - block.begin,
+                 partial.data() + k * VALUE_STATS);
+    }
+  });
+
+  // blocks of a slice are adjacent and merged in order
+  out.assign(n * VALUE_STATS, 0.f);
+  for(size_t i = 0; i < n; ++i) {
+    out[i * VALUE_STATS + STAT_MIN] = std::numeric_limits<float>::max();
+    out[i * VALUE_STATS + STAT_MAX] = std::numeric_limits<float>::lowest();
+  }
+  for(size_t k = 0; k < blocks.size(); ++k)
+    mergeStats(out.data() + blocks[k].slice * VALUE_STATS,
+               partial.data() + k * VALUE_STATS);
+}
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+#include "tensors/tensor.h"
+
+namespace marian {
+namespace cpu {
+
+/**
+ * @brief Statistics of data[0, size) in the layout of ValueStats in
+ * kernels/stats.h. NaNs and infinities are told apart by their bits since
+ * std::isnan and std::isinf are folded to false under -ffinite-math-only.
+ */
+void valueStats(const float* data, size_t size, float* stats);
+
+/**
+ * @brief Host counterpart of ValueStats in kernels/stats.h, large slices are
+ * split into blocks that are spread across threads.
+ */
+void ValueStats(std::vector<float>& out,
+                Tensor in,
+                const std::vector<size_t>& slices);
+}
+}
@@ -1,7 +1,15 @@
 
+#include <cstring>
+
 #include <thrust/transform_reduce.h>
 
+#include "kernels/attention_cpu.h"
 #include "kernels/cuda_helpers.h"
+#include "kernels/fused_cpu.h"
+#include "kernels/normalization_cpu.h"
+#include "kernels/prod_cpu.h"
+#include "kernels/rnn_cpu.h"
+#include "kernels/softmax_cpu.h"
 #include "kernels/tensor_operators.h"
 
 #include "3rd_party/reduce_all.h"
@@ -17,6 +25,15 @@ struct isnan_test {
 };
 
 bool IsNan(Tensor in) {
+  // NaNs are found by their bits, std::isnan is folded to false when the
+  // host compiler gets -ffinite-math-only
+  if(in->getDeviceType() == DeviceType::cpu)
+    return std::any_of(in->data(), in->data() + in->size(), [](float x) {
+      uint32_t bits;
+      std::memcpy(&bits, &x, sizeof(bits));
+      return (bits & 0x7fffffffu) > 0x7f800000u;
+    });
+
   thrust::device_ptr<float> begin = thrust::device_pointer_cast(in->data());
   thrust::device_ptr<float> end = thrust::device_pointer_cast(in->data() + in->size());
   return thrust::transform_reduce(begin, end, isnan_test(), 0, thrust::plus<bool>());
@@ -124,6 +141,11 @@ __global__ void gSoftmax(float* out,
 }
 
 void Softmax(Tensor out, Tensor in, Tensor mask) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Softmax(out, in, mask);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   size_t m = out->shape()[0] * out->shape()[2] * out->shape()[3];
@@ -212,6 +234,11 @@ __global__ void gLogSoftmax(float* out,
 }
 
 void LogSoftmax(Tensor out, Tensor in) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::LogSoftmax(out, in);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   size_t m = out->shape()[0] * out->shape()[2] * out->shape()[3];
@@ -271,6 +298,11 @@ __global__ void gSoftmaxGrad(float* grad,
 }
 
 void SoftmaxGrad(Tensor grad, Tensor adj, Tensor val) {
+  if(adj->getDeviceType() == DeviceType::cpu) {
+    cpu::SoftmaxGrad(grad, adj, val);
+    return;
+  }
+
   cudaSetDevice(adj->getDevice());
   // grad and val are both m-by-k matrices, passed as input.
   // A weighted average of each row of grad (according to the weights
@@ -327,6 +359,11 @@ __global__ void gLogSoftmaxGrad(float* grad,
 }
 
 void LogSoftmaxGrad(Tensor grad, Tensor adj, Tensor val) {
+  if(adj->getDeviceType() == DeviceType::cpu) {
+    cpu::LogSoftmaxGrad(grad, adj, val);
+    return;
+  }
+
   cudaSetDevice(adj->getDevice());
 
   // grad and val are both m-by-k matrices, passed as input.
@@ -384,6 +421,11 @@ void Prod(cublasHandle_t handle,
           bool transB,
           float beta,
           float scalar) {
+  if(C->getDeviceType() == DeviceType::cpu) {
+    cpu::Prod(C, A, B, transA, transB, beta, scalar);
+    return;
+  }
+
   cudaSetDevice(C->getDevice());
   float alpha = scalar;
 
@@ -432,6 +474,11 @@ void ProdBatched(
           bool transB,
           float beta,
           float scalar) {
+  if(C->getDeviceType() == DeviceType::cpu) {
+    cpu::ProdBatched(C, A, B, transA, transB, beta, scalar);
+    return;
+  }
+
   cudaSetDevice(C->getDevice());
   float alpha = scalar;
 
@@ -922,6 +969,11 @@ __global__ void gGRUFastForward(float* out,
 }
 
 void GRUFastForward(Tensor out, std::vector<Tensor> inputs, bool final) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::GRUFastForward(out, inputs, final);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int rows = out->shape()[0] * out->shape()[2] * out->shape()[3];
@@ -1038,6 +1090,11 @@ void GRUFastBackward(std::vector<Tensor> outputs,
                      std::vector<Tensor> inputs,
                      Tensor adj,
                      bool final) {
+  if(adj->getDeviceType() == DeviceType::cpu) {
+    cpu::GRUFastBackward(outputs, inputs, adj, final);
+    return;
+  }
+
   cudaSetDevice(adj->getDevice());
 
   int rows = adj->shape()[0] * adj->shape()[2] * adj->shape()[3];
@@ -1132,6 +1189,11 @@ __global__ void gCrossEntropyPick(float* out,
 }
 
 void CrossEntropyPick(Tensor out, Tensor in, Tensor pick) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::CrossEntropyPick(out, in, pick);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   size_t m = in->shape()[0] * in->shape()[2] * in->shape()[3];
@@ -1218,6 +1280,11 @@ __global__ void gCrossEntropyPickBackward(float* out,
 }
 
 void CrossEntropyPickBackward(Tensor out, Tensor adj, Tensor a, Tensor pick) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::CrossEntropyPickBackward(out, adj, a, pick);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   size_t m = out->shape()[0] * out->shape()[2] * out->shape()[3];
@@ -1294,6 +1361,11 @@ __global__ void gAtt(float* out,
 }
 
 void Att(Tensor out, Tensor va, Tensor context, Tensor state, Tensor coverage) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Att(out, va, context, state, coverage);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   size_t m = out->shape()[0] * out->shape()[2] * out->shape()[3];
@@ -1373,6 +1445,12 @@ void AttBack(Tensor gVa,
              Tensor state,
              Tensor coverage,
              Tensor adj) {
+  if(adj->getDeviceType() == DeviceType::cpu) {
+    cpu::AttBack(gVa, gContext, gState, gCoverage, va, context, state, coverage,
+                 adj);
+    return;
+  }
+
   cudaSetDevice(adj->getDevice());
 
   size_t m = context->shape()[0] * context->shape()[2] * context->shape()[3];
@@ -1474,6 +1552,11 @@ __global__ void gLNormalization(float* out,
 
 void LayerNormalization(
     Tensor out, Tensor in, Tensor gamma, Tensor beta, float eps) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::LayerNormalization(out, in, gamma, beta, eps);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int rows = in->shape()[0] * in->shape()[2] * in->shape()[3];
@@ -1598,6 +1681,12 @@ void LayerNormalizationGrad(Tensor gradX,
                             Tensor x,
                             Tensor gamma,
                             Tensor beta) {
+  if(adj->getDeviceType() == DeviceType::cpu) {
+    cpu::LayerNormalizationGrad(
+        gradX, gradGamma, gradBeta, adj, y, x, gamma, beta);
+    return;
+  }
+
   cudaSetDevice(adj->getDevice());
   int rows = y->shape()[0] * y->shape()[2] * y->shape()[3];
   int cols = y->shape()[1];
@@ -1732,6 +1821,11 @@ __global__ void gLSTMCellForward(float* out,
 }
 
 void LSTMCellForward(Tensor out, std::vector<Tensor> inputs) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::LSTMCellForward(out, inputs);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int rows = out->shape()[0] * out->shape()[2] * out->shape()[3];
@@ -1782,6 +1876,11 @@ __global__ void gLSTMOutputForward(float* out,
 }
 
 void LSTMOutputForward(Tensor out, std::vector<Tensor> inputs) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::LSTMOutputForward(out, inputs);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int rows = out->shape()[0] * out->shape()[2] * out->shape()[3];
@@ -1881,6 +1980,11 @@ __global__ void gLSTMCellBackward(float* outCell,
 void LSTMCellBackward(std::vector<Tensor> outputs,
                       std::vector<Tensor> inputs,
                       Tensor adj) {
+  if(adj->getDeviceType() == DeviceType::cpu) {
+    cpu::LSTMCellBackward(outputs, inputs, adj);
+    return;
+  }
+
   cudaSetDevice(adj->getDevice());
 
   int rows = adj->shape()[0] * adj->shape()[2] * adj->shape()[3];
@@ -1962,6 +2066,11 @@ __global__ void gLSTMOutputBackward(float* outCell,
 void LSTMOutputBackward(std::vector<Tensor> outputs,
                       std::vector<Tensor> inputs,
                       Tensor adj) {
+  if(adj->getDeviceType() == DeviceType::cpu) {
+    cpu::LSTMOutputBackward(outputs, inputs, adj);
+    return;
+  }
+
   cudaSetDevice(adj->getDevice());
 
   int rows = adj->shape()[0] * adj->shape()[2] * adj->shape()[3];
@@ -1984,4 +2093,187 @@ void LSTMOutputBackward(std::vector<Tensor> outputs,
       cols);
 }
 
+struct FusedPointers {
+  const float* in[ElementProgram::MAX_INPUTS];
+  float* grad[ElementProgram::MAX_INPUTS];
+  // inputs of another shape than the result are broadcast
+  bool broadcast[ElementProgram::MAX_INPUTS];
+  ShapeGPU shape[ElementProgram::MAX_INPUTS];
+  ShapeGPU full;
+};
+
+FusedPointers fusedPointers(Tensor out,
+                            const std::vector<Tensor>& inputs,
+                            const std::vector<Tensor>& grads) {
+  FusedPointers ptrs;
+  ptrs.full = out->shape();
+  for(int k = 0; k < inputs.size(); ++k) {
+    ptrs.in[k] = inputs[k]->data();
+    ptrs.grad[k] = k < grads.size() && grads[k] ? grads[k]->data() : 0;
+    ptrs.broadcast[k] = inputs[k]->shape() != out->shape();
+    ptrs.shape[k] = inputs[k]->shape();
+  }
+  return ptrs;
+}
+
+// Element of input k read for element index of the result
+__device__ inline int fusedIndex(const FusedPointers& ptrs, int k, int index) {
+  if(!ptrs.broadcast[k])
+    return index;
+  int dims[4];
+  ptrs.full.dims(index, dims);
+  return ptrs.shape[k].bindex(dims);
+}
+
+__device__ inline void fusedEvaluate(const ElementProgram& program,
+                                     const FusedPointers& ptrs,
+                                     int index,
+                                     float* v) {
+  for(int j = 0; j < program.size; ++j) {
+    const ElementInstr& instr = program.instrs[j];
+    if(instr.code == ElementCode::Input) {
+      v[j] = ptrs.in[instr.a][fusedIndex(ptrs, instr.a, index)];
+      continue;
+    }
+
+    float a = v[instr.a];
+    float b = v[instr.b];
+    float s = instr.scalar;
+    switch(instr.code) {
+      case ElementCode::Add: v[j] = a + b; break;
+      case ElementCode::Sub: v[j] = a - b; break;
+      case ElementCode::Mul: v[j] = a * b; break;
+      case ElementCode::Div: v[j] = a / b; break;
+      case ElementCode::AddScalar: v[j] = a + s; break;
+      case ElementCode::MulScalar: v[j] = a * s; break;
+      case ElementCode::Tanh: v[j] = tanhf(a); break;
+      case ElementCode::Sigmoid: v[j] = logit(a); break;
+      case ElementCode::ReLU: v[j] = a > 0.f ? a : 0.f; break;
+      case ElementCode::Neg: v[j] = -a; break;
+      case ElementCode::Exp: v[j] = expf(a); break;
+      case ElementCode::Log: v[j] = logf(a); break;
+      case ElementCode::Sqrt: v[j] = sqrtf(a + s); break;
+      case ElementCode::Square: v[j] = a * a; break;
+      default: break;
+    }
+  }
+}
+
+__global__ void gFusedElement(float* out,
+                              ElementProgram program,
+                              FusedPointers ptrs,
+                              int length) {
+  float v[ElementProgram::MAX_INSTRS];
+  for(int bid = 0; bid < length; bid += blockDim.x * gridDim.x) {
+    int index = bid + blockDim.x * blockIdx.x + threadIdx.x;
+    if(index < length) {
+      fusedEvaluate(program, ptrs, index, v);
+      out[index] = v[program.size - 1];
+    }
+  }
+}
+
+void FusedElement(Tensor out,
+                  const std::vector<Tensor>& inputs,
+                  const ElementProgram& program) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::FusedElement(out, inputs, program);
+    return;
+  }
+
+  cudaSetDevice(out->getDevice());
+
+  FusedPointers ptrs = fusedPointers(out, inputs, {});
+
+  int length = out->shape().elements();
+  int threads = std::min(MAX_THREADS, length);
+  int blocks = std::min(MAX_BLOCKS, length / threads + (length % threads != 0));
+
+  gFusedElement<<<blocks, threads>>>(out->data(), program, ptrs, length);
+}
+
+__global__ void gFusedElementGrad(const float* adj,
+                                  ElementProgram program,
+                                  FusedPointers ptrs,
+                                  int length) {
+  float v[ElementProgram::MAX_INSTRS];
+  float g[ElementProgram::MAX_INSTRS];
+  for(int bid = 0; bid < length; bid += blockDim.x * gridDim.x) {
+    int index = bid + blockDim.x * blockIdx.x + threadIdx.x;
+    if(index < length) {
+      fusedEvaluate(program, ptrs, index, v);
+
+      for(int j = 0; j < program.size - 1; ++j)
+        g[j] = 0.f;
+      g[program.size - 1] = adj[index];
+
+      for(int j = program.size - 1; j >= 0; --j) {
+        const ElementInstr& instr = program.instrs[j];
+        if(instr.code == ElementCode::Input) {
+          float* grad = ptrs.grad[instr.a];
+          if(grad && ptrs.broadcast[instr.a])
+            atomicAdd(grad + fusedIndex(ptrs, instr.a, index), g[j]);
+          else if(grad)
+            grad[index] += g[j];
+          continue;
+        }
+
+        float a = v[instr.a];
+        float b = v[instr.b];
+        float y = v[j];
+        float s = instr.scalar;
+        switch(instr.code) {
+          case ElementCode::Add:
+            g[instr.a] += g[j];
+            g[instr.b] += g[j];
+            break;
+          case ElementCode::Sub:
+            g[instr.a] += g[j];
+            g[instr.b] -= g[j];
+            break;
+          case ElementCode::Mul:
+            g[instr.a] += g[j] * b;
+            g[instr.b] += g[j] * a;
+            break;
+          case ElementCode::Div:
+            g[instr.a] += g[j] / b;
+            g[instr.b] -= g[j] * a / (b * b);
+            break;
+          case ElementCode::AddScalar: g[instr.a] += g[j]; break;
+          case ElementCode::MulScalar: g[instr.a] += g[j] * s; break;
+          case ElementCode::Tanh: g[instr.a] += g[j] * (1.f - y * y); break;
+          case ElementCode::Sigmoid: g[instr.a] += g[j] * y * (1.f - y); break;
+          case ElementCode::ReLU: g[instr.a] += a > 0.f ? g[j] : 0.f; break;
+          case ElementCode::Neg: g[instr.a] -= g[j]; break;
+          case ElementCode::Exp: g[instr.a] += g[j] * y; break;
+          case ElementCode::Log: g[instr.a] += g[j] / a; break;
+          case ElementCode::Sqrt: g[instr.a] += 0.5f * g[j] / y; break;
+          case ElementCode::Square: g[instr.a] += 2.f * g[j] * a; break;
+          default: break;
+        }
+      }
+    }
+  }
+}
+
+void FusedElementGrad(const std::vector<Tensor>& grads,
+                      Tensor adj,
+                      const std::vector<Tensor>& inputs,
+                      const ElementProgram& program) {
+  if(adj->getDeviceType() == DeviceType::cpu) {
+    cpu::FusedElementGrad(grads, adj, inputs, program);
+    return;
+  }
+
+  cudaSetDevice(adj->getDevice());
+
+  FusedPointers ptrs = fusedPointers(adj, inputs, grads);
+
+  int length = adj->shape().elements();
+  int threads = std::min(MAX_THREADS, length);
+  int blocks = std::min(MAX_BLOCKS, length / threads + (length % threads != 0));
+
+  gFusedElementGrad<<<blocks, threads>>>(adj->data(), program, ptrs, length);
+}
+
 }  // namespace marian
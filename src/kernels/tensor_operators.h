@@ -6,7 +6,9 @@
 #include <thrust/host_vector.h>
 #include <thrust/pair.h>
 
+#include "kernels/element_program.h"
 #include "kernels/shape_gpu.h"
+#include "kernels/tensor_operators_cpu.h"
 #include "tensors/tensor.h"
 
 namespace marian {
@@ -150,6 +152,11 @@ __global__ void gAdd1R2(Functor functor,
 
 template <class Functor>
 void Add(Functor functor, Tensor out, Tensor in, float scale = 1.0) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Add(functor, out, in, scale);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   auto full = out->shape();
@@ -348,6 +355,11 @@ __global__ void gAdd1R3(Functor functor,
 template <class Functor>
 void Add(
     Functor functor, Tensor out, Tensor in1, Tensor in2, float scale = 1.0) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Add(functor, out, in1, in2, scale);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   auto full = out->shape();
@@ -567,6 +579,11 @@ __global__ void gAddR4Eq(Functor functor,
 
 template <class Functor>
 void Add(Functor functor, Tensor out, Tensor in1, Tensor in2, Tensor in3) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Add(functor, out, in1, in2, in3);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   auto full = out->shape();
@@ -722,6 +739,11 @@ __global__ void gElement(Functor functor,
 
 template <class Functor, class T1, class T2>
 void Element(Functor functor, T1 out, T2 in) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Element(functor, out, in);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int length = out->shape().elements();
@@ -765,6 +787,11 @@ __global__ void gElement(Functor functor,
 
 template <class Functor, class T1, class T2, class T3>
 void Element(Functor functor, T1 out, T2 in1, T3 in2) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Element(functor, out, in1, in2);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int length = out->shape().elements();
@@ -816,6 +843,11 @@ __global__ void gElement(Functor functor,
 
 template <class Functor, class T1, class T2, class T3, class T4>
 void Element(Functor functor, T1 out, T2 in1, T3 in2, T4 in3) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Element(functor, out, in1, in2, in3);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int length = out->shape().elements();
@@ -849,6 +881,11 @@ __global__ void gElement(Functor functor, float* out, int length) {
 
 template <class Functor, class T1>
 void Element(Functor functor, T1 out) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Element(functor, out);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int length = out->shape().elements();
@@ -882,6 +919,11 @@ __global__ void gPick(Functor functor,
 
 template <class Functor, class T1, class T2>
 void Pick(Functor functor, T1 out, const T2 picks) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Pick(functor, out, picks);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int length = out->shape().elements();
@@ -916,6 +958,11 @@ __global__ void gPick(Functor functor,
 
 template <class Functor, class T1, class T2, class T3>
 void Pick(Functor functor, T1 out, const T2 in, const T3 picks) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Pick(functor, out, in, picks);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int length = out->shape().elements();
@@ -958,6 +1005,11 @@ __global__ void gPickReduce(Functor functor,
 
 template <class Functor, class T1, class T2, class T3>
 void PickReduce(Functor functor, T1 out, const T2 in, const T3 picks) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::PickReduce(functor, out, in, picks);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int length = in->shape().elements();
@@ -1001,6 +1053,11 @@ __global__ void gPick(Functor functor,
 
 template <class Functor, class T1, class T2, class T3, class T4>
 void Pick(Functor functor, T1 out, const T2 in1, const T3 in2, const T4 picks) {
+  if(out->getDeviceType() == DeviceType::cpu) {
+    cpu::Pick(functor, out, in1, in2, picks);
+    return;
+  }
+
   cudaSetDevice(out->getDevice());
 
   int length = out->shape().elements();
@@ -1110,6 +1167,23 @@ void LayerNormalizationGrad(Tensor gradX,
 
 void Shift(Tensor out, Tensor in, ShapeGPU shift, bool invert = false);
 
+/**
+ * @brief Evaluates program for every element of out, all inputs have the
+ * shape of out
+ */
+void FusedElement(Tensor out,
+                  const std::vector<Tensor>& inputs,
+                  const ElementProgram& program);
+
+/**
+ * @brief Adds the gradient of program with respect to each input to the
+ * matching non-null entry of grads
+ */
+void FusedElementGrad(const std::vector<Tensor>& grads,
+                      Tensor adj,
+                      const std::vector<Tensor>& inputs,
+                      const ElementProgram& program);
+
 void SetSparse(float*,
                const std::vector<size_t>& indeces,
                const std::vector<float>& values);
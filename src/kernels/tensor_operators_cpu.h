@@ -0,0 +1,425 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "3rd_party/threadpool.h"
+#include "common/shape.h"
+
+namespace marian {
+
+/**
+ * Host implementations of the functor kernels in kernels/tensor_operators.h.
+ *
+ * Broadcasting follows the GPU kernels: dimensions of size 1 are broadcast
+ * through Shape::bstride. Work is split into rows of the column dimension
+ * (which is contiguous in memory), so the inner loops run over unit or zero
+ * strides and are auto-vectorised by the compiler. Tensors above a few ten
+ * thousand elements are split across threads.
+ */
+namespace cpu {
+
+// elements per thread below which splitting work does not pay off
+const int MIN_ELEMENTS_PER_THREAD = 1 << 15;
+
+// column block for reductions that keep the column dimension
+const int REDUCE_BLOCK = 512;
+
+inline bool& insideParallelFor() {
+  static thread_local bool inside = false;
+  return inside;
+}
+
+inline size_t numThreads() {
+  static size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  return threads;
+}
+
+inline ThreadPool& threadPool() {
+  static ThreadPool pool(numThreads() - 1);
+  return pool;
+}
+
+/**
+ * @brief Runs body(begin, end) over [0, n) in contiguous chunks of at least
+ * grain items. The calling thread works on the first chunk; nested calls run
+ * sequentially.
+ */
+inline void parallelFor(int n,
+                        int grain,
+                        const std::function<void(int, int)>& body) {
+  int chunks = std::min((int)numThreads(), n / std::max(grain, 1));
+  if(chunks <= 1 || insideParallelFor()) {
+    body(0, n);
+    return;
+  }
+
+  auto run = [&body](int begin, int end) {
+    insideParallelFor() = true;
+    body(begin, end);
+    insideParallelFor() = false;
+  };
+
+  std::vector<std::future<void>> done;
+  for(int c = 1; c < chunks; ++c)
+    done.emplace_back(threadPool().enqueue(
+        run, (int)((long)n * c / chunks), (int)((long)n * (c + 1) / chunks)));
+  run(0, n / chunks);
+  for(auto& f : done)
+    f.get();
+}
+
+// Offset of the first element of a row (all dimensions except the column
+// dimension) of a tensor broadcast to full.
+inline int rowOffset(const Shape& shape, const Shape& full, int row) {
+  int d0 = row % full[0];
+  int rest = row / full[0];
+  int d2 = rest % full[2];
+  int d3 = rest / full[2];
+  return d0 * shape.bstride(0) + d2 * shape.bstride(2)
+         + d3 * shape.bstride(3);
+}
+
+template <int N>
+struct Apply;
+
+template <>
+struct Apply<1> {
+  template <class Functor>
+  static float call(Functor& f, const float** in, const int* s, int j) {
+    return f(in[0][j * s[0]]);
+  }
+
+  template <class Functor>
+  static float update(Functor& f, float o, const float** in, const int* s, int j) {
+    return f(o, in[0][j * s[0]]);
+  }
+};
+
+template <>
+struct Apply<2> {
+  template <class Functor>
+  static float call(Functor& f, const float** in, const int* s, int j) {
+    return f(in[0][j * s[0]], in[1][j * s[1]]);
+  }
+
+  template <class Functor>
+  static float update(Functor& f, float o, const float** in, const int* s, int j) {
+    return f(o, in[0][j * s[0]], in[1][j * s[1]]);
+  }
+};
+
+template <>
+struct Apply<3> {
+  template <class Functor>
+  static float call(Functor& f, const float** in, const int* s, int j) {
+    return f(in[0][j * s[0]], in[1][j * s[1]], in[2][j * s[2]]);
+  }
+
+  template <class Functor>
+  static float update(Functor& f, float o, const float** in, const int* s, int j) {
+    return f(o, in[0][j * s[0]], in[1][j * s[1]], in[2][j * s[2]]);
+  }
+};
+
+template <int N, class Functor>
+void element(Functor functor,
+             float* out,
+             const Shape& outShape,
+             const float** in,
+             const Shape* inShapes) {
+  int length = outShape.elements();
+  int cols = outShape[1];
+  int rows = length / cols;
+
+  bool same = true;
+  for(int k = 0; k < N; ++k)
+    same = same && inShapes[k] == outShape;
+
+  if(same) {
+    parallelFor(length, MIN_ELEMENTS_PER_THREAD, [&](int begin, int end) {
+      const float* ptrs[N];
+      int strides[N];
+      for(int k = 0; k < N; ++k) {
+        ptrs[k] = in[k] + begin;
+        strides[k] = 1;
+      }
+      float* o = out + begin;
+      for(int j = 0; j < end - begin; ++j)
+        o[j] = Apply<N>::update(functor, o[j], ptrs, strides, j);
+    });
+    return;
+  }
+
+  int grain = std::max(1, MIN_ELEMENTS_PER_THREAD / cols);
+  parallelFor(rows, grain, [&](int begin, int end) {
+    const float* ptrs[N];
+    int strides[N];
+    for(int k = 0; k < N; ++k)
+      strides[k] = inShapes[k].bstride(1);
+    for(int r = begin; r < end; ++r) {
+      for(int k = 0; k < N; ++k)
+        ptrs[k] = in[k] + rowOffset(inShapes[k], outShape, r);
+      float* o = out + r * cols;
+      for(int j = 0; j < cols; ++j)
+        o[j] = Apply<N>::update(functor, o[j], ptrs, strides, j);
+    }
+  });
+}
+
+template <int N, class Functor>
+void add(Functor functor,
+         float* out,
+         const Shape& outShape,
+         const float** in,
+         const Shape* inShapes,
+         float scale) {
+  Shape full = outShape;
+  for(int k = 0; k < N; ++k)
+    for(int i = 0; i < full.size(); ++i)
+      full.set(i, std::max(full[i], inShapes[k][i]));
+
+  int cols = full[1];
+  int fullRows = full.elements() / cols;
+
+  if(full == outShape) {
+    int grain = std::max(1, MIN_ELEMENTS_PER_THREAD / cols);
+    parallelFor(fullRows, grain, [&](int begin, int end) {
+      const float* ptrs[N];
+      int strides[N];
+      for(int k = 0; k < N; ++k)
+        strides[k] = inShapes[k].bstride(1);
+      for(int r = begin; r < end; ++r) {
+        for(int k = 0; k < N; ++k)
+          ptrs[k] = in[k] + rowOffset(inShapes[k], full, r);
+        float* o = out + r * cols;
+        for(int j = 0; j < cols; ++j)
+          o[j] += Apply<N>::call(functor, ptrs, strides, j) * scale;
+      }
+    });
+    return;
+  }
+
+  // Reduction: each unit of work is a block of one output row, so threads
+  // never write to the same output element.
+  bool keepCols = outShape[1] == cols;
+  int outRows = outShape.elements() / outShape[1];
+  int blocks = keepCols ? (cols + REDUCE_BLOCK - 1) / REDUCE_BLOCK : 1;
+  int blockCols = keepCols ? std::min(cols, REDUCE_BLOCK) : cols;
+
+  // ranges of full dimensions 0, 2 and 3 that are summed into one output row
+  int I = full[0] / outShape[0];
+  int K = full[2] / outShape[2];
+  int L = full[3] / outShape[3];
+
+  int work = full.elements() / (outRows * blocks);
+  int grain = std::max(1, MIN_ELEMENTS_PER_THREAD / std::max(work, 1));
+
+  parallelFor(outRows * blocks, grain, [&](int begin, int end) {
+    const float* ptrs[N];
+    int strides[N];
+    for(int k = 0; k < N; ++k)
+      strides[k] = inShapes[k].bstride(1);
+    float acc[REDUCE_BLOCK];
+
+    for(int unit = begin; unit < end; ++unit) {
+      int row = unit / blocks;
+      int c0 = (unit % blocks) * blockCols;
+      int c1 = keepCols ? std::min(cols, c0 + blockCols) : cols;
+
+      int o0 = row % outShape[0];
+      int o2 = (row / outShape[0]) % outShape[2];
+      int o3 = row / (outShape[0] * outShape[2]);
+
+      float sum = 0;
+      if(keepCols)
+        std::fill(acc, acc + (c1 - c0), 0.f);
+
+      for(int l = 0; l < L; ++l) {
+        for(int k = 0; k < K; ++k) {
+          for(int i = 0; i < I; ++i) {
+            int fullRow = (o0 + i) + full[0] * ((o2 + k) + full[2] * (o3 + l));
+            for(int n = 0; n < N; ++n)
+              ptrs[n] = in[n] + rowOffset(inShapes[n], full, fullRow)
+                        + c0 * strides[n];
+            if(keepCols) {
+              for(int j = 0; j < c1 - c0; ++j)
+                acc[j] += Apply<N>::call(functor, ptrs, strides, j);
+            } else {
+              for(int j = 0; j < cols; ++j)
+                sum += Apply<N>::call(functor, ptrs, strides, j);
+            }
+          }
+        }
+      }
+
+      if(keepCols) {
+        float* o = out + row * cols + c0;
+        for(int j = 0; j < c1 - c0; ++j)
+          o[j] += acc[j] * scale;
+      } else {
+        out[row] += sum * scale;
+      }
+    }
+  });
+}
+
+template <class Functor, class T1, class T2>
+void Element(Functor functor, T1 out, T2 in) {
+  const float* ins[] = {in->data()};
+  Shape shapes[] = {in->shape()};
+  element<1>(functor, out->data(), out->shape(), ins, shapes);
+}
+
+template <class Functor, class T1, class T2, class T3>
+void Element(Functor functor, T1 out, T2 in1, T3 in2) {
+  const float* ins[] = {in1->data(), in2->data()};
+  Shape shapes[] = {in1->shape(), in2->shape()};
+  element<2>(functor, out->data(), out->shape(), ins, shapes);
+}
+
+template <class Functor, class T1, class T2, class T3, class T4>
+void Element(Functor functor, T1 out, T2 in1, T3 in2, T4 in3) {
+  const float* ins[] = {in1->data(), in2->data(), in3->data()};
+  Shape shapes[] = {in1->shape(), in2->shape(), in3->shape()};
+  element<3>(functor, out->data(), out->shape(), ins, shapes);
+}
+
+template <class Functor, class T1>
+void Element(Functor functor, T1 out) {
+  float* o = out->data();
+  parallelFor(out->shape().elements(),
+              MIN_ELEMENTS_PER_THREAD,
+              [&](int begin, int end) {
+                for(int j = begin; j < end; ++j)
+                  o[j] = functor(o[j]);
+              });
+}
+
+template <class Functor, class T1, class T2>
+void Add(Functor functor, T1 out, T2 in, float scale = 1.0) {
+  const float* ins[] = {in->data()};
+  Shape shapes[] = {in->shape()};
+  add<1>(functor, out->data(), out->shape(), ins, shapes, scale);
+}
+
+template <class Functor, class T1, class T2, class T3>
+void Add(Functor functor, T1 out, T2 in1, T3 in2, float scale = 1.0) {
+  const float* ins[] = {in1->data(), in2->data()};
+  Shape shapes[] = {in1->shape(), in2->shape()};
+  add<2>(functor, out->data(), out->shape(), ins, shapes, scale);
+}
+
+template <class Functor, class T1, class T2, class T3, class T4>
+void Add(Functor functor, T1 out, T2 in1, T3 in2, T4 in3, float scale = 1.0) {
+  const float* ins[] = {in1->data(), in2->data(), in3->data()};
+  Shape shapes[] = {in1->shape(), in2->shape(), in3->shape()};
+  add<3>(functor, out->data(), out->shape(), ins, shapes, scale);
+}
+
+template <class Functor, class T1, class T2>
+void Pick(Functor functor, T1 out, const T2 picks) {
+  float* o = out->data();
+  const float* p = picks->data();
+  const Shape& shape = out->shape();
+  int cols = shape[1];
+  parallelFor(shape.elements() / cols,
+              std::max(1, MIN_ELEMENTS_PER_THREAD / cols),
+              [&](int begin, int end) {
+                for(int r = begin; r < end; ++r) {
+                  int pick = (int)p[r % shape[0]];
+                  float* row = o + r * cols;
+                  for(int j = 0; j < cols; ++j)
+                    row[j] = functor(row[j], (float)(j == pick));
+                }
+              });
+}
+
+template <class Functor, class T1, class T2, class T3>
+void Pick(Functor functor, T1 out, const T2 in, const T3 picks) {
+  float* o = out->data();
+  const float* i = in->data();
+  const float* p = picks->data();
+  const Shape& shape = out->shape();
+  const Shape& inShape = in->shape();
+  int cols = shape[1];
+  int s = inShape.bstride(1);
+  parallelFor(shape.elements() / cols,
+              std::max(1, MIN_ELEMENTS_PER_THREAD / cols),
+              [&](int begin, int end) {
+                for(int r = begin; r < end; ++r) {
+                  int pick = (int)p[r % shape[0]];
+                  float* row = o + r * cols;
+                  const float* irow = i + rowOffset(inShape, shape, r);
+                  for(int j = 0; j < cols; ++j)
+                    row[j] = functor(row[j], irow[j * s], (float)(j == pick));
+                }
+              });
+}
+
+template <class Functor, class T1, class T2, class T3, class T4>
+void Pick(Functor functor, T1 out, const T2 in1, const T3 in2, const T4 picks) {
+  float* o = out->data();
+  const float* i1 = in1->data();
+  const float* i2 = in2->data();
+  const float* p = picks->data();
+  const Shape& shape = out->shape();
+  const Shape& inShape1 = in1->shape();
+  const Shape& inShape2 = in2->shape();
+  int cols = shape[1];
+  int s1 = inShape1.bstride(1);
+  int s2 = inShape2.bstride(1);
+  parallelFor(shape.elements() / cols,
+              std::max(1, MIN_ELEMENTS_PER_THREAD / cols),
+              [&](int begin, int end) {
+                for(int r = begin; r < end; ++r) {
+                  int pick = (int)p[r % shape[0]];
+                  float* row = o + r * cols;
+                  const float* irow1 = i1 + rowOffset(inShape1, shape, r);
+                  const float* irow2 = i2 + rowOffset(inShape2, shape, r);
+                  for(int j = 0; j < cols; ++j)
+                    row[j] = functor(
+                        row[j], irow1[j * s1], irow2[j * s2], (float)(j == pick));
+                }
+              });
+}
+
+template <class Functor, class T1, class T2, class T3>
+void PickReduce(Functor functor, T1 out, const T2 in, const T3 picks) {
+  float* o = out->data();
+  const float* i = in->data();
+  const float* p = picks->data();
+  const Shape& outShape = out->shape();
+  const Shape& inShape = in->shape();
+  int cols = inShape[1];
+  int rows = inShape.elements() / cols;
+
+  std::fill(o, o + outShape.elements(), 0.f);
+
+  // rows can only be processed in parallel if they write to separate outputs
+  bool separate = outShape[0] == inShape[0] && outShape[2] == inShape[2]
+                  && outShape[3] == inShape[3];
+  int grain = separate ? std::max(1, MIN_ELEMENTS_PER_THREAD / cols) : rows;
+
+  parallelFor(rows, grain, [&](int begin, int end) {
+    for(int r = begin; r < end; ++r) {
+      int pick = (int)p[r % inShape[0]];
+      const float* irow = i + r * cols;
+      float* orow = o + rowOffset(outShape, inShape, r);
+      if(outShape[1] == 1) {
+        float sum = 0;
+        for(int j = 0; j < cols; ++j)
+          sum += functor(irow[j], (float)(j == pick));
+        orow[0] += sum;
+      } else {
+        for(int j = 0; j < cols; ++j)
+          orow[j] += functor(irow[j], (float)(j == pick));
+      }
+    }
+  });
+}
+}
+}
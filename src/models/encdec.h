@@ -285,8 +285,10 @@ public:
                      bool clearGraph = true) {
     using namespace keywords;
 
-    if(clearGraph)
+    if(clearGraph) {
       clear(graph);
+      graph->beginTape(tapeKey(batch, false));
+    }
 
     auto state = startState(graph, batch);
 
@@ -344,13 +346,22 @@ public:
     return options_->get<T>(key);
   }
 
+  // graphs built for scoring end differently from graphs built for training
+  size_t tapeKey(Ptr<data::CorpusBatch> batch, bool toScore) {
+    size_t seed = batch->signature();
+    boost::hash_combine(seed, toScore);
+    return seed;
+  }
+
   virtual Expr buildToScore(Ptr<ExpressionGraph> graph,
                             Ptr<data::CorpusBatch> batch,
                             bool clearGraph = true) {
     using namespace keywords;
 
-    if(clearGraph)
+    if(clearGraph) {
       clear(graph);
+      graph->beginTape(tapeKey(batch, true));
+    }
     auto state = startState(graph, batch);
 
     Expr trgMask, trgIdx;
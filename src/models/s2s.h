@@ -32,6 +32,9 @@ public:
 
     using namespace keywords;
     float dropoutRnn = inference_ ? 0 : opt<float>("dropout-rnn");
+    int checkpoint = !inference_ && options_->has("rnn-checkpoint")
+                         ? opt<int>("rnn-checkpoint")
+                         : 0;
 
     auto rnnFw = rnn::rnn(graph)
                  ("type", opt<std::string>("enc-cell"))
@@ -40,7 +43,8 @@ public:
                  ("dimState", opt<int>("dim-rnn"))
                  ("dropout", dropoutRnn)
                  ("layer-normalization", opt<bool>("layer-normalization"))
-                 ("skip", opt<bool>("skip"));
+                 ("skip", opt<bool>("skip"))
+                 ("checkpoint", checkpoint);
 
     for(int i = 1; i <= first; ++i) {
       auto stacked = rnn::stacked_cell(graph);
@@ -63,7 +67,8 @@ public:
                  ("dimState", opt<int>("dim-rnn"))
                  ("dropout", dropoutRnn)
                  ("layer-normalization", opt<bool>("layer-normalization"))
-                 ("skip", opt<bool>("skip"));
+                 ("skip", opt<bool>("skip"))
+                 ("checkpoint", checkpoint);
 
     for(int i = 1; i <= first; ++i) {
       auto stacked = rnn::stacked_cell(graph);
@@ -94,7 +99,8 @@ public:
                     ("dimState", opt<int>("dim-rnn"))
                     ("dropout", dropoutRnn)
                     ("layer-normalization", opt<bool>("layer-normalization"))
-                    ("skip", opt<bool>("skip"));
+                    ("skip", opt<bool>("skip"))
+                    ("checkpoint", checkpoint);
 
       for(int i = first + 1; i <= second + first; ++i) {
         auto stacked = rnn::stacked_cell(graph);
@@ -182,13 +188,17 @@ private:
 Ptr<rnn::RNN> constructDecoderRNN(Ptr<ExpressionGraph> graph,
                                   Ptr<DecoderState> state) {
   float dropoutRnn = inference_ ? 0 : opt<float>("dropout-rnn");
+  int checkpoint = !inference_ && options_->has("rnn-checkpoint")
+                       ? opt<int>("rnn-checkpoint")
+                       : 0;
   auto rnn = rnn::rnn(graph)
              ("type", opt<std::string>("dec-cell"))
              ("dimInput", opt<int>("dim-emb"))
              ("dimState", opt<int>("dim-rnn"))
              ("dropout", dropoutRnn)
              ("layer-normalization", opt<bool>("layer-normalization"))
-             ("skip", opt<bool>("skip"));
+             ("skip", opt<bool>("skip"))
+             ("checkpoint", checkpoint);
 
   size_t decoderLayers = opt<size_t>("dec-depth");
   size_t decoderBaseDepth = opt<size_t>("dec-cell-base-depth");
@@ -14,8 +14,14 @@ private:
   Ptr<data::CorpusBatch> batch_;
 
 public:
+  // the context and mask are read in every decoding step
   EncoderState(Expr context, Expr mask, Ptr<data::CorpusBatch> batch)
-      : context_(context), mask_(mask), batch_(batch) {}
+      : context_(context), mask_(mask), batch_(batch) {
+    if(context_)
+      context_->setPersistent(true);
+    if(mask_)
+      mask_->setPersistent(true);
+  }
 
   EncoderState() {}
 
@@ -38,14 +44,29 @@ protected:
   rnn::States states_;
 
 public:
+  // states are read by the next decoding step and probabilities by the
+  // search after the forward pass
   DecoderState(const rnn::States& states,
                Expr probs,
                Ptr<EncoderState> encState)
-      : states_(states), probs_(probs), encState_(encState) {}
+      : states_(states), probs_(probs), encState_(encState) {
+    for(auto& state : states_) {
+      if(state.output)
+        state.output->setPersistent(true);
+      if(state.cell)
+        state.cell->setPersistent(true);
+    }
+    if(probs_)
+      probs_->setPersistent(true);
+  }
 
   virtual Ptr<EncoderState> getEncoderState() { return encState_; }
   virtual Expr getProbs() { return probs_; }
-  virtual void setProbs(Expr probs) { probs_ = probs; }
+  virtual void setProbs(Expr probs) {
+    probs_ = probs;
+    if(probs_)
+      probs_->setPersistent(true);
+  }
 
   virtual Ptr<DecoderState> select(const std::vector<size_t>& selIdx) {
     return New<DecoderState>(states_.select(selIdx), probs_, encState_);
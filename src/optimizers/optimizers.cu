@@ -12,7 +12,7 @@ void Sgd::updateImpl(Tensor params, Tensor grads) {
 
 void Adagrad::updateImpl(Tensor params, Tensor grads) {
   if(!alloc_)
-    alloc_ = New<TensorAllocator>(params->getDevice());
+    alloc_ = New<TensorAllocator>(params->getDevice(), params->getDeviceType());
 
   if(!gt_) {
     int elements = params->size();
@@ -30,9 +30,9 @@ void Adagrad::updateImpl(Tensor params, Tensor grads) {
 
 void Adam::updateImpl(Tensor params, Tensor grads) {
   if(!mtAlloc_)
-    mtAlloc_ = New<TensorAllocator>(params->getDevice());
+    mtAlloc_ = New<TensorAllocator>(params->getDevice(), params->getDeviceType());
   if(!vtAlloc_)
-    vtAlloc_ = New<TensorAllocator>(params->getDevice());
+    vtAlloc_ = New<TensorAllocator>(params->getDevice(), params->getDeviceType());
 
   if(!mt_) {
     int elements = params->size();
@@ -52,6 +52,9 @@ public:
     auto device = options_->get<std::vector<size_t>>("devices").front();
     graph_->setDevice(device);
     graph_->reserveWorkspaceMB(options_->get<size_t>("workspace"));
+    graph_->setFusion(options_->get<bool>("fuse-elementwise"));
+    graph_->setEagerRelease(options_->get<bool>("eager-release"));
+    graph_->setProfiling(options_->has("profile"));
 
     auto modelFile = options_->get<std::string>("model");
     auto modelOptions = New<Config>(*options);
@@ -84,6 +87,9 @@ public:
         output->Write(batch->getSentenceIds()[i], scores[i]);
       }
     }
+
+    if(options_->has("profile"))
+      dumpProfile({graph_}, options_->get<std::string>("profile"));
   }
 };
 
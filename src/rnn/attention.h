@@ -87,6 +87,12 @@ public:
       Shape shape = {softmaxMask->shape()[2], softmaxMask->shape()[0]};
       softmaxMask_ = transpose(reshape(softmaxMask, shape));
     }
+
+    // computed once and read in every decoding step
+    contextDropped_->setPersistent(true);
+    mappedContext_->setPersistent(true);
+    if(softmaxMask_)
+      softmaxMask_->setPersistent(true);
   }
 
   Expr apply(State state) {
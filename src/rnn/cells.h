@@ -247,8 +247,10 @@ public:
 
     Expr xW;
     if(xWs.empty()) {
-      if(!fakeInput_ || fakeInput_->shape() != sU->shape())
+      if(!fakeInput_ || fakeInput_->shape() != sU->shape()) {
         fakeInput_ = sU->graph()->constant(sU->shape(), keywords::init=inits::zeros);
+        fakeInput_->setPersistent(true);
+      }
       xW = fakeInput_;
     }
     else {
@@ -365,9 +367,11 @@ public:
 
     Expr xW;
     if(xWs.empty()) {
-      if(!fakeInput_ || fakeInput_->shape() != sU->shape())
+      if(!fakeInput_ || fakeInput_->shape() != sU->shape()) {
         fakeInput_ = sU->graph()->constant(sU->shape(),
                                            keywords::init=inits::zeros);
+        fakeInput_->setPersistent(true);
+      }
       xW = fakeInput_;
     }
     else {
@@ -65,10 +65,17 @@ private:
 
     size_t timeSteps = input->shape()[2];
 
+    // only every checkpoint-th state is kept after the forward pass, the
+    // steps in between are recomputed during the backward pass
+    int checkpoint = options_->get<int>("checkpoint", 0);
+
     States outputs;
     for(size_t i = 0; i < timeSteps; ++i) {
       int j = i;
 
+      if(checkpoint > 0 && i % checkpoint == 0)
+        graph_->beginSegment();
+
       if(direction_ == dir::backward)
         j = timeSteps - i - 1;
 
@@ -82,6 +89,10 @@ private:
         state = cell_->applyState(steps, state);
 
       outputs.push_back(state);
+
+      if(checkpoint > 0
+         && (i % checkpoint == checkpoint - 1 || i == timeSteps - 1))
+        graph_->endSegment({state.output, state.cell});
     }
 
     if(direction_ == dir::backward)
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <deque>
+#include <iterator>
+#include <map>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -9,6 +12,7 @@
 #include <vector>
 
 #include "common/definitions.h"
+#include "common/pool_allocator.h"
 #include "tensors/memory_piece.h"
 
 namespace marian {
@@ -68,8 +72,65 @@ class Gap {
     }
 };
 
+/** @brief Usage and fragmentation counters of an Allocator, all sizes in bytes */
+struct AllocatorStats {
+  size_t capacity{0};
+  size_t live{0};
+  size_t peak{0};
+  size_t gaps{0};
+  size_t largestGap{0};
+  size_t grows{0};
+  double growSeconds{0};
+};
+
+/**
+ * @brief Device-independent interface of Allocator, lets the owner choose the
+ * memory space (GPU or host) at runtime.
+ */
+class AllocatorBase {
+  public:
+    virtual ~AllocatorBase() {}
+
+    virtual void throwAtReallocation(bool throwRealloc) = 0;
+
+    virtual void reserve(size_t bytes) = 0;
+
+    virtual void ensure(size_t bytes) = 0;
+
+    template <typename T>
+    size_t capacity(size_t num) {
+      return align(num * sizeof(T));
+    }
+
+    template <typename T>
+    Ptr<MemoryPiece> alloc(size_t num) {
+      return alloc(capacity<T>(num));
+    }
+
+    virtual Ptr<MemoryPiece> alloc(size_t bytes) = 0;
+
+    virtual bool free(uint8_t* ptr, size_t bytes) = 0;
+
+    virtual bool free(Ptr<MemoryPiece> mp) = 0;
+
+    virtual void clear() = 0;
+
+    virtual Ptr<MemoryPiece> memory() = 0;
+
+    virtual size_t size() = 0;
+
+    virtual size_t available() = 0;
+
+    virtual size_t getDevice() = 0;
+
+    virtual AllocatorStats stats() = 0;
+
+  protected:
+    virtual size_t align(size_t size) = 0;
+};
+
 template <class Device>
-class Allocator {
+class Allocator : public AllocatorBase {
   private:
     Device device_{0};
     size_t available_{0};
@@ -77,40 +138,61 @@ class Allocator {
     size_t alignment_{256};
     bool throw_{false};
 
+    // free gaps ordered by size for best-fit lookup and by address for
+    // logarithmic coalescing of neighbours
     std::set<Gap> gaps_;
+    std::map<uint8_t*, size_t> gapsByAddress_;
     std::unordered_map<uint8_t*, Ptr<MemoryPiece>> allocated_;
 
+    size_t live_{0};
+    size_t peak_{0};
+    size_t grows_{0};
+    double growSeconds_{0};
+
+  protected:
     size_t align(size_t size) {
       return ceil(size / (float)alignment_) * alignment_;
     }
 
+  private:
+
     void grow(size_t add) {
+      auto start = std::chrono::steady_clock::now();
+
       add = align(add);
       uint8_t* oldData = device_.data();
       size_t oldSize = device_.size();
 
       device_.reserve(oldSize + add);
 
-      std::set<Gap> oldGaps;
-      gaps_.swap(oldGaps);
+      // devices that grow in place keep all gaps and pieces valid
+      if(device_.data() != oldData) {
+        std::set<Gap> oldGaps;
+        gaps_.swap(oldGaps);
+        gapsByAddress_.clear();
+
+        for(auto gap : oldGaps)
+          addGap(Gap(device_.data() + std::distance(oldData, gap.data()), gap.size()));
+
+        std::unordered_map<uint8_t*, Ptr<MemoryPiece>> oldAllocated;
+        allocated_.swap(oldAllocated);
+        for(auto it : oldAllocated) {
+          uint8_t* newPtr = device_.data() + std::distance(oldData, it.first);
+          allocated_[newPtr] = oldAllocated[it.first];
+          allocated_[newPtr]->setPtr(newPtr);
+        }
+      }
 
-      for(auto gap : oldGaps)
-        gaps_.insert(Gap(device_.data() + std::distance(oldData, gap.data()), gap.size()));
       insertGap(Gap(device_.data() + oldSize, add));
 
-      std::unordered_map<uint8_t*, Ptr<MemoryPiece>> oldAllocated;
-      allocated_.swap(oldAllocated);
-      for(auto it : oldAllocated) {
-        uint8_t* newPtr = device_.data() + std::distance(oldData, it.first);
-        allocated_[newPtr] = oldAllocated[it.first];
-        allocated_[newPtr]->setPtr(newPtr);
-      }
+      grows_++;
+      growSeconds_ += std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
     }
 
     Gap getGap(size_t size) {
       size = align(size);
-      auto it = std::lower_bound(gaps_.begin(), gaps_.end(),
-                                 Gap(nullptr, size));
+      auto it = gaps_.lower_bound(Gap(nullptr, size));
 
       if(throw_ && it == gaps_.end()) {
         throw AllocationException();
@@ -118,33 +200,53 @@ class Allocator {
 
       while(it == gaps_.end()) {
         grow(step_);
-        it = std::lower_bound(gaps_.begin(), gaps_.end(),
-                              Gap(nullptr, size));
+        it = gaps_.lower_bound(Gap(nullptr, size));
       }
 
       available_ -= it->size();
       return *it;
     }
 
+    void addGap(const Gap& gap) {
+      gaps_.insert(gap);
+      gapsByAddress_[gap.data()] = gap.size();
+    }
+
+    void removeGap(const Gap& gap) {
+      gaps_.erase(gap);
+      gapsByAddress_.erase(gap.data());
+    }
+
     void insertGap(Gap gap, bool consolidate = true) {
       available_ += gap.size();
       if(consolidate) {
-        auto it = gaps_.begin();
-        std::vector<decltype(it)> adjacent;
-        while(it != gaps_.end()) {
-          if(gap.adjacent(*it)) {
-            gap = gap.combine(*it);
-            adjacent.push_back(it);
+        // only the gaps starting right after and ending right before the new
+        // gap can be adjacent, both are found via the address index
+        auto next = gapsByAddress_.lower_bound(gap.data());
+        if(next != gapsByAddress_.end()
+           && next->first == gap.data() + gap.size()) {
+          Gap nextGap(next->first, next->second);
+          gapsByAddress_.erase(next);
+          gaps_.erase(nextGap);
+          gap = gap.combine(nextGap);
+        }
+
+        auto prev = gapsByAddress_.lower_bound(gap.data());
+        if(prev != gapsByAddress_.begin()) {
+          --prev;
+          if(prev->first + prev->second == gap.data()) {
+            Gap prevGap(prev->first, prev->second);
+            gapsByAddress_.erase(prev);
+            gaps_.erase(prevGap);
+            gap = gap.combine(prevGap);
           }
-          it++;
         }
-        for(auto&& a : adjacent)
-          gaps_.erase(a);
       }
-      gaps_.insert(gap);
+      addGap(gap);
     }
 
   public:
+    using AllocatorBase::alloc;
 
     Allocator(size_t deviceNo, size_t bytes, size_t step, size_t alignment=256)
     : device_(deviceNo, alignment), step_(step), available_(0), alignment_(alignment) {
@@ -159,29 +261,36 @@ class Allocator {
       clear();
     }
 
-    template <typename T>
-    size_t capacity(size_t num) {
-      return align(num * sizeof(T));
-    }
-
-    template <typename T>
-    Ptr<MemoryPiece> alloc(size_t num) {
-      return alloc(capacity<T>(num));
+    // Grows the memory until the gap at its end holds bytes, so that pieces
+    // of up to bytes in total can be allocated without growing
+    void ensure(size_t bytes) {
+      bytes = align(bytes);
+      size_t tail = 0;
+      if(!gapsByAddress_.empty()) {
+        auto last = --gapsByAddress_.end();
+        if(last->first + last->second == device_.data() + device_.size())
+          tail = last->second;
+      }
+      if(tail < bytes)
+        grow(bytes - tail);
     }
 
     Ptr<MemoryPiece> alloc(size_t bytes) {
       bytes = align(bytes);
       Gap gap = getGap(bytes);
 
-      gaps_.erase(gap);
+      removeGap(gap);
       if(gap.size() > bytes) {
         insertGap(gap.rest(bytes), false);
       }
 
       auto ptr = gap.data();
-      auto mp = New<MemoryPiece>(ptr, bytes);
+      auto mp = NewPooled<MemoryPiece>(ptr, bytes);
       allocated_[ptr] = mp;
 
+      live_ += bytes;
+      peak_ = std::max(peak_, live_);
+
       return mp;
     }
 
@@ -197,6 +306,7 @@ class Allocator {
       if(it != allocated_.end()) {
         allocated_.erase(ptr);
         insertGap(Gap(ptr, bytes), true);
+        live_ -= bytes;
         return true;
       }
       return false;
@@ -212,7 +322,9 @@ class Allocator {
 
     void clear() {
       available_ = 0;
+      live_ = 0;
       gaps_.clear();
+      gapsByAddress_.clear();
       allocated_.clear();
       insertGap({device_.data(), device_.size()}, false);
     }
@@ -226,6 +338,18 @@ class Allocator {
     size_t available() { return available_; }
 
     size_t getDevice() { return device_.getDevice(); }
+
+    AllocatorStats stats() {
+      AllocatorStats s;
+      s.capacity = device_.size();
+      s.live = live_;
+      s.peak = peak_;
+      s.gaps = gaps_.size();
+      s.largestGap = gaps_.empty() ? 0 : gaps_.rbegin()->size();
+      s.grows = grows_;
+      s.growSeconds = growSeconds_;
+      return s;
+    }
 };
 
 }
@@ -0,0 +1,95 @@
+#include "tensors/device_cpu.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "3rd_party/exception.h"
+
+namespace marian {
+
+size_t DeviceCPU::reserveFactor = 4;
+size_t DeviceCPU::minReserve = (size_t)1024 * 1024 * 1024;
+bool DeviceCPU::hugePages = false;
+
+namespace {
+const size_t HUGE_PAGE = 2 * 1024 * 1024;
+}
+
+DeviceCPU::~DeviceCPU() {
+  release();
+}
+
+void DeviceCPU::release() {
+  if(mapped_)
+    munmap(mapped_, reserved_);
+  else if(data_)
+    std::free(data_);
+  mapped_ = 0;
+  reserved_ = 0;
+  data_ = 0;
+}
+
+bool DeviceCPU::map(size_t size) {
+  if(!mapped_) {
+    size_t reserve = std::max(size * reserveFactor, minReserve) + HUGE_PAGE;
+    void* range = mmap(nullptr, reserve, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(range == MAP_FAILED)
+      return false;
+
+    mapped_ = (uint8_t*)range;
+    reserved_ = reserve;
+
+    // start at a huge page boundary so that the kernel can use huge pages
+    data_ = (uint8_t*)(((uintptr_t)mapped_ + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1));
+  }
+
+  if(data_ + size > mapped_ + reserved_)
+    return false;
+
+  // commit pages of the new size, existing contents stay in place
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t commit = (size + page - 1) / page * page;
+  if(mprotect(data_, commit, PROT_READ | PROT_WRITE) != 0)
+    return false;
+
+#ifdef MADV_HUGEPAGE
+  if(hugePages)
+    madvise(data_, commit, MADV_HUGEPAGE);
+#endif
+
+  return true;
+}
+
+void DeviceCPU::reserve(size_t size) {
+  size = align(size);
+
+  UTIL_THROW_IF2(size < size_, "New size must be larger than old size");
+
+  // the range is sized from the first real reservation
+  if(size == 0)
+    return;
+
+  if(reserveFactor > 0 && (mapped_ || !data_) && map(size)) {
+    size_ = size;
+    return;
+  }
+
+  // Keep the alignment guarantees of the GPU allocator so that
+  // vectorized host kernels can rely on aligned rows
+  void* temp = nullptr;
+  UTIL_THROW_IF2(posix_memalign(&temp, alignment_, size) != 0,
+                 "Could not allocate " << size << " bytes of host memory");
+
+  if(data_)
+    std::memcpy(temp, data_, size_);
+  release();
+
+  data_ = (uint8_t*)temp;
+  size_ = size;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+namespace marian {
+
+/**
+ * @brief Host memory counterpart of DeviceGPU, can be used as the Device of
+ * an Allocator to keep tensors in main memory.
+ *
+ * On the first reservation a range of virtual addresses several times its
+ * size is reserved and pages are committed on demand, so growing the device
+ * within the range never moves memory and pointers into it stay valid. If
+ * the range cannot be reserved or committed (e.g. due to address space
+ * limits) or a grow exceeds it, memory is reallocated and copied like on the
+ * GPU from then on.
+ */
+class DeviceCPU {
+private:
+  uint8_t* data_;
+  size_t size_;
+  size_t device_;
+  size_t alignment_;
+
+  // reserved virtual range if memory is mapped, 0 otherwise
+  uint8_t* mapped_;
+  size_t reserved_;
+
+  size_t align(size_t size) {
+    return ceil(size / (float)alignment_) * alignment_;
+  }
+
+  bool map(size_t size);
+  void release();
+
+public:
+  /**
+   * @brief Address space reserved per device as a multiple of its first
+   * reservation, e.g. the configured workspace, 0 disables mapping
+   */
+  static size_t reserveFactor;
+
+  /** @brief Least bytes of address space reserved per device */
+  static size_t minReserve;
+
+  /** @brief Advise the kernel to back committed memory with huge pages */
+  static bool hugePages;
+
+  DeviceCPU(size_t device, size_t alignment=256)
+   : data_(0), size_(0),
+     device_(device),
+     alignment_(alignment),
+     mapped_(0), reserved_(0) {}
+
+  ~DeviceCPU();
+
+  void reserve(size_t size);
+
+  uint8_t* data() { return data_; }
+
+  size_t size() { return size_; }
+
+  size_t getDevice() { return device_; }
+
+  /** @brief True if memory lives in a reserved range and grows in place */
+  bool mapped() { return mapped_ != 0; }
+};
+
+}
@@ -19,6 +19,9 @@ __global__ void gFill(float *d_in, int size, float val) {
 }
 
 float TensorBase::get(size_t i) {
+  if(type_ == DeviceType::cpu)
+    return data()[i];
+
   cudaSetDevice(device_);
   float temp;
   CUDA_CHECK(
@@ -28,6 +31,11 @@ float TensorBase::get(size_t i) {
 }
 
 void TensorBase::set(size_t i, float value) {
+  if(type_ == DeviceType::cpu) {
+    data()[i] = value;
+    return;
+  }
+
   cudaSetDevice(device_);
   CUDA_CHECK(
       cudaMemcpy(data() + i, &value, sizeof(float), cudaMemcpyHostToDevice));
@@ -35,6 +43,11 @@ void TensorBase::set(size_t i, float value) {
 }
 
 void TensorBase::get(std::vector<float> &v) {
+  if(type_ == DeviceType::cpu) {
+    v.assign(data(), data() + size());
+    return;
+  }
+
   CUDA_CHECK(cudaSetDevice(device_));
   v.resize(size());
   CUDA_CHECK(cudaMemcpy(
@@ -43,6 +56,11 @@ void TensorBase::get(std::vector<float> &v) {
 }
 
 void TensorBase::set(float value) {
+  if(type_ == DeviceType::cpu) {
+    std::fill(data(), data() + size(), value);
+    return;
+  }
+
   cudaSetDevice(device_);
   int threads = std::min(512, (int)size());
   int blocks = (size() / threads) + (size() % threads != 0);
@@ -51,6 +69,11 @@ void TensorBase::set(float value) {
 }
 
 void TensorBase::set(const std::vector<float> &v) {
+  if(type_ == DeviceType::cpu) {
+    std::copy(v.begin(), v.end(), data());
+    return;
+  }
+
   CUDA_CHECK(cudaSetDevice(device_));
   CUDA_CHECK(cudaMemcpy(
       data(), v.data(), v.size() * sizeof(float), cudaMemcpyHostToDevice));
@@ -59,24 +82,45 @@ void TensorBase::set(const std::vector<float> &v) {
 
 void TensorBase::setSparse(const std::vector<size_t> &k,
                            const std::vector<float> &v) {
+  if(type_ == DeviceType::cpu) {
+    for(size_t i = 0; i < k.size(); ++i)
+      data()[k[i]] = v[i];
+    return;
+  }
+
   cudaSetDevice(device_);
   SetSparse(data(), k, v);
   cudaStreamSynchronize(0);
 }
 
-void TensorBase::copyFrom(Tensor in) {
-  cudaSetDevice(device_);
+void TensorView::copyFrom(TensorView in) const {
+  if(type_ == DeviceType::cpu && in.getDeviceType() == DeviceType::cpu) {
+    std::copy(in.data(), in.data() + in.size(), data_);
+    return;
+  }
+
+  // at least one side lives on a GPU, cudaMemcpyDefault resolves direction
+  cudaSetDevice(type_ == DeviceType::gpu ? device_ : in.getDevice());
   CUDA_CHECK(cudaMemcpy(
-      data(), (float*)in->data(), in->size() * sizeof(float), cudaMemcpyDefault));
+      data_, in.data(), in.size() * sizeof(float), cudaMemcpyDefault));
   cudaStreamSynchronize(0);
 }
 
+void TensorBase::copyFrom(Tensor in) {
+  view().copyFrom(in->view());
+}
+
+void TensorBase::copyFrom(TensorView in) {
+  view().copyFrom(in);
+}
+
 std::string TensorBase::debug() {
-  cudaSetDevice(device_);
   std::stringstream strm;
   assert(shape_.size());
   strm << shape_;
   strm << " device=" << device_;
+  if(type_ == DeviceType::cpu)
+    strm << " (cpu)";
   strm << " ptr=" << (size_t)memory_->data();
   strm << " bytes=" << memory_->size();
   strm << std::endl;
@@ -7,20 +7,65 @@
 
 #include "3rd_party/exception.h"
 #include "common/definitions.h"
+#include "common/pool_allocator.h"
 #include "common/shape.h"
 #include "tensors/memory_piece.h"
 
 namespace marian {
 
+/**
+ * @brief Non-owning view of tensor memory.
+ *
+ * Views are plain values and do not touch the heap; the memory they point to
+ * has to outlive them. Templated kernels dereference their arguments with ->,
+ * so views can be passed wherever a Tensor is expected by such kernels.
+ */
+class TensorView {
+private:
+  float* data_;
+  Shape shape_;
+  size_t device_;
+  DeviceType type_;
+
+public:
+  TensorView(float* data,
+             Shape shape,
+             size_t device,
+             DeviceType type = DeviceType::gpu)
+      : data_(data), shape_(shape), device_(device), type_(type) {}
+
+  float* data() const { return data_; }
+
+  const Shape& shape() const { return shape_; }
+
+  size_t size() const { return shape_.elements(); }
+
+  size_t getDevice() const { return device_; }
+
+  DeviceType getDeviceType() const { return type_; }
+
+  const TensorView* operator->() const { return this; }
+
+  TensorView subview(int offset, int size) const {
+    return TensorView(data_ + offset, {1, size}, device_, type_);
+  }
+
+  void copyFrom(TensorView in) const;
+};
+
 class TensorBase : public std::enable_shared_from_this<TensorBase> {
 private:
   Ptr<MemoryPiece> memory_;
   Shape shape_;
   size_t device_;
+  DeviceType type_;
 
 public:
-  TensorBase(Ptr<MemoryPiece> memory, Shape shape, size_t device)
-      : memory_(memory), shape_(shape), device_(device) {}
+  TensorBase(Ptr<MemoryPiece> memory,
+             Shape shape,
+             size_t device,
+             DeviceType type = DeviceType::gpu)
+      : memory_(memory), shape_(shape), device_(device), type_(type) {}
 
   ~TensorBase() {}
 
@@ -41,10 +86,21 @@ public:
 
   size_t getDevice() { return device_; }
 
+  DeviceType getDeviceType() { return type_; }
+
+  /** @brief Owning tensor sharing a range of this tensor's memory */
   Tensor subtensor(int offset, int size) {
-    auto mem = New<MemoryPiece>(memory_->data() + sizeof(float) * offset,
-                                sizeof(float) * size);
-    return Tensor(new TensorBase(mem, {1, size}, device_));
+    auto mem = NewPooled<MemoryPiece>(
+        memory_->data() + sizeof(float) * offset, sizeof(float) * size);
+    return NewPooled<TensorBase>(mem, Shape({1, size}), device_, type_);
+  }
+
+  /** @brief Non-owning view of the whole tensor */
+  TensorView view() { return TensorView(data(), shape_, device_, type_); }
+
+  /** @brief Non-owning view of a range of the tensor, cheaper than subtensor */
+  TensorView view(int offset, int size) {
+    return TensorView(data() + offset, {1, size}, device_, type_);
   }
 
   float get(size_t i);
@@ -61,6 +117,8 @@ public:
 
   void copyFrom(Tensor);
 
+  void copyFrom(TensorView);
+
   std::string debug();
 };
 
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <deque>
+#include <map>
 #include <set>
+#include <sstream>
+#include <unordered_map>
 
 #include "common/definitions.h"
 #include "tensors/tensor.h"
 #include "tensors/allocator.h"
+#include "tensors/device_cpu.h"
 #include "tensors/device_gpu.h"
 
 namespace marian {
@@ -17,13 +21,52 @@ private:
   const size_t GROW = CHUNK * MBYTE;
   const size_t ALIGN = 256;
 
-  Ptr<Allocator<DeviceGPU>> allocator_;
+  Ptr<AllocatorBase> allocator_;
+  DeviceType type_;
+
+  // allocations attributed to the operation (node type) requesting them
+  struct TypeStats {
+    size_t count{0};
+    size_t bytes{0};
+    size_t live{0};
+    size_t peak{0};
+  };
+  std::map<std::string, TypeStats> byType_;
+  std::unordered_map<uint8_t*, TypeStats*> liveByPtr_;
+  // start of the workspace the keys of liveByPtr_ refer to and the number
+  // of times it has grown since
+  uint8_t* base_{nullptr};
+  size_t grows_{0};
+
+  // the allocator moves all pieces by the same distance if it reallocates
+  void relocate() {
+    size_t grows = allocator_->stats().grows;
+    if(grows == grows_)
+      return;
+    grows_ = grows;
+    uint8_t* base = allocator_->memory()->data();
+    if(base == base_)
+      return;
+    std::unordered_map<uint8_t*, TypeStats*> moved;
+    for(auto& it : liveByPtr_)
+      moved[base + (it.first - base_)] = it.second;
+    liveByPtr_.swap(moved);
+    base_ = base;
+  }
 
+  Ptr<AllocatorBase> newAllocator(size_t device, DeviceType type) {
+    if(type == DeviceType::cpu)
+      return New<Allocator<DeviceCPU>>(device, 0, GROW, ALIGN);
+    else
+      return New<Allocator<DeviceGPU>>(device, 0, GROW, ALIGN);
+  }
 
 public:
-  TensorAllocator(size_t device)
-    : allocator_(New<Allocator<DeviceGPU>>(device, 0, GROW, ALIGN))
-  {}
+  TensorAllocator(size_t device, DeviceType type = DeviceType::gpu)
+    : allocator_(newAllocator(device, type)), type_(type) {
+    base_ = allocator_->memory()->data();
+    grows_ = allocator_->stats().grows;
+  }
 
   ~TensorAllocator() { clear(); }
 
@@ -39,6 +82,7 @@ public:
         allocator_->getDevice());
 
     allocator_->reserve(mult * GROW);
+    clear();
   }
 
   void reserveExact(size_t bytes = 0) {
@@ -49,36 +93,102 @@ public:
         allocator_->getDevice());
 
     allocator_->reserve(bytes);
+    clear();
+  }
+
+  /**
+   * @brief Grows the workspace so that tensors of up to bytes in total can be
+   * allocated without moving the workspace, e.g. while other threads use it
+   */
+  void ensure(size_t bytes) {
+    allocator_->ensure(bytes);
+    relocate();
   }
 
   void clear() {
     allocator_->clear();
+    for(auto& it : byType_)
+      it.second.live = 0;
+    liveByPtr_.clear();
+    base_ = allocator_->memory()->data();
+    grows_ = allocator_->stats().grows;
   }
 
   size_t capacity(Shape shape) {
     return allocator_->capacity<float>(shape.elements());
   }
 
-  void allocate(Tensor& t, Shape shape) {
+  void allocate(Tensor& t, Shape shape, const std::string& type = "other") {
     if(!t || t->shape() != shape) {
       int size = shape.elements();
       auto mem = allocator_->alloc<float>(size);
-      t = Tensor(new TensorBase(mem, shape, allocator_->getDevice()));
+      relocate();
+      t = NewPooled<TensorBase>(mem, shape, allocator_->getDevice(), type_);
+
+      auto& stats = byType_[type];
+      stats.count++;
+      stats.bytes += mem->size();
+      stats.live += mem->size();
+      stats.peak = std::max(stats.peak, stats.live);
+      liveByPtr_[mem->data()] = &stats;
     }
   }
 
   void free(Tensor& t) {
-    allocator_->free(t->memory());
+    uint8_t* ptr = t->memory()->data();
+    size_t bytes = t->memory()->size();
+    if(allocator_->free(t->memory())) {
+      auto it = liveByPtr_.find(ptr);
+      if(it != liveByPtr_.end()) {
+        it->second->live -= bytes;
+        liveByPtr_.erase(it);
+      }
+    }
   }
 
   Tensor asTensor() {
     auto mem = allocator_->memory();
     int size = mem->size() / sizeof(float);
-    return Tensor(new TensorBase(mem, {1, size}, allocator_->getDevice()));
+    return Tensor(
+        new TensorBase(mem, {1, size}, allocator_->getDevice(), type_));
   }
 
   size_t size() { return allocator_->size() / sizeof(float); }
 
+  DeviceType getDeviceType() { return type_; }
+
+  AllocatorStats stats() { return allocator_->stats(); }
+
+  /**
+   * @brief Allocator statistics and per-operation attribution as a JSON
+   * object, sizes in bytes.
+   */
+  std::string statsJson() {
+    auto s = stats();
+    std::stringstream json;
+    json << "{\"device\": " << allocator_->getDevice()
+         << ", \"type\": \"" << (type_ == DeviceType::cpu ? "cpu" : "gpu")
+         << "\", \"capacity\": " << s.capacity
+         << ", \"live\": " << s.live
+         << ", \"peak\": " << s.peak
+         << ", \"gaps\": " << s.gaps
+         << ", \"largest_gap\": " << s.largestGap
+         << ", \"grows\": " << s.grows
+         << ", \"grow_seconds\": " << s.growSeconds
+         << ", \"operations\": {";
+    bool first = true;
+    for(auto& it : byType_) {
+      json << (first ? "" : ", ") << "\"" << it.first << "\": {"
+           << "\"count\": " << it.second.count
+           << ", \"bytes\": " << it.second.bytes
+           << ", \"live\": " << it.second.live
+           << ", \"peak\": " << it.second.peak << "}";
+      first = false;
+    }
+    json << "}}";
+    return json.str();
+  }
+
 };
 
 }
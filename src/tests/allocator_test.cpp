@@ -1,59 +1,62 @@
 #include <boost/timer/timer.hpp>
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <cmath>
+#include <random>
+#include <vector>
 
 #include "3rd_party/exception.h"
 #include "tensors/allocator.h"
-#include "tensors/device_gpu.h"
-
-class DeviceCPU {
-private:
-  uint8_t* data_;
-  size_t size_;
-  size_t alignment_;
-
-public:
-  DeviceCPU(size_t device, size_t alignment = 256)
-   : data_(0), size_(0), alignment_(alignment) {}
-
-  ~DeviceCPU() { delete[] data_; }
-
-  size_t align(size_t size) {
-    return ceil(size / (float)alignment_) * alignment_;
-  }
-
-  void reserve(size_t size) {
-    size = align(size);
-    UTIL_THROW_IF2(size < size_, "New size must be larger than old size");
-
-    if(data_) {
-      // Allocate memory by going through host memory
-      uint8_t *temp = new uint8_t[size_];
-      std::copy(data_, data_ + size_, temp);
-      std::fill(data_, data_ + size_, 0);
-      delete[] data_;
-      data_ = new uint8_t[size];
-      std::copy(temp, temp + size_, data_);
-      delete[] temp;
-    } else {
-      data_ = new uint8_t[size];
+#include "tensors/device_cpu.h"
+
+using namespace marian;
+
+// Simulates the life cycle of a graph with many nodes: every node allocates
+// a tensor during the forward pass and all of them are released when the
+// graph is cleared, in creation order and in random order.
+void benchmark(size_t nodes, size_t repeats) {
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<size_t> floats(1, 4096);
+
+  std::vector<size_t> sizes(nodes);
+  for(auto& size : sizes)
+    size = floats(gen);
+
+  auto a = New<Allocator<DeviceCPU>>(0, 0, 128 * 1024 * 1024, 256);
+
+  std::vector<Ptr<MemoryPiece>> pieces(nodes);
+  for(auto order : {"in order", "shuffled"}) {
+    boost::timer::cpu_timer allocTimer, freeTimer;
+    allocTimer.stop();
+    freeTimer.stop();
+
+    for(size_t r = 0; r < repeats; ++r) {
+      allocTimer.resume();
+      for(size_t i = 0; i < nodes; ++i)
+        pieces[i] = a->alloc<float>(sizes[i]);
+      allocTimer.stop();
+
+      if(std::string(order) == "shuffled")
+        std::shuffle(pieces.begin(), pieces.end(), gen);
+
+      freeTimer.resume();
+      for(auto& mp : pieces)
+        a->free(mp);
+      freeTimer.stop();
     }
 
-    size_ = size;
+    double allocSec = allocTimer.elapsed().wall / 1e9;
+    double freeSec = freeTimer.elapsed().wall / 1e9;
+    std::cerr << nodes << " nodes, free " << order << ": "
+              << (nodes * repeats) / allocSec << " allocs/s, "
+              << (nodes * repeats) / freeSec << " frees/s" << std::endl;
   }
-
-  uint8_t* data() { return data_; }
-
-  size_t size() { return size_; }
-
-  size_t getDevice() { return 0; }
-};
+}
 
 int main(int argc, char** argv) {
-  using namespace marian;
 
-  auto a = New<Allocator<DeviceGPU>>(0, 0, 30000, 256);
+  auto a = New<Allocator<DeviceCPU>>(0, 0, 30000, 256);
   std::cerr << "Size: " << a->size() << std::endl;
 
   auto mem1 = a->alloc<int>(100000);
@@ -73,5 +76,7 @@ int main(int argc, char** argv) {
   std::cerr << "mem3: " << *mem3 << std::endl;
   std::cerr << "Size: " << a->size() << std::endl;
 
+  benchmark(100000, 5);
+
   return 0;
 }
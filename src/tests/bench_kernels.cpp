@@ -0,0 +1,703 @@
+#include <boost/program_options.hpp>
+#include <boost/timer/timer.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "3rd_party/exception.h"
+#include "kernels/attention_cpu.h"
+#include "kernels/prod_cpu.h"
+#include "kernels/prod_half_cpu.h"
+#include "kernels/prod_int8_cpu.h"
+#include "kernels/math_cpu.h"
+#include "kernels/normalization_cpu.h"
+#include "kernels/rnn_cpu.h"
+#include "kernels/softmax_cpu.h"
+#include "kernels/tensor_operators_cpu.h"
+#include "tests/host_tensor.h"
+
+using namespace marian;
+namespace po = boost::program_options;
+
+typedef std::function<void(bool, bool, int, int, int, float,
+                           const float*, int, const float*, int,
+                           float, float*, int)> Gemm;
+
+// GFLOP/s of C = A * B with A of size m x k and B of size k x n
+void benchGemm(const std::string& name, Gemm gemm,
+               int m, int k, int n, size_t repeats) {
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+
+  std::vector<float> A(m * k), B(k * n), C(m * n);
+  for(auto& a : A)
+    a = dist(gen);
+  for(auto& b : B)
+    b = dist(gen);
+
+  // warm caches and thread pool
+  gemm(false, false, m, n, k, 1.f, A.data(), k, B.data(), n, 0.f, C.data(), n);
+
+  boost::timer::cpu_timer timer;
+  for(size_t r = 0; r < repeats; ++r)
+    gemm(false, false, m, n, k, 1.f, A.data(), k, B.data(), n, 0.f, C.data(), n);
+  double sec = timer.elapsed().wall / 1e9;
+
+  std::cerr << name << " " << m << "x" << k << " * " << k << "x" << n << ": "
+            << 2.0 * m * n * k * repeats / sec / 1e9 << " GFLOP/s" << std::endl;
+}
+
+// GFLOP/s of a batch of products as in attention over a batch of sentences
+void benchProdBatched(int batch, int m, int k, int n, size_t repeats) {
+  std::vector<float> A(batch * m * k, 0.1f), B(batch * k * n, 0.2f),
+      C(batch * m * n);
+  auto a = hostTensor(A, {m, k, batch, 1});
+  auto b = hostTensor(B, {k, n, batch, 1});
+  auto c = hostTensor(C, {m, n, batch, 1});
+
+  cpu::ProdBatched(c, a, b, false, false);
+
+  boost::timer::cpu_timer timer;
+  for(size_t r = 0; r < repeats; ++r)
+    cpu::ProdBatched(c, a, b, false, false);
+  double sec = timer.elapsed().wall / 1e9;
+
+  std::cerr << "batched " << batch << " x " << m << "x" << k << " * " << k
+            << "x" << n << ": " << 2.0 * batch * m * n * k * repeats / sec / 1e9
+            << " GFLOP/s" << std::endl;
+}
+
+// Target tokens per second of a single sentence during beam search, counting
+// the products of one decoder step: the recurrent transition of a GRU with
+// state size dim and the output layer over the vocabulary.
+void benchDecoderStep(int beam, int dim, int emb, int vocab, size_t repeats) {
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  auto random = [&] { return 0.1f * dist(gen); };
+
+  std::vector<float> vS, vU, vG, vH, vW, vL;
+  auto state = hostTensor(vS, {beam, dim}, random);
+  auto U = hostTensor(vU, {dim, 3 * dim}, random);
+  auto gates = hostTensor(vG, {beam, 3 * dim}, random);
+  auto hidden = hostTensor(vH, {beam, emb}, random);
+  auto W = hostTensor(vW, {emb, vocab}, random);
+  auto logits = hostTensor(vL, {beam, vocab}, random);
+
+  cpu::QuantizedMatrix qU(U, false);
+  cpu::QuantizedMatrix qW(W, false);
+  cpu::HalfMatrix hU(U, false, cpu::HalfType::bf16);
+  cpu::HalfMatrix hW(W, false, cpu::HalfType::bf16);
+
+  auto run = [&](const std::string& name, std::function<void()> step) {
+    step();
+    boost::timer::cpu_timer timer;
+    for(size_t r = 0; r < repeats; ++r)
+      step();
+    double sec = timer.elapsed().wall / 1e9;
+    std::cerr << "decoder step " << name << " beam " << beam << ", dim "
+              << dim << ", vocab " << vocab << ": " << repeats / sec
+              << " tokens/s" << std::endl;
+  };
+
+  run("fp32", [&]() {
+    cpu::Prod(gates, state, U, false, false);
+    cpu::Prod(logits, hidden, W, false, false);
+  });
+  run("int8", [&]() {
+    cpu::ProdInt8(gates, state, qU, false);
+    cpu::ProdInt8(logits, hidden, qW, false);
+  });
+  run("bf16", [&]() {
+    cpu::ProdHalf(gates, state, hU, false);
+    cpu::ProdHalf(logits, hidden, hW, false);
+  });
+}
+
+// Microseconds per call of the fused GRU kernels for a batch of states
+void benchGRU(int batch, int dim, size_t repeats) {
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  auto random = [&] { return dist(gen); };
+
+  std::vector<float> vS, vX, vU, vB, vO, vA, gS, gX, gU, gB;
+  std::vector<Tensor> inputs = {hostTensor(vS, {batch, dim}, random),
+                                hostTensor(vX, {batch, 3 * dim}, random),
+                                hostTensor(vU, {batch, 3 * dim}, random),
+                                hostTensor(vB, {1, 3 * dim}, random)};
+  std::vector<Tensor> grads = {hostTensor(gS, {batch, dim}, random),
+                               hostTensor(gX, {batch, 3 * dim}, random),
+                               hostTensor(gU, {batch, 3 * dim}, random),
+                               hostTensor(gB, {1, 3 * dim}, random)};
+  auto out = hostTensor(vO, {batch, dim}, random);
+  auto adj = hostTensor(vA, {batch, dim}, random);
+
+  cpu::GRUFastForward(out, inputs);
+  boost::timer::cpu_timer timer;
+  for(size_t r = 0; r < repeats; ++r)
+    cpu::GRUFastForward(out, inputs);
+  double forward = timer.elapsed().wall / 1e3 / repeats;
+
+  timer.start();
+  for(size_t r = 0; r < repeats; ++r)
+    cpu::GRUFastBackward(grads, inputs, adj);
+  double backward = timer.elapsed().wall / 1e3 / repeats;
+
+  std::cerr << "gru batch " << batch << ", dim " << dim << ": forward "
+            << forward << " us, backward " << backward << " us" << std::endl;
+}
+
+// Microseconds per call of the fused LSTM kernels for a batch of states,
+// cell and output together
+void benchLSTM(int batch, int dim, size_t repeats) {
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  auto random = [&] { return dist(gen); };
+
+  std::vector<float> vC, vX, vU, vB, vCo, vO, vA, gC, gX, gU, gB;
+  std::vector<Tensor> inputs = {hostTensor(vC, {batch, dim}, random),
+                                hostTensor(vX, {batch, 4 * dim}, random),
+                                hostTensor(vU, {batch, 4 * dim}, random),
+                                hostTensor(vB, {1, 4 * dim}, random)};
+  std::vector<Tensor> grads = {hostTensor(gC, {batch, dim}, random),
+                               hostTensor(gX, {batch, 4 * dim}, random),
+                               hostTensor(gU, {batch, 4 * dim}, random),
+                               hostTensor(gB, {1, 4 * dim}, random)};
+  auto cell = hostTensor(vCo, {batch, dim}, random);
+  auto out = hostTensor(vO, {batch, dim}, random);
+  auto adj = hostTensor(vA, {batch, dim}, random);
+  std::vector<Tensor> outInputs = {cell, inputs[1], inputs[2], inputs[3]};
+
+  auto forwardStep = [&]() {
+    cpu::LSTMCellForward(cell, inputs);
+    cpu::LSTMOutputForward(out, outInputs);
+  };
+
+  forwardStep();
+  boost::timer::cpu_timer timer;
+  for(size_t r = 0; r < repeats; ++r)
+    forwardStep();
+  double forward = timer.elapsed().wall / 1e3 / repeats;
+
+  timer.start();
+  for(size_t r = 0; r < repeats; ++r) {
+    cpu::LSTMOutputBackward(grads, outInputs, adj);
+    cpu::LSTMCellBackward(grads, inputs, adj);
+  }
+  double backward = timer.elapsed().wall / 1e3 / repeats;
+
+  std::cerr << "lstm batch " << batch << ", dim " << dim << ": forward "
+            << forward << " us, backward " << backward << " us" << std::endl;
+}
+
+// Microseconds per call of the softmax kernels over rows of the vocabulary
+// size, with full and approximate exponentials
+void benchSoftmax(int rows, int vocab, size_t repeats) {
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 3.f);
+  std::uniform_int_distribution<int> word(0, vocab - 1);
+  auto random = [&] { return dist(gen); };
+
+  std::vector<float> vIn, vOut, vGrad, vCE, vAdj, vPick;
+  auto in = hostTensor(vIn, {rows, vocab}, random);
+  auto out = hostTensor(vOut, {rows, vocab}, random);
+  auto grad = hostTensor(vGrad, {rows, vocab}, random);
+  auto ce = hostTensor(vCE, {rows, 1}, random);
+  auto adj = hostTensor(vAdj, {rows, 1}, random);
+  auto pick = hostTensor(vPick, {rows, 1}, random);
+  for(auto& p : vPick)
+    p = word(gen);
+
+  std::vector<std::pair<std::string, std::function<void()>>> kernels = {
+    {"softmax", [&]() { cpu::Softmax(out, in); }},
+    {"logsoftmax", [&]() { cpu::LogSoftmax(out, in); }},
+    {"cross-entropy", [&]() { cpu::CrossEntropyPick(ce, in, pick); }},
+    {"cross-entropy backward",
+     [&]() { cpu::CrossEntropyPickBackward(grad, adj, in, pick); }}
+  };
+
+  for(auto accuracy : {cpu::ExpAccuracy::full, cpu::ExpAccuracy::approximate}) {
+    cpu::expAccuracy() = accuracy;
+    for(auto& kernel : kernels) {
+      kernel.second();
+      boost::timer::cpu_timer timer;
+      for(size_t r = 0; r < repeats; ++r)
+        kernel.second();
+      double us = timer.elapsed().wall / 1e3 / repeats;
+      std::cerr << kernel.first
+                << (accuracy == cpu::ExpAccuracy::full ? "" : " (approx)")
+                << " " << rows << "x" << vocab << ": " << us << " us, "
+                << rows * vocab * sizeof(float) / us / 1e3 << " GB/s"
+                << std::endl;
+    }
+  }
+  cpu::expAccuracy() = cpu::ExpAccuracy::full;
+}
+
+// Microseconds per call of layer normalization and its gradient
+void benchLayerNorm(int rows, int cols, size_t repeats) {
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  auto random = [&] { return dist(gen); };
+
+  std::vector<float> vX, vY, vAdj, vGamma, vBeta, gX, gGamma, gBeta;
+  auto x = hostTensor(vX, {rows, cols}, random);
+  auto y = hostTensor(vY, {rows, cols}, random);
+  auto adj = hostTensor(vAdj, {rows, cols}, random);
+  auto gamma = hostTensor(vGamma, {1, cols}, random);
+  auto beta = hostTensor(vBeta, {1, cols}, random);
+  auto gradX = hostTensor(gX, {rows, cols}, random);
+  auto gradGamma = hostTensor(gGamma, {1, cols}, random);
+  auto gradBeta = hostTensor(gBeta, {1, cols}, random);
+
+  cpu::LayerNormalization(y, x, gamma, beta);
+  boost::timer::cpu_timer timer;
+  for(size_t r = 0; r < repeats; ++r)
+    cpu::LayerNormalization(y, x, gamma, beta);
+  double forward = timer.elapsed().wall / 1e3 / repeats;
+
+  timer.start();
+  for(size_t r = 0; r < repeats; ++r)
+    cpu::LayerNormalizationGrad(
+        gradX, gradGamma, gradBeta, adj, y, x, gamma, beta);
+  double backward = timer.elapsed().wall / 1e3 / repeats;
+
+  std::cerr << "layer normalization " << rows << "x" << cols << ": forward "
+            << forward << " us, backward " << backward << " us" << std::endl;
+}
+
+// Microseconds per call of the attention kernels for one decoder step of a
+// beam over a source sentence
+void benchAttention(int dimBeam, int dimSrc, int dimHidden, size_t repeats) {
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  auto random = [&] { return dist(gen); };
+
+  std::vector<float> vVa, vCtx, vState, vOut, vAdj, gVa, gCtx, gState;
+  auto va = hostTensor(vVa, {dimHidden, 1}, random);
+  auto ctx = hostTensor(vCtx, {1, dimHidden, dimSrc, 1}, random);
+  auto state = hostTensor(vState, {1, dimHidden, 1, dimBeam}, random);
+  auto out = hostTensor(vOut, {1, 1, dimSrc, dimBeam}, random);
+  auto adj = hostTensor(vAdj, {1, 1, dimSrc, dimBeam}, random);
+  auto gradVa = hostTensor(gVa, {dimHidden, 1}, random);
+  auto gradCtx = hostTensor(gCtx, {1, dimHidden, dimSrc, 1}, random);
+  auto gradState = hostTensor(gState, {1, dimHidden, 1, dimBeam}, random);
+
+  cpu::Att(out, va, ctx, state, nullptr);
+  boost::timer::cpu_timer timer;
+  for(size_t r = 0; r < repeats; ++r)
+    cpu::Att(out, va, ctx, state, nullptr);
+  double forward = timer.elapsed().wall / 1e3 / repeats;
+
+  timer.start();
+  for(size_t r = 0; r < repeats; ++r)
+    cpu::AttBack(gradVa, gradCtx, gradState, nullptr, va, ctx, state, nullptr,
+                 adj);
+  double backward = timer.elapsed().wall / 1e3 / repeats;
+
+  std::cerr << "attention beam " << dimBeam << ", source " << dimSrc
+            << ", dim " << dimHidden << ": forward " << forward
+            << " us, backward " << backward << " us" << std::endl;
+}
+
+// Bytes moved and floating point operations of one kernel call, used for
+// throughput figures. Bytes count every tensor read or written once.
+struct Cost {
+  double bytes;
+  double flops;
+};
+
+struct Result {
+  std::string kernel;
+  int rows;
+  int cols;
+  double us;
+  Cost cost;
+};
+
+// Tensors of one case of the shape grid. The generator is seeded anew for
+// every case, so a case does not depend on which cases ran before it.
+class GridCase {
+private:
+  std::mt19937 gen_;
+  // a list keeps the memory of earlier tensors in place
+  std::list<std::vector<float>> memory_;
+
+public:
+  GridCase(size_t seed) : gen_(seed) {}
+
+  Tensor tensor(Shape shape, float stddev = 1.f) {
+    std::normal_distribution<float> dist(0.f, stddev);
+    memory_.emplace_back();
+    return hostTensor(memory_.back(), shape, [&] { return dist(gen_); });
+  }
+
+  // Tensor of row indices in [0, range) as used by Pick kernels
+  Tensor indices(int size, int range) {
+    std::uniform_int_distribution<int> dist(0, range - 1);
+    memory_.emplace_back();
+    return hostTensor(
+        memory_.back(), {size, 1}, [&] { return (float)dist(gen_); });
+  }
+};
+
+// Sets up the tensors of a rows x cols case, fills in its cost and returns
+// the call to time
+typedef std::function<std::function<void()>(GridCase&, int, int, Cost&)>
+    Setup;
+
+const double F = sizeof(float);
+
+typedef std::pair<std::string, Setup> Kernel;
+
+std::vector<Kernel> gridKernels() {
+  return {
+    {"element-unary",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, cols});
+       auto in = b.tensor({rows, cols});
+       cost = {2 * F * rows * cols, 1. * rows * cols};
+       return [=]() {
+         cpu::Element([](float, float x) { return std::tanh(x); }, out, in);
+       };
+     }},
+    {"element-binary",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, cols});
+       auto in1 = b.tensor({rows, cols});
+       auto in2 = b.tensor({1, cols});
+       cost = {F * (2 * rows * cols + cols), 2. * rows * cols};
+       return [=]() {
+         cpu::Element([](float o, float x, float y) { return x * y + o; },
+                      out, in1, in2);
+       };
+     }},
+    {"element-ternary",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, cols});
+       auto in1 = b.tensor({rows, cols});
+       auto in2 = b.tensor({rows, cols});
+       auto in3 = b.tensor({1, cols});
+       cost = {F * (3 * rows * cols + cols), 3. * rows * cols};
+       auto functor = [](float, float x, float y, float z) {
+         return std::tanh(x + y + z);
+       };
+       return [=]() { cpu::Element(functor, out, in1, in2, in3); };
+     }},
+    {"add-rows",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({1, cols});
+       auto in = b.tensor({rows, cols});
+       cost = {F * (rows * cols + cols), 1. * rows * cols};
+       return [=]() { cpu::Add([](float x) { return x; }, out, in); };
+     }},
+    {"reduce-cols",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, 1});
+       auto in = b.tensor({rows, cols});
+       cost = {F * (rows * cols + rows), 2. * rows * cols};
+       return [=]() { cpu::Add([](float x) { return x * x; }, out, in); };
+     }},
+    {"prod",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto C = b.tensor({rows, cols});
+       auto A = b.tensor({rows, cols});
+       auto B = b.tensor({cols, cols});
+       cost = {F * (2 * rows * cols + cols * cols), 2. * rows * cols * cols};
+       return [=]() { cpu::Prod(C, A, B, false, false); };
+     }},
+    {"softmax",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, cols});
+       auto in = b.tensor({rows, cols}, 3.f);
+       cost = {2 * F * rows * cols, 4. * rows * cols};
+       return [=]() { cpu::Softmax(out, in); };
+     }},
+    {"logsoftmax",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, cols});
+       auto in = b.tensor({rows, cols}, 3.f);
+       cost = {2 * F * rows * cols, 4. * rows * cols};
+       return [=]() { cpu::LogSoftmax(out, in); };
+     }},
+    {"cross-entropy",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, 1});
+       auto in = b.tensor({rows, cols}, 3.f);
+       auto pick = b.indices(rows, cols);
+       cost = {F * (rows * cols + 2 * rows), 3. * rows * cols};
+       return [=]() { cpu::CrossEntropyPick(out, in, pick); };
+     }},
+    {"cross-entropy-backward",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto grad = b.tensor({rows, cols});
+       auto adj = b.tensor({rows, 1});
+       auto in = b.tensor({rows, cols}, 3.f);
+       auto pick = b.indices(rows, cols);
+       cost = {F * (3 * rows * cols + 2 * rows), 5. * rows * cols};
+       return [=]() { cpu::CrossEntropyPickBackward(grad, adj, in, pick); };
+     }},
+    {"gru-forward",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, cols});
+       std::vector<Tensor> in = {b.tensor({rows, cols}),
+                                 b.tensor({rows, 3 * cols}),
+                                 b.tensor({rows, 3 * cols}),
+                                 b.tensor({1, 3 * cols})};
+       cost = {F * (8 * rows * cols + 3 * cols), 20. * rows * cols};
+       return [=]() { cpu::GRUFastForward(out, in); };
+     }},
+    {"gru-backward",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       std::vector<Tensor> in = {b.tensor({rows, cols}),
+                                 b.tensor({rows, 3 * cols}),
+                                 b.tensor({rows, 3 * cols}),
+                                 b.tensor({1, 3 * cols})};
+       std::vector<Tensor> grads = {b.tensor({rows, cols}),
+                                    b.tensor({rows, 3 * cols}),
+                                    b.tensor({rows, 3 * cols}),
+                                    b.tensor({1, 3 * cols})};
+       auto adj = b.tensor({rows, cols});
+       cost = {F * (22 * rows * cols + 6 * cols), 40. * rows * cols};
+       return [=]() { cpu::GRUFastBackward(grads, in, adj); };
+     }},
+    {"lstm-forward",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto cell = b.tensor({rows, cols});
+       auto out = b.tensor({rows, cols});
+       std::vector<Tensor> in = {b.tensor({rows, cols}),
+                                 b.tensor({rows, 4 * cols}),
+                                 b.tensor({rows, 4 * cols}),
+                                 b.tensor({1, 4 * cols})};
+       std::vector<Tensor> outIn = {cell, in[1], in[2], in[3]};
+       cost = {F * (12 * rows * cols + 4 * cols), 25. * rows * cols};
+       return [=]() {
+         cpu::LSTMCellForward(cell, in);
+         cpu::LSTMOutputForward(out, outIn);
+       };
+     }},
+    {"lstm-backward",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       std::vector<Tensor> in = {b.tensor({rows, cols}),
+                                 b.tensor({rows, 4 * cols}),
+                                 b.tensor({rows, 4 * cols}),
+                                 b.tensor({1, 4 * cols})};
+       std::vector<Tensor> outIn
+           = {b.tensor({rows, cols}), in[1], in[2], in[3]};
+       std::vector<Tensor> grads = {b.tensor({rows, cols}),
+                                    b.tensor({rows, 4 * cols}),
+                                    b.tensor({rows, 4 * cols}),
+                                    b.tensor({1, 4 * cols})};
+       auto adj = b.tensor({rows, cols});
+       cost = {F * (30 * rows * cols + 8 * cols), 50. * rows * cols};
+       return [=]() {
+         cpu::LSTMOutputBackward(grads, outIn, adj);
+         cpu::LSTMCellBackward(grads, in, adj);
+       };
+     }},
+    {"layer-norm",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto out = b.tensor({rows, cols});
+       auto in = b.tensor({rows, cols});
+       auto gamma = b.tensor({1, cols});
+       auto beta = b.tensor({1, cols});
+       cost = {F * (2 * rows * cols + 2 * cols), 8. * rows * cols};
+       return [=]() { cpu::LayerNormalization(out, in, gamma, beta); };
+     }},
+    {"layer-norm-backward",
+     [](GridCase& b, int rows, int cols, Cost& cost) {
+       auto gradX = b.tensor({rows, cols});
+       auto gradGamma = b.tensor({1, cols});
+       auto gradBeta = b.tensor({1, cols});
+       auto adj = b.tensor({rows, cols});
+       auto y = b.tensor({rows, cols});
+       auto x = b.tensor({rows, cols});
+       auto gamma = b.tensor({1, cols});
+       auto beta = b.tensor({1, cols});
+       cost = {F * (5 * rows * cols + 6 * cols), 16. * rows * cols};
+       return [=]() {
+         cpu::LayerNormalizationGrad(
+             gradX, gradGamma, gradBeta, adj, y, x, gamma, beta);
+       };
+     }},
+  };
+}
+
+// Microseconds per call after warmup calls
+double timeCall(const std::function<void()>& call,
+                size_t warmup,
+                size_t repeats) {
+  for(size_t r = 0; r < warmup; ++r)
+    call();
+
+  boost::timer::cpu_timer timer;
+  for(size_t r = 0; r < repeats; ++r)
+    call();
+  return timer.elapsed().wall / 1e3 / repeats;
+}
+
+void printCsv(const std::vector<Result>& results) {
+  std::cout << "kernel,rows,cols,us,gb_per_s,gflop_per_s" << std::endl;
+  for(auto& r : results)
+    std::cout << r.kernel << "," << r.rows << "," << r.cols << "," << r.us
+              << "," << r.cost.bytes / r.us / 1e3 << ","
+              << r.cost.flops / r.us / 1e3 << std::endl;
+}
+
+void printJson(const std::vector<Result>& results,
+               size_t warmup,
+               size_t repeats,
+               size_t seed) {
+  std::cout << "{\"threads\": " << cpu::numThreads()
+            << ", \"warmup\": " << warmup << ", \"repeats\": " << repeats
+            << ", \"seed\": " << seed << ", \"results\": [";
+  for(size_t i = 0; i < results.size(); ++i) {
+    auto& r = results[i];
+    std::cout << (i ? ", " : "") << "{\"kernel\": \"" << r.kernel
+              << "\", \"rows\": " << r.rows << ", \"cols\": " << r.cols
+              << ", \"us\": " << r.us
+              << ", \"gb_per_s\": " << r.cost.bytes / r.us / 1e3
+              << ", \"gflop_per_s\": " << r.cost.flops / r.us / 1e3 << "}";
+  }
+  std::cout << "]}" << std::endl;
+}
+
+// The fixed scenarios above at the sizes of typical models
+void benchScenarios() {
+  std::vector<std::pair<std::string, Gemm>> kernels = {
+#if BLAS_FOUND
+    {"cblas", cpu::gemm},
+#endif
+    {"blocked", cpu::gemmBlocked}
+  };
+
+  for(auto& kernel : kernels) {
+    // hidden layers and output layer at a typical training batch
+    benchGemm(kernel.first, kernel.second, 80, 1024, 3072, 20);
+    benchGemm(kernel.first, kernel.second, 80, 512, 85000, 2);
+    // output layer during beam search
+    benchGemm(kernel.first, kernel.second, 12, 512, 85000, 5);
+  }
+
+  benchProdBatched(64, 50, 512, 1, 100);
+  benchProdBatched(64, 12, 512, 50, 100);
+
+  benchDecoderStep(1, 1024, 512, 85000, 20);
+  benchDecoderStep(12, 1024, 512, 85000, 20);
+
+  for(int batch : {1, 8, 32, 64, 128})
+    benchGRU(batch, 1024, 1000);
+  for(int batch : {1, 8, 32, 64, 128})
+    benchLSTM(batch, 1024, 1000);
+
+  benchSoftmax(12, 85000, 100);
+  benchSoftmax(80, 85000, 20);
+
+  for(int cols : {256, 512, 1024, 2048, 4096})
+    benchLayerNorm(64, cols, 1000);
+
+  for(int dimSrc : {10, 25, 50, 100, 200})
+    benchAttention(12, dimSrc, 1024, 1000);
+}
+
+int main(int argc, char** argv) {
+  auto all = gridKernels();
+  std::string names;
+  for(auto& k : all)
+    names += (names.empty() ? "" : ", ") + k.first;
+
+  po::options_description desc(
+      "Times the host kernels, by default over fixed scenarios at the sizes "
+      "of typical models",
+      80);
+  // clang-format off
+  desc.add_options()
+    ("grid", po::value<bool>()->zero_tokens()->default_value(false),
+      "Time the kernels over a grid of --rows x --cols shapes instead")
+    ("kernels", po::value<std::vector<std::string>>()->multitoken(),
+      ("Kernels of the grid, all by default: " + names).c_str())
+    ("rows", po::value<std::vector<int>>()->multitoken()
+      ->default_value(std::vector<int>({1, 12, 64, 512}), "1 12 64 512"),
+      "Row counts (batch size or batch x words) of the shape grid")
+    ("cols", po::value<std::vector<int>>()->multitoken()
+      ->default_value(std::vector<int>({256, 512, 1024, 2048}),
+                      "256 512 1024 2048"),
+      "Column counts (hidden or vocabulary size) of the shape grid")
+    ("warmup", po::value<size_t>()->default_value(3),
+      "Untimed calls before each measurement")
+    ("repeats", po::value<size_t>()->default_value(20),
+      "Timed calls per measurement")
+    ("seed", po::value<size_t>()->default_value(1234),
+      "Seed for the tensor contents")
+    ("format", po::value<std::string>()->default_value("csv"),
+      "Output format of the grid: csv or json")
+    ("help,h", po::value<bool>()->zero_tokens()->default_value(false),
+      "Print this help message and exit")
+    ;
+  // clang-format on
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+  } catch(std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl << std::endl;
+    std::cerr << desc << std::endl;
+    return 1;
+  }
+
+  if(vm["help"].as<bool>()) {
+    std::cerr << desc << std::endl;
+    return 0;
+  }
+
+  if(!vm["grid"].as<bool>()) {
+    benchScenarios();
+    return 0;
+  }
+
+  auto format = vm["format"].as<std::string>();
+  UTIL_THROW_IF2(format != "csv" && format != "json",
+                 "Unknown output format " << format);
+
+  std::vector<Kernel> selected;
+  if(vm.count("kernels")) {
+    for(auto& name : vm["kernels"].as<std::vector<std::string>>()) {
+      auto it = std::find_if(all.begin(), all.end(), [&](const Kernel& k) {
+        return k.first == name;
+      });
+      UTIL_THROW_IF2(it == all.end(), "Unknown kernel " << name);
+      selected.push_back(*it);
+    }
+  } else {
+    selected = all;
+  }
+
+  size_t warmup = vm["warmup"].as<size_t>();
+  size_t repeats = std::max<size_t>(1, vm["repeats"].as<size_t>());
+  size_t seed = vm["seed"].as<size_t>();
+
+  std::vector<Result> results;
+  for(auto& kernel : selected) {
+    for(int rows : vm["rows"].as<std::vector<int>>()) {
+      for(int cols : vm["cols"].as<std::vector<int>>()) {
+        GridCase grid(seed);
+        Result result{kernel.first, rows, cols, 0, Cost()};
+        auto call = kernel.second(grid, rows, cols, result.cost);
+        result.us = timeCall(call, warmup, repeats);
+        results.push_back(result);
+      }
+    }
+  }
+
+  if(format == "json")
+    printJson(results, warmup, repeats, seed);
+  else
+    printCsv(results);
+
+  return 0;
+}
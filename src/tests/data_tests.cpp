@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "catch.hpp"
+#include "common/config.h"
+#include "common/file_stream.h"
+#include "common/utils.h"
+#include "data/corpus.h"
+#include "data/line_index.h"
+
+using namespace marian;
+
+TEST_CASE("Lines are read through an index", "[data][cpu]") {
+  auto path = boost::filesystem::temp_directory_path()
+              / boost::filesystem::unique_path("lines-%%%%%%%%.txt");
+
+  // an empty line and a last line without a line break
+  std::vector<std::string> lines = {"a b c", "", "d", "e f"};
+  {
+    std::ofstream out(path.string());
+    out << "a b c\n\nd\ne f";
+  }
+
+  {
+    data::LineIndex index(path.string());
+    REQUIRE(index.size() == lines.size());
+
+    // random access in shuffled order reads the same lines
+    std::vector<size_t> ids = {2, 0, 3, 1};
+    for(auto id : ids)
+      CHECK(index.line(id) == lines[id]);
+  }
+
+  {
+    std::ofstream out(path.string(), std::ios::app);
+    out << "\n";
+  }
+  CHECK(data::LineIndex(path.string()).size() == lines.size());
+
+  CHECK(data::LineIndex::indexable(path.string()));
+  CHECK(!data::LineIndex::indexable("stdin"));
+  CHECK(!data::LineIndex::indexable(path.string() + ".gz"));
+
+  boost::filesystem::remove(path);
+}
+
+TEST_CASE("Shuffled corpora return every sentence pair once", "[data][cpu]") {
+  namespace fs = boost::filesystem;
+  auto dir = fs::temp_directory_path() / fs::unique_path("corpus-%%%%%%%%");
+  fs::create_directories(dir);
+
+  // creates the loggers and the temporary directory of the old shuffle
+  auto options
+      = New<Config>("marian --log-level error --tempdir " + dir.string(),
+                    ConfigMode::training,
+                    false);
+
+  auto source = [](size_t i) { return "s" + std::to_string(i) + " a b"; };
+  auto target = [](size_t i) { return "t" + std::to_string(i) + " c"; };
+
+  // the target file is longer, the shorter source file decides the length
+  size_t lines = 50;
+  auto write = [&](const std::string& name,
+                   std::function<std::string(size_t)> line,
+                   size_t n) {
+    auto path = (dir / name).string();
+    OutputFileStream out(path);
+    for(size_t i = 0; i < n; ++i)
+      (std::ostream&)out << line(i) << "\n";
+    return path;
+  };
+
+  std::vector<std::string> paths
+      = {write("src", source, lines), write("trg", target, lines + 3)};
+  std::vector<std::string> gzPaths
+      = {write("src.gz", source, lines), write("trg.gz", target, lines + 3)};
+
+  std::vector<Ptr<Vocab>> vocabs;
+  for(auto& path : paths) {
+    vocabs.push_back(New<Vocab>());
+    vocabs.back()->loadOrCreate(path + ".yml", path);
+  }
+
+  // Reads one epoch, every sentence pair has to come back exactly once and
+  // reading has to stop at the end of the permutation
+  auto readEpoch = [&](data::Corpus& corpus) {
+    corpus.shuffle();
+    std::vector<size_t> seen(lines, 0);
+    std::vector<size_t> order;
+    for(auto tup = corpus.next(); !tup.empty(); tup = corpus.next()) {
+      REQUIRE(tup.size() == 2);
+      size_t id = tup.getId();
+      REQUIRE(id < lines);
+      CHECK(Join((*vocabs[0])(tup[0])) == source(id));
+      CHECK(Join((*vocabs[1])(tup[1])) == target(id));
+      seen[id]++;
+      order.push_back(id);
+    }
+    CHECK(corpus.next().empty());
+    CHECK((size_t)std::count(seen.begin(), seen.end(), 1) == lines);
+    CHECK(!std::is_sorted(order.begin(), order.end()));
+  };
+
+  // uncompressed files are read through line indices
+  {
+    data::Corpus corpus(paths, vocabs, options, 100);
+    for(int epoch = 0; epoch < 2; ++epoch)
+      readEpoch(corpus);
+  }
+
+  // compressed files cannot be indexed and are shuffled through temporary
+  // files as before
+  {
+    REQUIRE(!data::LineIndex::indexable(gzPaths[0]));
+    data::Corpus corpus(gzPaths, vocabs, options, 100);
+    for(int epoch = 0; epoch < 2; ++epoch)
+      readEpoch(corpus);
+  }
+
+  fs::remove_all(dir);
+}
@@ -1,6 +1,9 @@
+#include <limits>
+
 #include "catch.hpp"
 #include "graph/expression_graph.h"
 #include "graph/expression_operators.h"
+#include "kernels/tensor_operators_cpu.h"
 
 using namespace marian;
 
@@ -53,3 +56,557 @@ TEST_CASE("Expression graph can be initialized with constant values",
     REQUIRE(values == v);
   }
 }
+
+TEST_CASE("Graph can be allocated in host memory", "[graph][cpu]") {
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(4);
+
+  REQUIRE(graph->getDeviceType() == DeviceType::cpu);
+
+  std::vector<float> values;
+
+  SECTION("initializing parameters") {
+    graph->clear();
+    std::vector<float> v({1, 2, 3, 4, 5, 6});
+    auto ones = graph->param("1s", {2, 5}, keywords::init = inits::ones);
+    auto vals = graph->param("vs", {2, 3}, keywords::init = inits::from_vector(v));
+    graph->forward();
+
+    REQUIRE(ones->val()->getDeviceType() == DeviceType::cpu);
+
+    ones->val()->get(values);
+    REQUIRE(values == std::vector<float>(10, 1.0f));
+
+    vals->val()->get(values);
+    REQUIRE(values == v);
+    REQUIRE(vals->val()->get(4) == 5);
+  }
+
+  SECTION("subtensors and copies stay on the host") {
+    graph->clear();
+    std::vector<float> v({1, 2, 3, 4, 5, 6});
+    auto vals = graph->param("vs", {2, 3}, keywords::init = inits::from_vector(v));
+    auto zeros = graph->param("0s", {1, 3}, keywords::init = inits::zeros);
+    graph->forward();
+
+    auto sub = vals->val()->subtensor(3, 3);
+    REQUIRE(sub->getDeviceType() == DeviceType::cpu);
+
+    zeros->val()->copyFrom(sub);
+    zeros->val()->get(values);
+    REQUIRE(values == std::vector<float>({4, 5, 6}));
+  }
+
+  SECTION("views copy without owning memory") {
+    graph->clear();
+    std::vector<float> v({1, 2, 3, 4, 5, 6});
+    auto vals = graph->param("vs", {2, 3}, keywords::init = inits::from_vector(v));
+    auto zeros = graph->param("0s", {1, 3}, keywords::init = inits::zeros);
+    graph->forward();
+
+    auto view = vals->val()->view(3, 3);
+    REQUIRE(view.getDeviceType() == DeviceType::cpu);
+    REQUIRE(view.size() == 3);
+
+    zeros->val()->copyFrom(view);
+    zeros->val()->get(values);
+    REQUIRE(values == std::vector<float>({4, 5, 6}));
+
+    vals->val()->view(0, 3).copyFrom(zeros->val()->view());
+    vals->val()->get(values);
+    REQUIRE(values == std::vector<float>({4, 5, 6, 4, 5, 6}));
+  }
+}
+
+TEST_CASE("Allocator statistics are collected", "[graph][cpu]") {
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(4);
+
+  auto w = graph->param("W", {4, 64}, keywords::init = inits::ones);
+  graph->forward();
+
+  auto stats = graph->params()->getValsAlloc()->stats();
+  REQUIRE(stats.live == 4 * 64 * sizeof(float));
+  REQUIRE(stats.peak >= stats.live);
+  REQUIRE(stats.gaps <= 1);
+
+  auto json = graph->memoryStats();
+  REQUIRE(json.find("\"param\": {\"count\": 1") != std::string::npos);
+  REQUIRE(json.find("\"workspace\"") != std::string::npos);
+}
+
+TEST_CASE("Host allocators grow in place", "[graph][cpu]") {
+  auto a = New<Allocator<DeviceCPU>>(0, 0, 30000, 256);
+  auto mem1 = a->alloc<int>(100000);
+  uint8_t* ptr1 = mem1->data();
+  std::vector<int> v(100000, 7);
+  std::copy(v.begin(), v.end(), (int*)ptr1);
+
+  // more than the allocator holds, it has to grow
+  size_t size = a->size();
+  auto mem2 = a->alloc(1000000);
+  REQUIRE(a->size() > size);
+  REQUIRE(a->stats().grows > 0);
+
+  // without a reserved range memory is copied as on the GPU
+  DeviceCPU probe(0);
+  probe.reserve(256);
+  if(probe.mapped())
+    REQUIRE(mem1->data() == ptr1);
+  REQUIRE(std::equal(v.begin(), v.end(), (int*)mem1->data()));
+}
+
+TEST_CASE("Host allocators copy past their reserved range", "[graph][cpu]") {
+  size_t factor = DeviceCPU::reserveFactor;
+  size_t least = DeviceCPU::minReserve;
+
+  auto grows = [](size_t step) {
+    auto a = New<Allocator<DeviceCPU>>(0, 0, step, 256);
+    auto mem1 = a->alloc<int>(100000);
+    std::vector<int> v(100000, 7);
+    std::copy(v.begin(), v.end(), (int*)mem1->data());
+
+    auto mem2 = a->alloc(4000000);
+    REQUIRE(a->stats().grows > 1);
+    REQUIRE(std::equal(v.begin(), v.end(), (int*)mem1->data()));
+  };
+
+  // the range holds only the first grow
+  DeviceCPU::reserveFactor = 1;
+  DeviceCPU::minReserve = 0;
+  grows(500000);
+
+  // the range cannot be reserved at all
+  DeviceCPU::minReserve = (size_t)1 << 62;
+  grows(500000);
+
+  DeviceCPU::reserveFactor = factor;
+  DeviceCPU::minReserve = least;
+}
+
+TEST_CASE("Graph builds are captured and replayed", "[graph][cpu]") {
+  using namespace keywords;
+
+  std::vector<float> w(12), x1(6), x2(6);
+  for(int i = 0; i < 12; ++i)
+    w[i] = 0.1f * (i % 5) - 0.2f;
+  for(int i = 0; i < 6; ++i) {
+    x1[i] = 0.3f * i - 0.7f;
+    x2[i] = 0.5f - 0.2f * i;
+  }
+
+  auto build = [&](Ptr<ExpressionGraph> graph,
+                   const std::vector<float>& x,
+                   float scale) {
+    graph->clear();
+    graph->beginTape(1);
+    auto W = graph->param("W", {3, 4}, init = inits::from_vector(w));
+    auto in = graph->constant({2, 3}, init = inits::from_vector(x));
+    auto y = tanh(dot(in, W) * scale);
+    auto cost = sum(sum(y, axis = 1), axis = 0);
+    graph->forward();
+    graph->backward();
+    return y;
+  };
+
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(4);
+  graph->setGraphCapture(2);
+
+  auto reference = New<ExpressionGraph>();
+  reference->setDevice(0, DeviceType::cpu);
+  reference->reserveWorkspaceMB(4);
+
+  std::vector<float> values, expected;
+
+  SECTION("replays reuse nodes and take new inputs") {
+    auto captured = build(graph, x1, 2.f);
+    auto replayed = build(graph, x2, 3.f);
+    REQUIRE(captured == replayed);
+    REQUIRE(graph->getTapes()->misses() == 1);
+    REQUIRE(graph->getTapes()->hits() == 1);
+
+    auto y = build(reference, x2, 3.f);
+
+    replayed->val()->get(values);
+    y->val()->get(expected);
+    REQUIRE(values == expected);
+
+    graph->get("W")->grad()->get(values);
+    reference->get("W")->grad()->get(expected);
+    REQUIRE(values == expected);
+  }
+
+  SECTION("builds that diverge from the tape are rejected") {
+    build(graph, x1, 2.f);
+
+    graph->clear();
+    graph->beginTape(1);
+    graph->param("W", {3, 4});
+    REQUIRE_THROWS(graph->constant({3, 2}, init = inits::from_vector(x1)));
+  }
+}
+
+TEST_CASE("Trial builds fit with and without graph capture", "[graph][cpu]") {
+  using namespace keywords;
+
+  // largest batch of growing trial builds that fits into the workspace, as
+  // searched by collectStats with one tape per batch shape
+  auto largest = [](size_t maxTapes) {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice(0, DeviceType::cpu);
+    graph->reserveWorkspaceMB(1);
+    graph->setGraphCapture(maxTapes);
+
+    int fitting = 0;
+    for(int rows = 16; rows <= 4096; rows += 16) {
+      graph->clear();
+      graph->beginTape(rows);
+      auto W = graph->param("W", {64, 64}, init = inits::glorot_uniform);
+      auto x = graph->constant({rows, 64}, init = inits::ones);
+      auto cost = sum(sum(tanh(dot(x, W)), axis = 1), axis = 0);
+      if(!graph->fits())
+        break;
+      fitting = rows;
+    }
+    return fitting;
+  };
+
+  int uncaptured = largest(0);
+  REQUIRE(uncaptured > 0);
+  REQUIRE(uncaptured < 4096);
+  REQUIRE(largest(4) == uncaptured);
+}
+
+TEST_CASE("Graph steps are profiled", "[graph][cpu]") {
+  using namespace keywords;
+
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(4);
+  graph->setProfiling(true);
+
+  auto W = graph->param("layer_W", {3, 4}, init = inits::ones);
+  auto in = graph->constant({2, 3}, init = inits::ones);
+  auto y = tanh(dot(in, W));
+  auto cost = sum(sum(y, axis = 1), axis = 0);
+  graph->forward();
+  graph->backward();
+
+  auto profiler = graph->getProfiler();
+  auto& dots = profiler->byType().at("•");
+  REQUIRE(dots.calls[Profiler::Forward] == 1);
+  REQUIRE(dots.calls[Profiler::Backward] == 1);
+
+  // the constant has no scope, everything computed from W is in layer
+  REQUIRE(profiler->byScope().at("layer").calls[Profiler::Forward] == 5);
+  REQUIRE(profiler->byScope().at("").calls[Profiler::Forward] == 1);
+
+  std::stringstream trace;
+  Profiler::writeTrace({profiler}, trace);
+  REQUIRE(trace.str().find("\"name\": \"•\", \"cat\": \"backward\"")
+          != std::string::npos);
+}
+
+TEST_CASE("Checkpointed segments are recomputed in backward", "[graph][cpu]") {
+  using namespace keywords;
+
+  std::vector<float> w(16), x(8);
+  for(int i = 0; i < 16; ++i)
+    w[i] = 0.05f * (i % 7) - 0.15f;
+  for(int i = 0; i < 8; ++i)
+    x[i] = 0.25f * i - 1.f;
+
+  auto build = [&](Ptr<ExpressionGraph> graph) {
+    graph->clear();
+    auto W = graph->param("W", {4, 4}, init = inits::from_vector(w));
+    auto in = graph->constant({2, 4}, init = inits::from_vector(x));
+
+    // six steps in segments of two, only every second state is kept
+    Expr h = in;
+    std::vector<Expr> states;
+    for(int i = 0; i < 6; ++i) {
+      if(i % 2 == 0)
+        graph->beginSegment();
+      h = tanh(dot(h, W) + in);
+      states.push_back(h);
+      if(i % 2 == 1)
+        graph->endSegment({h});
+    }
+    auto cost = sum(sum(concatenate(states, axis = 1), axis = 1), axis = 0);
+
+    graph->forward();
+    size_t released = graph->getCheckpointing()
+                          ? graph->getCheckpointing()->released()
+                          : 0;
+    graph->backward();
+    return released;
+  };
+
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(4);
+  graph->setCheckpointing(true);
+
+  auto reference = New<ExpressionGraph>();
+  reference->setDevice(0, DeviceType::cpu);
+  reference->reserveWorkspaceMB(4);
+
+  // the dot products and sums of all steps and the states of odd steps
+  REQUIRE(build(graph) == 15);
+  REQUIRE(build(reference) == 0);
+
+  std::vector<float> values, expected;
+  graph->get("W")->grad()->get(values);
+  reference->get("W")->grad()->get(expected);
+  REQUIRE(values == expected);
+}
+
+TEST_CASE("Inference graphs release dead values early", "[graph][cpu]") {
+  using namespace keywords;
+
+  auto graph = New<ExpressionGraph>(true);
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(4);
+  graph->setEagerRelease(true);
+
+  std::vector<float> x = {-1.f, -0.5f, 0.5f, 1.f};
+  auto in = graph->constant({2, 2}, init = inits::from_vector(x));
+  auto state = tanh(in);
+  state->setPersistent(true);
+  auto hidden = state * 2.f;
+  auto out = sum(hidden, axis = 1);
+  graph->forward();
+
+  // hidden is dead once out has run, out has no readers
+  REQUIRE(!in->val());
+  REQUIRE(!hidden->val());
+  REQUIRE(out->val());
+  REQUIRE(state->val());
+
+  // persistent values can be read in the next pass, released ones not
+  auto next = state + 1.f;
+  graph->forwardNext();
+
+  std::vector<float> values;
+  next->val()->get(values);
+  for(int i = 0; i < 4; ++i)
+    REQUIRE(values[i] == Approx(std::tanh(x[i]) + 1.f));
+
+  REQUIRE_THROWS(hidden + 1.f);
+}
+
+TEST_CASE("Independent branches are scheduled concurrently", "[graph][cpu]") {
+  using namespace keywords;
+
+  // large enough that the kernels of a step are split across threads
+  int dim = 256;
+  std::vector<float> w(dim * dim), x(dim * dim);
+  for(int i = 0; i < dim * dim; ++i) {
+    w[i] = (0.05f * (i % 7) - 0.15f) / 16;
+    x[i] = 0.25f * (i % 8) - 1.f;
+  }
+
+  // four recurrences over a shared input and parameter, joined at the end.
+  // All of them accumulate into the gradient of W, so in the backward pass
+  // the calling thread holds that gradient while workers wait for it.
+  auto build = [&](Ptr<ExpressionGraph> graph, size_t& overlapped) {
+    graph->clear();
+    auto W = graph->param("W", {dim, dim}, init = inits::from_vector(w));
+    auto in = graph->constant({dim, dim}, init = inits::from_vector(x));
+
+    std::vector<Expr> branches;
+    for(int b = 0; b < 4; ++b) {
+      Expr h = in;
+      for(int i = 0; i < 3; ++i) {
+        if(b % 2)
+          h = logit(dot(h, W) - in);
+        else
+          h = tanh(dot(h, W) + in * (float)b);
+      }
+      branches.push_back(h);
+    }
+    auto out = concatenate(branches, axis = 1);
+    auto cost = sum(sum(out * out, axis = 1), axis = 0);
+
+    graph->forward();
+    if(graph->getScheduler())
+      overlapped = graph->getScheduler()->overlapped();
+    graph->backward();
+    return out;
+  };
+
+  auto reference = New<ExpressionGraph>();
+  reference->setDevice(0, DeviceType::cpu);
+  reference->reserveWorkspaceMB(32);
+
+  size_t overlapped = 0;
+  std::vector<float> expectedOut, expectedGrad;
+  build(reference, overlapped)->val()->get(expectedOut);
+  reference->get("W")->grad()->get(expectedGrad);
+
+  for(bool deterministic : {true, false}) {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice(0, DeviceType::cpu);
+    graph->reserveWorkspaceMB(32);
+    graph->setConcurrency(true, deterministic);
+
+    std::vector<float> values, grads;
+    build(graph, overlapped)->val()->get(values);
+    graph->get("W")->grad()->get(grads);
+
+    // the branches ran at the same time if there are workers
+    if(cpu::numThreads() > 1)
+      REQUIRE(overlapped > 0);
+
+    REQUIRE(values == expectedOut);
+    REQUIRE(grads.size() == expectedGrad.size());
+    if(deterministic) {
+      REQUIRE(grads == expectedGrad);
+    } else {
+      for(size_t i = 0; i < grads.size(); ++i)
+        REQUIRE(grads[i] == Approx(expectedGrad[i]));
+    }
+  }
+}
+
+TEST_CASE("Concurrent inference reuses values that have been read",
+          "[graph][cpu]") {
+  using namespace keywords;
+
+  int dim = 64;
+  size_t bytes = dim * dim * sizeof(float);
+
+  // two chains of 24 steps each, all values together take 48 * bytes
+  auto run = [&](bool concurrent, std::vector<float>& values) {
+    auto graph = New<ExpressionGraph>(true);
+    graph->setDevice(0, DeviceType::cpu);
+    graph->reserveWorkspaceMB(4);
+    graph->setConcurrency(concurrent, true);
+
+    auto in = graph->constant({dim, dim}, init = inits::from_value(0.5f));
+    std::vector<Expr> branches;
+    for(int b = 0; b < 2; ++b) {
+      Expr h = in;
+      for(int i = 0; i < 8; ++i)
+        h = tanh(h * 0.5f + (float)b);
+      branches.push_back(h);
+    }
+    auto out = concatenate(branches, axis = 1);
+    graph->forward();
+    out->val()->get(values);
+    return graph->getWorkspace()->stats().peak;
+  };
+
+  std::vector<float> expected, values;
+  run(false, expected);
+  REQUIRE(run(true, values) < 16 * bytes);
+  REQUIRE(values == expected);
+
+  // the scheduler has its own workers, a task of the host thread pool can
+  // run it without waiting for itself
+  if(cpu::numThreads() > 1) {
+    cpu::threadPool().enqueue([&] { run(true, values); }).get();
+    REQUIRE(values == expected);
+  }
+}
+
+TEST_CASE("Graph nodes are placed in an arena", "[graph][cpu]") {
+  using namespace keywords;
+
+  auto graph = New<ExpressionGraph>(true);
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(4);
+
+  auto build = [&]() {
+    graph->clear();
+    auto W = graph->param("W", {4, 4}, init = inits::glorot_uniform);
+    Expr h = graph->ones(shape = {2, 4});
+    for(int i = 0; i < 500; ++i)
+      h = tanh(dot(h, W) + h);
+    graph->forward();
+    return h;
+  };
+
+  // chunks of the first build are reused by the following ones
+  build();
+  size_t chunks = graph->getArena()->chunks();
+  REQUIRE(chunks > 1);
+
+  for(int i = 0; i < 3; ++i)
+    build();
+  REQUIRE(graph->getArena()->chunks() == chunks);
+
+  // a node kept across clear() only holds on to its own chunk
+  auto kept = build();
+  graph->clear();
+  REQUIRE(graph->getArena()->live() == 1);
+  REQUIRE(kept->shape() == Shape({2, 4}));
+
+  build();
+  REQUIRE(graph->getArena()->chunks() <= chunks + 1);
+}
+
+TEST_CASE("Health of sampled steps is monitored", "[graph][cpu]") {
+  using namespace keywords;
+
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(4);
+  graph->setHealthMonitor(2);
+
+  std::vector<float> w = {1.f, -1.f, 2.f, -2.f};
+  std::vector<float> x = {1.f, 2.f};
+
+  // products with the second column are negative, their log is NaN
+  for(int step = 0; step < 4; ++step) {
+    graph->clear();
+    auto W = graph->param("W", {2, 2}, init = inits::from_vector(w));
+    auto in = graph->constant({1, 2}, init = inits::from_vector(x));
+    auto cost = sum(log(dot(in, W)), axis = 1);
+    graph->backprop();
+  }
+  graph->getHealthMonitor()->flush();
+
+  auto samples = graph->getHealthMonitor()->samples();
+  REQUIRE(samples.size() == 2);
+  REQUIRE(samples[0].step == 2);
+  REQUIRE(samples[1].step == 4);
+
+  // W, its gradient and the cost
+  auto& stats = samples.back().stats;
+  REQUIRE(stats.size() == 3);
+  REQUIRE(stats[0].name == "W");
+  REQUIRE(!stats[0].anomaly());
+  REQUIRE(stats[0].min == -2.f);
+  REQUIRE(stats[0].max == 2.f);
+  REQUIRE(stats[0].mean == 0.f);
+  REQUIRE(stats[1].name == "W.grad");
+  REQUIRE(!stats[1].anomaly());
+  REQUIRE(stats[2].anomaly());
+  REQUIRE(graph->getHealthMonitor()->anomalies() == 2);
+}
+
+TEST_CASE("Health statistics count NaNs and infinities", "[graph][cpu]") {
+  float inf = std::numeric_limits<float>::infinity();
+  float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> values = {1.f, -3.f, nan, inf, -inf, 2.f, -nan};
+
+  auto stats = HealthMonitor::compute("x", values.data(), values.size());
+  REQUIRE(stats.elements == 7);
+  REQUIRE(stats.nans == 2);
+  REQUIRE(stats.infs == 2);
+  REQUIRE(stats.anomaly());
+  REQUIRE(stats.min == -3.f);
+  REQUIRE(stats.max == 2.f);
+  REQUIRE(stats.mean == 0.f);
+
+  // the largest finite values are not infinite
+  float max = std::numeric_limits<float>::max();
+  std::vector<float> finite = {max, -max};
+  stats = HealthMonitor::compute("y", finite.data(), finite.size());
+  REQUIRE(!stats.anomaly());
+}
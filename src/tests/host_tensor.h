@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "tensors/tensor.h"
+
+namespace marian {
+
+/**
+ * @brief Tensor on the host over the elements of v, which is resized to the
+ * shape. The vector keeps ownership of the memory and must outlive the tensor.
+ */
+inline Tensor hostTensor(std::vector<float>& v, Shape shape) {
+  v.resize(shape.elements());
+  auto mem = New<MemoryPiece>((uint8_t*)v.data(), v.size() * sizeof(float));
+  return New<TensorBase>(mem, shape, 0, DeviceType::cpu);
+}
+
+/** @brief Host tensor as above with every element set to value */
+inline Tensor hostTensor(std::vector<float>& v, Shape shape, float value) {
+  v.assign(shape.elements(), value);
+  return hostTensor(v, shape);
+}
+
+/** @brief Host tensor as above with every element drawn from random() */
+template <class Random>
+Tensor hostTensor(std::vector<float>& v, Shape shape, Random random) {
+  v.resize(shape.elements());
+  for(auto& x : v)
+    x = random();
+  return hostTensor(v, shape);
+}
+}
@@ -1,6 +1,17 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
 #include "catch.hpp"
 #include "graph/expression_graph.h"
 #include "graph/expression_operators.h"
+#include "kernels/attention_cpu.h"
+#include "kernels/math_cpu.h"
+#include "kernels/normalization_cpu.h"
+#include "kernels/rnn_cpu.h"
+#include "kernels/softmax_cpu.h"
+#include "tests/host_tensor.h"
 
 using namespace marian;
 
@@ -42,3 +53,771 @@ TEST_CASE("Expression graph supports basic math operations", "[operator]") {
     REQUIRE(values == vB2);
   }
 }
+
+TEST_CASE("Element-wise operations run on the host", "[operator][cpu]") {
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(16);
+
+  std::vector<float> vA({1, 2, 3, 4, 5, 6});
+  std::vector<float> vB({1, 2, 3});
+  std::vector<float> values;
+
+  SECTION("broadcasting and reduction") {
+    graph->clear();
+    values.clear();
+
+    auto A = graph->param("A", {2, 3}, keywords::init = inits::from_vector(vA));
+    auto B = graph->param("B", {1, 3}, keywords::init = inits::from_vector(vB));
+    auto C = A + B;
+    auto rows = sum(C, keywords::axis = 1);
+    auto cols = sum(C, keywords::axis = 0);
+    graph->forward();
+
+    C->val()->get(values);
+    REQUIRE(values == std::vector<float>({2, 4, 6, 5, 7, 9}));
+
+    REQUIRE(rows->shape() == Shape({2, 1}));
+    rows->val()->get(values);
+    REQUIRE(values == std::vector<float>({12, 21}));
+
+    REQUIRE(cols->shape() == Shape({1, 3}));
+    cols->val()->get(values);
+    REQUIRE(values == std::vector<float>({7, 11, 15}));
+  }
+
+  SECTION("gradients are reduced over broadcast dimensions") {
+    graph->clear();
+    values.clear();
+
+    auto A = graph->param("A", {2, 3}, keywords::init = inits::from_vector(vA));
+    auto B = graph->param("B", {1, 3}, keywords::init = inits::from_vector(vB));
+    auto C = sum(sum(A * B, keywords::axis = 1), keywords::axis = 0);
+    graph->forward();
+    graph->backward();
+
+    REQUIRE(C->val()->scalar() == 46);
+
+    A->grad()->get(values);
+    REQUIRE(values == std::vector<float>({1, 2, 3, 1, 2, 3}));
+
+    B->grad()->get(values);
+    REQUIRE(values == std::vector<float>({5, 7, 9}));
+  }
+}
+
+TEST_CASE("Element-wise chains are fused on the host", "[operator][cpu]") {
+  using namespace keywords;
+
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> dist(0.5f, 2.f);
+  std::vector<float> vA(20), vB(20), vC(20);
+  for(auto* v : {&vA, &vB, &vC})
+    for(auto& x : *v)
+      x = dist(gen);
+
+  auto run = [&](bool fusion, std::vector<float>& y, std::vector<float>& grads) {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice(0, DeviceType::cpu);
+    graph->reserveWorkspaceMB(16);
+    graph->setFusion(fusion);
+
+    auto A = graph->param("A", {4, 5}, init = inits::from_vector(vA));
+    auto B = graph->param("B", {4, 5}, init = inits::from_vector(vB));
+    auto C = graph->param("C", {4, 5}, init = inits::from_vector(vC));
+    auto out = tanh(A * B + C * 2.f) - sqrt(log(A) / logit(C), 0.1f);
+    auto cost = sum(sum(out, axis = 1), axis = 0);
+    graph->forward();
+    graph->backward();
+
+    // everything up to out is computed by out
+    REQUIRE(out->children().size() == (fusion ? 3 : 2));
+
+    out->val()->get(y);
+    grads.clear();
+    std::vector<float> g;
+    for(auto p : {A, B, C}) {
+      p->grad()->get(g);
+      grads.insert(grads.end(), g.begin(), g.end());
+    }
+  };
+
+  std::vector<float> y, grads, yFused, gradsFused;
+  run(false, y, grads);
+  run(true, yFused, gradsFused);
+
+  for(int i = 0; i < y.size(); ++i)
+    REQUIRE(yFused[i] == Approx(y[i]).epsilon(1e-4));
+  for(int i = 0; i < grads.size(); ++i)
+    REQUIRE(gradsFused[i] == Approx(grads[i]).epsilon(1e-4));
+}
+
+TEST_CASE("Chains with a broadcast bias are fused on the host",
+          "[operator][cpu]") {
+  using namespace keywords;
+
+  int rows = 64, cols = 40;
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  auto random = [&] { return dist(gen); };
+  std::vector<float> vX(rows * cols), vW(cols * cols), vB(cols), vC(cols);
+  for(auto* v : {&vX, &vW, &vB, &vC})
+    std::generate(v->begin(), v->end(), random);
+
+  auto run = [&](bool fusion, std::vector<float>& y, std::vector<float>& grads) {
+    auto graph = New<ExpressionGraph>();
+    graph->setDevice(0, DeviceType::cpu);
+    graph->reserveWorkspaceMB(16);
+    graph->setFusion(fusion);
+
+    auto X = graph->param("X", {rows, cols}, init = inits::from_vector(vX));
+    auto W = graph->param("W", {cols, cols}, init = inits::from_vector(vW));
+    auto b = graph->param("b", {1, cols}, init = inits::from_vector(vB));
+    auto c = graph->param("c", {1, cols}, init = inits::from_vector(vC));
+    auto out = logit(dot(X, W) + b) * tanh(X * c + b);
+    auto cost = sum(sum(out, axis = 1), axis = 0);
+    graph->forward();
+    graph->backward();
+
+    // the biases are read with broadcasting inside the chain
+    REQUIRE(out->children().size() == (fusion ? 4 : 2));
+
+    out->val()->get(y);
+    grads.clear();
+    std::vector<float> g;
+    for(auto p : {X, W, b, c}) {
+      p->grad()->get(g);
+      grads.insert(grads.end(), g.begin(), g.end());
+    }
+  };
+
+  std::vector<float> y, grads, yFused, gradsFused;
+  run(false, y, grads);
+  run(true, yFused, gradsFused);
+
+  for(int i = 0; i < y.size(); ++i)
+    REQUIRE(yFused[i] == Approx(y[i]).epsilon(1e-4));
+  for(int i = 0; i < grads.size(); ++i)
+    REQUIRE(gradsFused[i] == Approx(grads[i]).epsilon(1e-4));
+}
+
+TEST_CASE("Matrix products run on the host", "[operator][cpu]") {
+  auto graph = New<ExpressionGraph>();
+  graph->setDevice(0, DeviceType::cpu);
+  graph->reserveWorkspaceMB(16);
+
+  std::vector<float> vA({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12});
+  std::vector<float> vB({1, 2, 3, 4, 5, 6});
+  std::vector<float> vC({22, 28, 49, 64, 76, 100, 103, 136});
+  std::vector<float> values;
+
+  SECTION("dot product") {
+    graph->clear();
+    values.clear();
+
+    auto A = graph->param("A", {4, 3}, keywords::init = inits::from_vector(vA));
+    auto B = graph->param("B", {3, 2}, keywords::init = inits::from_vector(vB));
+    auto C = dot(A, B);
+    auto Ct = dot(B, A, true, true);
+    graph->forward();
+
+    REQUIRE(C->shape() == Shape({4, 2}));
+    C->val()->get(values);
+    REQUIRE(values == vC);
+
+    REQUIRE(Ct->shape() == Shape({2, 4}));
+    Ct->val()->get(values);
+    REQUIRE(values == std::vector<float>({22, 49, 76, 103, 28, 64, 100, 136}));
+  }
+
+  SECTION("gradients of affine transformations") {
+    graph->clear();
+    values.clear();
+
+    auto A = graph->param("A", {4, 3}, keywords::init = inits::from_vector(vA));
+    auto B = graph->param("B", {3, 2}, keywords::init = inits::from_vector(vB));
+    auto b = graph->param("b", {1, 2}, keywords::init = inits::ones);
+    auto C = sum(sum(affine(A, B, b), keywords::axis = 1), keywords::axis = 0);
+    graph->forward();
+    graph->backward();
+
+    REQUIRE(C->val()->scalar() == 586);
+
+    A->grad()->get(values);
+    REQUIRE(values == std::vector<float>({3, 7, 11, 3, 7, 11,
+                                          3, 7, 11, 3, 7, 11}));
+    B->grad()->get(values);
+    REQUIRE(values == std::vector<float>({22, 22, 26, 26, 30, 30}));
+    b->grad()->get(values);
+    REQUIRE(values == std::vector<float>({4, 4}));
+  }
+}
+
+TEST_CASE("8-bit products agree with single precision", "[operator][cpu]") {
+  // a small output layer: 32 states of size 256 scored against 1000 words
+  int rows = 32, dim = 256, words = 1000;
+
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  std::vector<float> vX(rows * dim), vW(dim * words), vb(words);
+  for(auto& x : vX)
+    x = dist(gen);
+  for(auto& w : vW)
+    w = 0.1f * dist(gen);
+  for(auto& b : vb)
+    b = 0.1f * dist(gen);
+
+  auto logits = [&](bool int8, bool tied) {
+    auto graph = New<ExpressionGraph>(true);
+    graph->setDevice(0, DeviceType::cpu);
+    graph->setInt8(int8);
+    graph->reserveWorkspaceMB(16);
+
+    auto x = graph->param("x", {rows, dim}, keywords::init = inits::from_vector(vX));
+    auto b = graph->param("b", {1, words}, keywords::init = inits::from_vector(vb));
+    Expr y;
+    if(tied) {
+      // embeddings shared with the output layer are used transposed
+      auto E = graph->param("E", {words, dim}, keywords::init = inits::from_vector(vW));
+      y = dot(x, E, false, true);
+    } else {
+      auto W = graph->param("W", {dim, words}, keywords::init = inits::from_vector(vW));
+      y = affine(x, W, b);
+    }
+    graph->forward();
+
+    std::vector<float> values;
+    y->val()->get(values);
+    return values;
+  };
+
+  for(bool tied : {false, true}) {
+    auto exact = logits(false, tied);
+    auto approx = logits(true, tied);
+    REQUIRE(exact.size() == approx.size());
+
+    double error = 0, norm = 0;
+    for(size_t i = 0; i < exact.size(); ++i) {
+      error += (exact[i] - approx[i]) * (exact[i] - approx[i]);
+      norm += exact[i] * exact[i];
+    }
+    CHECK(std::sqrt(error / norm) < 0.02);
+
+    // As a proxy for translation quality, the best word under 8-bit
+    // arithmetic scores within the quantization error of the best word.
+    for(int i = 0; i < rows; ++i) {
+      auto row = exact.begin() + i * words;
+      auto best = std::max_element(row, row + words);
+      auto rowApprox = approx.begin() + i * words;
+      auto bestApprox = std::max_element(rowApprox, rowApprox + words);
+      CHECK(*best - row[bestApprox - rowApprox] < 0.1f);
+    }
+  }
+}
+
+TEST_CASE("16-bit weights agree with single precision", "[operator][cpu]") {
+  int rows = 32, dim = 256, words = 1000;
+
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  std::vector<float> vX(rows * dim), vW(dim * words), vb(words);
+  for(auto& x : vX)
+    x = dist(gen);
+  for(auto& w : vW)
+    w = 0.1f * dist(gen);
+  for(auto& b : vb)
+    b = 0.1f * dist(gen);
+
+  auto logits = [&](const std::string& half, bool tied) {
+    auto graph = New<ExpressionGraph>(true);
+    graph->setDevice(0, DeviceType::cpu);
+    graph->setHalfPrecision(half);
+    graph->reserveWorkspaceMB(16);
+
+    auto x = graph->param("x", {rows, dim}, keywords::init = inits::from_vector(vX));
+    auto b = graph->param("b", {1, words}, keywords::init = inits::from_vector(vb));
+    Expr y;
+    if(tied) {
+      auto E = graph->param("E", {words, dim}, keywords::init = inits::from_vector(vW));
+      y = dot(x, E, false, true);
+    } else {
+      auto W = graph->param("W", {dim, words}, keywords::init = inits::from_vector(vW));
+      y = affine(x, W, b);
+    }
+    graph->forward();
+
+    std::vector<float> values;
+    y->val()->get(values);
+    return values;
+  };
+
+  // relative rounding error of the weights is 2^-8 for bfloat16 and 2^-11
+  // for float16, products accumulate in single precision
+  for(auto half : {std::make_pair("bf16", 4e-3), std::make_pair("fp16", 5e-4)}) {
+    for(bool tied : {false, true}) {
+      auto exact = logits("", tied);
+      auto approx = logits(half.first, tied);
+      REQUIRE(exact.size() == approx.size());
+
+      double error = 0, norm = 0;
+      for(size_t i = 0; i < exact.size(); ++i) {
+        error += (exact[i] - approx[i]) * (exact[i] - approx[i]);
+        norm += exact[i] * exact[i];
+      }
+      CHECK(std::sqrt(error / norm) < half.second);
+    }
+  }
+}
+
+TEST_CASE("Exponentials are accurate on the host", "[operator][cpu]") {
+  // the whole range of normal results, in a loop that is vectorised like
+  // the loops of the kernels
+  int n = 100001;
+  std::vector<float> x(n), vExp(n), vApprox(n), vTanh(n), vSigmoid(n);
+  for(int i = 0; i < n; ++i)
+    x[i] = -87.f + 175.f * i / (n - 1);
+  for(int i = 0; i < n; ++i) {
+    vExp[i] = cpu::fastExp(x[i]);
+    vApprox[i] = cpu::approxExp(x[i]);
+    vTanh[i] = cpu::fastTanh(x[i] / 20);
+    vSigmoid[i] = cpu::fastSigmoid(x[i] / 10);
+  }
+
+  double errExp = 0, errApprox = 0, errTanh = 0, errSigmoid = 0;
+  for(int i = 0; i < n; ++i) {
+    double e = std::exp((double)x[i]);
+    errExp = std::max(errExp, std::abs(vExp[i] - e) / e);
+    errApprox = std::max(errApprox, std::abs(vApprox[i] - e) / e);
+    errTanh = std::max(errTanh, std::abs(vTanh[i] - std::tanh(x[i] / 20.)));
+    errSigmoid = std::max(
+        errSigmoid, std::abs(vSigmoid[i] - 1 / (1 + std::exp(-x[i] / 10.))));
+  }
+  CHECK(errExp < 5e-7);
+  CHECK(errApprox < 1e-4);
+  CHECK(errTanh < 1e-6);
+  CHECK(errSigmoid < 1e-6);
+
+  // arguments beyond the range are clamped to finite results
+  CHECK(cpu::fastExp(1000.f) > 1e38f);
+  CHECK(cpu::fastExp(1000.f) < std::numeric_limits<float>::max());
+  CHECK(cpu::fastExp(-1000.f) >= std::numeric_limits<float>::min());
+  CHECK(cpu::fastExp(-1000.f) < 1.2e-38f);
+  CHECK(cpu::fastTanh(100.f) == 1.f);
+  CHECK(cpu::fastTanh(-100.f) == -1.f);
+}
+
+TEST_CASE("Fused GRU kernels run on the host", "[operator][cpu]") {
+  int rows = 5, cols = 300;
+
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  auto random = [&] { return dist(gen); };
+
+  std::vector<float> vState, vXW, vSU, vB, vAdj, vOut;
+  std::vector<float> vMask({1, 1, 0, 1, 1});
+  std::vector<float> dState, dXW, dSU, dB;
+
+  auto state = hostTensor(vState, {rows, cols}, random);
+  auto xW = hostTensor(vXW, {rows, 3 * cols}, random);
+  auto sU = hostTensor(vSU, {rows, 3 * cols}, random);
+  auto b = hostTensor(vB, {1, 3 * cols}, random);
+  auto adj = hostTensor(vAdj, {rows, cols}, random);
+  auto out = hostTensor(vOut, {rows, cols}, 0.f);
+  auto mask = hostTensor(vMask, {rows, 1});
+
+  auto sigmoid = [](double x) { return 1 / (1 + std::exp(-x)); };
+
+  for(bool final : {false, true}) {
+    auto gState = hostTensor(dState, {rows, cols}, 0.f);
+    auto gXW = hostTensor(dXW, {rows, 3 * cols}, 0.f);
+    auto gSU = hostTensor(dSU, {rows, 3 * cols}, 0.f);
+    auto gB = hostTensor(dB, {1, 3 * cols}, 0.f);
+
+    cpu::GRUFastForward(out, {state, xW, sU, b, mask}, final);
+    cpu::GRUFastBackward({gState, gXW, gSU, gB},
+                         {state, xW, sU, b, mask}, adj, final);
+
+    // reference in double precision, one element at a time
+    std::vector<double> rB(3 * cols, 0.0);
+    double errOut = 0, errGrad = 0;
+    for(int j = 0; j < rows; ++j) {
+      double m = vMask[j];
+      for(int i = 0; i < cols; ++i) {
+        int k = i + cols, l = i + 2 * cols;
+        const float* x = &vXW[j * 3 * cols];
+        const float* s = &vSU[j * 3 * cols];
+        double r = sigmoid(x[i] + s[i] + vB[i]);
+        double z = sigmoid(x[k] + s[k] + vB[k]);
+        double h = final ? std::tanh(x[l] + (s[l] + vB[l]) * r)
+                         : std::tanh(x[l] + s[l] * r + vB[l]);
+        double prev = vState[j * cols + i];
+        double o = m * ((1 - z) * h + z * prev) + (1 - m) * prev;
+        errOut = std::max(errOut, std::abs(o - vOut[j * cols + i]));
+
+        double a = vAdj[j * cols + i];
+        double t = (1 - z) * (1 - h * h);
+        double dr = m * r * (1 - r) * t * a * (final ? s[l] + vB[l] : s[l]);
+        double dz = m * (1 - z) * z * (prev - h) * a;
+        double dx = m * t * a;
+        rB[i] += dr;
+        rB[k] += dz;
+        rB[l] += final ? dx * r : dx;
+
+        const float* gx = &dXW[j * 3 * cols];
+        const float* gs = &dSU[j * 3 * cols];
+        for(double diff : {(m * z - m + 1) * a - dState[j * cols + i],
+                           dr - gx[i], dz - gx[k], dx - gx[l],
+                           dr - gs[i], dz - gs[k], dx * r - gs[l]})
+          errGrad = std::max(errGrad, std::abs(diff));
+      }
+    }
+    for(int i = 0; i < 3 * cols; ++i)
+      errGrad = std::max(errGrad, std::abs(rB[i] - dB[i]));
+
+    CHECK(errOut < 1e-5);
+    CHECK(errGrad < 1e-5);
+  }
+}
+
+TEST_CASE("Fused LSTM kernels run on the host", "[operator][cpu]") {
+  int rows = 5, cols = 300;
+
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  auto random = [&] { return dist(gen); };
+
+  std::vector<float> vCell, vXW, vSU, vB, vAdj, vCellOut, vOut;
+  std::vector<float> vMask({1, 1, 0, 1, 1});
+  std::vector<float> dCell, dXW, dSU, dB, dCellOut, dXW2, dSU2, dB2;
+
+  auto cell = hostTensor(vCell, {rows, cols}, random);
+  auto xW = hostTensor(vXW, {rows, 4 * cols}, random);
+  auto sU = hostTensor(vSU, {rows, 4 * cols}, random);
+  auto b = hostTensor(vB, {1, 4 * cols}, random);
+  auto adj = hostTensor(vAdj, {rows, cols}, random);
+  auto cellOut = hostTensor(vCellOut, {rows, cols}, 0.f);
+  auto out = hostTensor(vOut, {rows, cols}, 0.f);
+  auto mask = hostTensor(vMask, {rows, 1});
+
+  auto gCell = hostTensor(dCell, {rows, cols}, 0.f);
+  auto gXW = hostTensor(dXW, {rows, 4 * cols}, 0.f);
+  auto gSU = hostTensor(dSU, {rows, 4 * cols}, 0.f);
+  auto gB = hostTensor(dB, {1, 4 * cols}, 0.f);
+  auto gCellOut = hostTensor(dCellOut, {rows, cols}, 0.f);
+  auto gXW2 = hostTensor(dXW2, {rows, 4 * cols}, 0.f);
+  auto gSU2 = hostTensor(dSU2, {rows, 4 * cols}, 0.f);
+  auto gB2 = hostTensor(dB2, {1, 4 * cols}, 0.f);
+
+  cpu::LSTMCellForward(cellOut, {cell, xW, sU, b, mask});
+  cpu::LSTMOutputForward(out, {cellOut, xW, sU, b});
+  cpu::LSTMCellBackward({gCell, gXW, gSU, gB}, {cell, xW, sU, b, mask}, adj);
+  cpu::LSTMOutputBackward({gCellOut, gXW2, gSU2, gB2},
+                          {cellOut, xW, sU, b}, adj);
+
+  auto sigmoid = [](double x) { return 1 / (1 + std::exp(-x)); };
+
+  // reference in double precision, one element at a time
+  std::vector<double> rB(4 * cols, 0.0), rB2(4 * cols, 0.0);
+  double errOut = 0, errGrad = 0;
+  for(int j = 0; j < rows; ++j) {
+    double m = vMask[j];
+    for(int i = 0; i < cols; ++i) {
+      int k = i + cols, l = i + 2 * cols, o = i + 3 * cols;
+      const float* x = &vXW[j * 4 * cols];
+      const float* s = &vSU[j * 4 * cols];
+      double gf = sigmoid(x[i] + s[i] + vB[i]);
+      double gi = sigmoid(x[k] + s[k] + vB[k]);
+      double gc = std::tanh(x[l] + s[l] + vB[l]);
+      double go = sigmoid(x[o] + s[o] + vB[o]);
+      double prev = vCell[j * cols + i];
+      double c = m * (gf * prev + gi * gc) + (1 - m) * prev;
+      double t = std::tanh(vCellOut[j * cols + i]);
+      errOut = std::max(errOut, std::abs(c - vCellOut[j * cols + i]));
+      errOut = std::max(errOut, std::abs(go * t - vOut[j * cols + i]));
+
+      double a = vAdj[j * cols + i];
+      double df = m * prev * gf * (1 - gf) * a;
+      double di = m * gc * gi * (1 - gi) * a;
+      double dc = m * gi * (1 - gc * gc) * a;
+      double dout = t * go * (1 - go) * a;
+      rB[i] += df;
+      rB[k] += di;
+      rB[l] += dc;
+      rB2[o] += dout;
+
+      int r = j * 4 * cols;
+      for(double diff : {(m * gf - m + 1) * a - dCell[j * cols + i],
+                         df - dXW[r + i], di - dXW[r + k], dc - dXW[r + l],
+                         df - dSU[r + i], di - dSU[r + k], dc - dSU[r + l],
+                         0.0 - dXW[r + o],
+                         go * (1 - t * t) * a - dCellOut[j * cols + i],
+                         dout - dXW2[r + o], dout - dSU2[r + o],
+                         0.0 - dXW2[r + i]})
+        errGrad = std::max(errGrad, std::abs(diff));
+    }
+  }
+  for(int i = 0; i < 4 * cols; ++i) {
+    errGrad = std::max(errGrad, std::abs(rB[i] - dB[i]));
+    errGrad = std::max(errGrad, std::abs(rB2[i] - dB2[i]));
+  }
+
+  CHECK(errOut < 1e-5);
+  CHECK(errGrad < 1e-5);
+}
+
+TEST_CASE("Softmax kernels run on the host", "[operator][cpu]") {
+  // rows longer than the chunks the kernels work on, with increasing values
+  // so that the running maximum changes between chunks
+  int rows = 3, cols = 5000;
+
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+
+  std::vector<float> vIn(rows * cols), vAdj(rows * cols), vMask(rows * cols);
+  std::vector<float> vPick({7, 4999, 2500}), vAdjPick({1.f, 0.5f, -2.f});
+  for(int i = 0; i < rows * cols; ++i) {
+    vIn[i] = 3 * dist(gen) + 0.002f * (i % cols);
+    vAdj[i] = dist(gen);
+    vMask[i] = i % 3 != 0;
+  }
+
+  // reference softmax in double precision
+  std::vector<double> ref(rows * cols), refMasked(rows * cols);
+  for(int j = 0; j < rows; ++j) {
+    double max = -1e30, maxMasked = -1e30;
+    for(int i = j * cols; i < (j + 1) * cols; ++i) {
+      max = std::max(max, (double)vIn[i]);
+      if(vMask[i])
+        maxMasked = std::max(maxMasked, (double)vIn[i]);
+    }
+    double sum = 0, sumMasked = 0;
+    for(int i = j * cols; i < (j + 1) * cols; ++i) {
+      ref[i] = std::exp(vIn[i] - max);
+      refMasked[i] = vMask[i] ? std::exp(vIn[i] - maxMasked) : 0;
+      sum += ref[i];
+      sumMasked += refMasked[i];
+    }
+    for(int i = j * cols; i < (j + 1) * cols; ++i) {
+      ref[i] /= sum;
+      refMasked[i] /= sumMasked;
+    }
+  }
+
+  auto in = hostTensor(vIn, {rows, cols});
+  auto adj = hostTensor(vAdj, {rows, cols});
+  auto mask = hostTensor(vMask, {rows, cols});
+  auto pick = hostTensor(vPick, {rows, 1});
+  auto adjPick = hostTensor(vAdjPick, {rows, 1});
+
+  for(auto accuracy : {cpu::ExpAccuracy::full, cpu::ExpAccuracy::approximate}) {
+    cpu::expAccuracy() = accuracy;
+    double tol = accuracy == cpu::ExpAccuracy::full ? 1e-5 : 1e-3;
+
+    std::vector<float> vOut(rows * cols), vLog(rows * cols), vCE(rows),
+        vGrad(rows * cols, 0.f), vLogGrad(rows * cols, 0.f),
+        vCEGrad(rows * cols, 0.f), vMasked(rows * cols);
+    auto out = hostTensor(vOut, {rows, cols});
+    auto log = hostTensor(vLog, {rows, cols});
+    auto ce = hostTensor(vCE, {rows, 1});
+    auto grad = hostTensor(vGrad, {rows, cols});
+    auto logGrad = hostTensor(vLogGrad, {rows, cols});
+    auto ceGrad = hostTensor(vCEGrad, {rows, cols});
+    auto masked = hostTensor(vMasked, {rows, cols});
+
+    cpu::Softmax(out, in);
+    cpu::Softmax(masked, in, mask);
+    cpu::LogSoftmax(log, in);
+    cpu::CrossEntropyPick(ce, in, pick);
+    cpu::SoftmaxGrad(grad, adj, out);
+    cpu::LogSoftmaxGrad(logGrad, adj, log);
+    cpu::CrossEntropyPickBackward(ceGrad, adjPick, in, pick);
+
+    double errOut = 0, errLog = 0, errCE = 0, errGrad = 0;
+    for(int j = 0; j < rows; ++j) {
+      double dot = 0, sum = 0;
+      for(int i = j * cols; i < (j + 1) * cols; ++i) {
+        dot += ref[i] * vAdj[i];
+        sum += vAdj[i];
+      }
+      int p = j * cols + (int)vPick[j];
+      errCE = std::max(errCE, std::abs(vCE[j] + std::log(ref[p])));
+
+      for(int i = j * cols; i < (j + 1) * cols; ++i) {
+        errOut = std::max(errOut, std::abs(vOut[i] - ref[i]) / ref[i]);
+        errOut = std::max(errOut, std::abs(vMasked[i] - refMasked[i]));
+        errLog = std::max(errLog, std::abs(vLog[i] - std::log(ref[i])));
+
+        double dSoftmax = ref[i] * (vAdj[i] - dot);
+        double dLogSoftmax = vAdj[i] - ref[i] * sum;
+        double dCE = vAdjPick[j] * (ref[i] - (i == p));
+        errGrad = std::max(errGrad, std::abs(vGrad[i] - dSoftmax));
+        errGrad = std::max(errGrad, std::abs(vLogGrad[i] - dLogSoftmax));
+        errGrad = std::max(errGrad, std::abs(vCEGrad[i] - dCE));
+      }
+    }
+
+    CHECK(errOut < tol);
+    CHECK(errLog < tol);
+    CHECK(errCE < tol);
+    CHECK(errGrad < tol);
+  }
+  cpu::expAccuracy() = cpu::ExpAccuracy::full;
+}
+
+TEST_CASE("Layer normalization runs on the host", "[operator][cpu]") {
+  // a row size that is not a multiple of the vector width and inputs with a
+  // large mean, where summing squares would lose precision
+  int rows = 4, cols = 1001;
+  float eps = 1e-9;
+
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+
+  std::vector<float> vX(rows * cols), vAdj(rows * cols), vGamma(cols),
+      vBeta(cols);
+  for(auto& x : vX)
+    x = 100.f + dist(gen);
+  for(auto& a : vAdj)
+    a = dist(gen);
+  for(auto& g : vGamma)
+    g = 1.f + 0.5f * dist(gen);
+  for(auto& b : vBeta)
+    b = dist(gen);
+
+  auto x = hostTensor(vX, {rows, cols});
+  auto adj = hostTensor(vAdj, {rows, cols});
+  auto gamma = hostTensor(vGamma, {1, cols});
+  auto beta = hostTensor(vBeta, {1, cols});
+
+  for(bool withBeta : {true, false}) {
+    std::vector<float> vY(rows * cols), vGradX(rows * cols, 0.f),
+        vGradGamma(cols, 0.f), vGradBeta(cols, 0.f);
+    auto y = hostTensor(vY, {rows, cols});
+    auto gradX = hostTensor(vGradX, {rows, cols});
+    auto gradGamma = hostTensor(vGradGamma, {1, cols});
+    auto gradBeta = hostTensor(vGradBeta, {1, cols});
+
+    cpu::LayerNormalization(y, x, gamma, withBeta ? beta : nullptr, eps);
+    cpu::LayerNormalizationGrad(gradX, gradGamma, gradBeta, adj, y, x, gamma,
+                                withBeta ? beta : nullptr);
+
+    // the GPU kernels in double precision
+    std::vector<double> refGamma(cols, 0.0), refBeta(cols, 0.0);
+    double errY = 0, errX = 0;
+    for(int j = 0; j < rows; ++j) {
+      const float* xRow = &vX[j * cols];
+      const float* adjRow = &vAdj[j * cols];
+
+      double mean = 0, var = 0;
+      for(int i = 0; i < cols; ++i)
+        mean += xRow[i];
+      mean /= cols;
+      for(int i = 0; i < cols; ++i)
+        var += (xRow[i] - mean) * (xRow[i] - mean);
+      double sigma = std::sqrt(eps + var / cols);
+
+      double sumAdj = 0, sumAdjX = 0;
+      for(int i = 0; i < cols; ++i) {
+        double xHat = (xRow[i] - mean) / sigma;
+        sumAdj += adjRow[i];
+        sumAdjX += adjRow[i] * xHat;
+      }
+
+      for(int i = 0; i < cols; ++i) {
+        double xHat = (xRow[i] - mean) / sigma;
+        double out = vGamma[i] * xHat + (withBeta ? vBeta[i] : 0);
+        errY = std::max(errY, std::abs(out - vY[j * cols + i]));
+
+        double grad = (cols * adjRow[i] - sumAdj - sumAdjX * xHat)
+                      / (cols * sigma);
+        errX = std::max(errX, std::abs(vGamma[i] * grad - vGradX[j * cols + i]));
+
+        refGamma[i] += adjRow[i] * xHat;
+        refBeta[i] += adjRow[i];
+      }
+    }
+
+    double errGamma = 0, errBeta = 0;
+    for(int i = 0; i < cols; ++i) {
+      errGamma = std::max(errGamma, std::abs(refGamma[i] - vGradGamma[i]));
+      errBeta = std::max(errBeta,
+                         std::abs((withBeta ? refBeta[i] : 0) - vGradBeta[i]));
+    }
+
+    CHECK(errY < 1e-4);
+    CHECK(errX < 1e-4);
+    CHECK(errGamma < 1e-4);
+    CHECK(errBeta < 1e-4);
+  }
+}
+
+TEST_CASE("Attention kernels run on the host", "[operator][cpu]") {
+  // several sentences and beam entries, a hidden size that is not a multiple
+  // of the vector width
+  int dimBatch = 3, dimHidden = 70, dimSrc = 7, dimBeam = 4;
+
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> dist(0.f, 1.f);
+  auto random = [&] { return dist(gen); };
+
+  std::vector<float> vVa, vCtx, vState, vCov, vAdj, vOut;
+  auto va = hostTensor(vVa, {dimHidden, 1}, random);
+  auto ctx = hostTensor(vCtx, {dimBatch, dimHidden, dimSrc, 1}, random);
+  auto state = hostTensor(vState, {dimBatch, dimHidden, 1, dimBeam}, random);
+  auto cov = hostTensor(vCov, {dimBatch, dimHidden, dimSrc, 1}, random);
+  auto adj = hostTensor(vAdj, {dimBatch, 1, dimSrc, dimBeam}, random);
+  auto out = hostTensor(vOut, {dimBatch, 1, dimSrc, dimBeam}, 0.f);
+
+  for(bool coverage : {false, true}) {
+    std::vector<float> dVa, dCtx, dState, dCov;
+    auto gVa = hostTensor(dVa, va->shape(), 0.f);
+    auto gCtx = hostTensor(dCtx, ctx->shape(), 0.f);
+    auto gState = hostTensor(dState, state->shape(), 0.f);
+    auto gCov = hostTensor(dCov, cov->shape(), 0.f);
+
+    cpu::Att(out, va, ctx, state, coverage ? cov : nullptr);
+    cpu::AttBack(gVa, gCtx, gState, coverage ? gCov : nullptr, va, ctx, state,
+                 coverage ? cov : nullptr, adj);
+
+    // reference in double precision
+    std::vector<double> rVa(dVa.size(), 0.0), rCtx(dCtx.size(), 0.0),
+        rState(dState.size(), 0.0);
+    double errOut = 0;
+    for(int h = 0; h < dimBeam; ++h) {
+      for(int t = 0; t < dimSrc; ++t) {
+        for(int s = 0; s < dimBatch; ++s) {
+          int j = (h * dimSrc + t) * dimBatch + s;
+          int c = (t * dimBatch + s) * dimHidden;
+          int r = (h * dimBatch + s) * dimHidden;
+          double sum = 0;
+          for(int i = 0; i < dimHidden; ++i) {
+            double z = vCtx[c + i] + vState[r + i];
+            if(coverage)
+              z += vCov[c + i];
+            double th = std::tanh(z);
+            sum += th * vVa[i];
+            double dz = vVa[i] * (1 - th * th) * vAdj[j];
+            rCtx[c + i] += dz;
+            rState[r + i] += dz;
+            rVa[i] += th * vAdj[j];
+          }
+          errOut = std::max(errOut, std::abs(sum - vOut[j]));
+        }
+      }
+    }
+
+    double errGrad = 0;
+    for(size_t i = 0; i < rVa.size(); ++i)
+      errGrad = std::max(errGrad, std::abs(rVa[i] - dVa[i]));
+    for(size_t i = 0; i < rCtx.size(); ++i) {
+      errGrad = std::max(errGrad, std::abs(rCtx[i] - dCtx[i]));
+      errGrad = std::max(errGrad,
+                         std::abs((coverage ? rCtx[i] : 0) - dCov[i]));
+    }
+    for(size_t i = 0; i < rState.size(); ++i)
+      errGrad = std::max(errGrad, std::abs(rState[i] - dState[i]));
+
+    CHECK(errOut < 1e-4);
+    CHECK(errGrad < 1e-4);
+  }
+}
@@ -47,6 +47,8 @@ public:
   virtual void save(bool = false) = 0;
 
   virtual Ptr<data::BatchStats> collectStats() = 0;
+
+  virtual std::vector<Ptr<ExpressionGraph>> getGraphs() = 0;
 };
 
 template <class Builder>
@@ -142,6 +144,16 @@ public:
     graph_ = New<ExpressionGraph>();
     graph_->setDevice(device);
     graph_->reserveWorkspaceMB(options_->get<size_t>("workspace"));
+    graph_->setMemoryPlanning(options_->get<bool>("memory-planning"));
+    graph_->setGraphCapture(options_->get<size_t>("graph-capture"));
+    graph_->setFusion(options_->get<bool>("fuse-elementwise"));
+    graph_->setProfiling(options_->has("profile"));
+    graph_->setCheckpointing(options_->get<int>("rnn-checkpoint") > 0);
+    graph_->setHealthMonitor(
+        options_->get<size_t>("health-check"),
+        options_->has("health-dump")
+            ? options_->get<std::string>("health-dump")
+            : "");
     opt_ = Optimizer(options_);
 
     builder_ = New<Builder>(options_, args...);
@@ -161,6 +173,8 @@ public:
     }
   }
 
+  std::vector<Ptr<ExpressionGraph>> getGraphs() { return {graph_}; }
+
   void save(bool final = false) {
     auto saveGraph = graph_;
     if(mvAvg_)
@@ -287,8 +301,8 @@ private:
           [=](int idx, int pos) {
             // individual mutex per-shard
             std::lock_guard<std::mutex> guard(shardSync_[idx]);
-            oldParams->subtensor(pos, params[idx]->size())
-                ->copyFrom(params[idx]);
+            oldParams->view(pos, params[idx]->size())
+                .copyFrom(params[idx]->view());
           },
           idx,
           pos));
@@ -309,8 +323,7 @@ private:
           [=](int idx, int pos) {
             // individual mutex per-shard
             std::lock_guard<std::mutex> guard(shardSync_[idx]);
-            grads_[idx]->copyFrom(
-                newGrads->subtensor(pos, grads_[idx]->size()));
+            grads_[idx]->copyFrom(newGrads->view(pos, grads_[idx]->size()));
 
             // apply and increment your version number, if history is enabled
             int latestVersion = 0;
@@ -382,7 +395,7 @@ private:
             localSparseDelta[worker_id][idx]->copyFrom(tmpSparseDelta[idx]);
 
             localSparseDelta[worker_id][idx]->scatterAdd(
-                oldParams->subtensor(pos, grads_[idx]->size()));
+                oldParams->view(pos, grads_[idx]->size()));
 
             localVersionNumbers[worker_id][idx] = globalVersionNumber[idx];
           },
@@ -488,7 +501,7 @@ private:
             paramsAlloc_.push_back(allocator);
 
             param->copyFrom(
-                graphs_[0]->params()->vals()->subtensor(pos, __size__));
+                graphs_[0]->params()->vals()->view(pos, __size__));
             params_[h_id].push_back(param);
           }
 
@@ -701,6 +714,16 @@ public:
       auto graph = New<ExpressionGraph>();
       graph->setDevice(device);
       graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
+      graph->setMemoryPlanning(options_->get<bool>("memory-planning"));
+      graph->setGraphCapture(options_->get<size_t>("graph-capture"));
+      graph->setFusion(options_->get<bool>("fuse-elementwise"));
+      graph->setProfiling(options_->has("profile"));
+      graph->setCheckpointing(options_->get<int>("rnn-checkpoint") > 0);
+      graph->setHealthMonitor(
+          options_->get<size_t>("health-check"),
+          options_->has("health-dump")
+              ? options_->get<std::string>("health-dump")
+              : "");
       graphs_.push_back(graph);
       shardOpt_.push_back(Optimizer(options_));
       builders_.push_back(New<Builder>(options_, args...));
@@ -722,6 +745,8 @@ public:
     }
   }
 
+  std::vector<Ptr<ExpressionGraph>> getGraphs() { return graphs_; }
+
   void save(bool final = false) { save(graphs_[0], final); }
 
   void save(Ptr<ExpressionGraph> graph, bool final = false) {
@@ -980,7 +1005,7 @@ private:
     for (int gpu = 0; gpu < devices_.size(); gpu++) {
       size_t size = std::min(gpuShardSize, thisNodeSize - offset);
       Tensor gpuParams = newTensor(size, devices_[gpu]);
-      gpuParams->copyFrom(graphs_[0]->params()->vals()->subtensor(offset, size));
+      gpuParams->copyFrom(graphs_[0]->params()->vals()->view(offset, size));
       gpuShardsParams_.push_back(gpuParams);
       gpuShardsGrads_.push_back(newTensor(size, devices_[gpu]));
       gpuShardSizes_.push_back(size);
@@ -1028,7 +1053,7 @@ private:
         std::vector<GradientDrop> nodeDroppers;
         for (int client = 0; client < numberClientsOfNodes_[node]; client++) {
           Tensor clientTensor = newTensor(size, devices_[gpu]);
-          clientTensor->copyFrom(graphs_[0]->params()->vals()->subtensor(offset, size)); // Copy initial shard params into tensor
+          clientTensor->copyFrom(graphs_[0]->params()->vals()->view(offset, size)); // Copy initial shard params into tensor
           nodeParams.push_back(clientTensor);
           nodeDroppers.push_back(GradientDrop(new GradientDropBase()));
         }
@@ -1211,7 +1236,7 @@ private:
       if (node != mpi_my_rank_) {
 
         // Copy grads from GPU
-        cudaMemcpy(clientCommBufferGrads_[gpu].data(), newGrads->subtensor(offset, nodeSize)->data(), nodeSize * sizeof(float), cudaMemcpyDeviceToHost);
+        cudaMemcpy(clientCommBufferGrads_[gpu].data(), newGrads->data() + offset, nodeSize * sizeof(float), cudaMemcpyDeviceToHost);
         cudaStreamSynchronize(0);
 
         {
@@ -1228,7 +1253,7 @@ private:
         }
 
         // Copy params to GPU
-        cudaMemcpy(oldParams->subtensor(offset, nodeSize)->data(), clientCommBufferParams_[gpu].data(), nodeSize * sizeof(float), cudaMemcpyHostToDevice);
+        cudaMemcpy(oldParams->data() + offset, clientCommBufferParams_[gpu].data(), nodeSize * sizeof(float), cudaMemcpyHostToDevice);
         cudaStreamSynchronize(0);
 
 
@@ -1244,7 +1269,7 @@ private:
             std::lock_guard<std::mutex> guard(mutexGpuShards_[gpu]);
 
             // Copy grads to appropriate GPU
-            gpuShardsGrads_[gpu]->copyFrom(newGrads->subtensor(offset, size));
+            gpuShardsGrads_[gpu]->copyFrom(newGrads->view(offset, size));
             // Run optimizer on GPU
             if (scale_lr && batchWords > 0) {
               gpuShardsOpts_[gpu]->update(gpuShardsParams_[gpu], gpuShardsGrads_[gpu], batchWords / average_batch_words_loc);
@@ -1253,7 +1278,7 @@ private:
             }
             cudaStreamSynchronize(0);
             // Copy params back to current GPU
-            oldParams->subtensor(offset, size)->copyFrom(gpuShardsParams_[gpu]);
+            oldParams->view(offset, size).copyFrom(gpuShardsParams_[gpu]->view());
           }, gpu, localOffset, gpuSize));
 
           localOffset += gpuSize;
@@ -1408,7 +1433,7 @@ private:
         }
         endOffset++;
 
-        SparseTensorBase(localSparseDeltas_[gpu]->data() + nodeOffset, localSparseDeltas_[gpu]->indices() + nodeOffset, endOffset - nodeOffset, gpu).scatterAdd(oldParams->subtensor(offset, nodeSize), nodeShard * nodeShardSize);
+        SparseTensorBase(localSparseDeltas_[gpu]->data() + nodeOffset, localSparseDeltas_[gpu]->indices() + nodeOffset, endOffset - nodeOffset, gpu).scatterAdd(oldParams->view(offset, nodeSize), nodeShard * nodeShardSize);
         nodeOffset += endOffset;
       }
       cudaStreamSynchronize(0);
@@ -1565,7 +1590,7 @@ private:
         if (t < 3000){
           localOpt->update(graph, batchWords/average_batch_words_loc);
         }
-        gpuShardsParams_[my_id]->copyFrom(graph->params()->vals()->subtensor(my_id*gpuShardSizes_[0], gpuShardSizes_[my_id]));
+        gpuShardsParams_[my_id]->copyFrom(graph->params()->vals()->view(my_id*gpuShardSizes_[0], gpuShardSizes_[my_id]));
       }
       else {
         gradients = graph->params()->grads();
@@ -1703,6 +1728,16 @@ public:
       auto graph = New<ExpressionGraph>();
       graph->setDevice(device);
       graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
+      graph->setMemoryPlanning(options_->get<bool>("memory-planning"));
+      graph->setGraphCapture(options_->get<size_t>("graph-capture"));
+      graph->setFusion(options_->get<bool>("fuse-elementwise"));
+      graph->setProfiling(options_->has("profile"));
+      graph->setCheckpointing(options_->get<int>("rnn-checkpoint") > 0);
+      graph->setHealthMonitor(
+          options_->get<size_t>("health-check"),
+          options_->has("health-dump")
+              ? options_->get<std::string>("health-dump")
+              : "");
       graphs_.push_back(graph);
       gpuShardsOpts_.push_back(Optimizer(options_));
       localOpts_.push_back(Optimizer(options_)); // => for simple SGD opt: localOpts_.push_back(Optimizer<Sgd>(0.0001, keywords::clip=Clipper<Norm>(1)));
@@ -1747,6 +1782,8 @@ public:
     }
   }
 
+  std::vector<Ptr<ExpressionGraph>> getGraphs() { return graphs_; }
+
   /**
    * @brief Save model of first client's graph to disk
    *
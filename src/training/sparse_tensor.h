@@ -123,7 +123,9 @@ public:
     cudaStreamSynchronize(0); 
   }
 
-  void scatterAdd(Tensor t, int offset = 0) {
+  void scatterAdd(Tensor t, int offset = 0) { scatterAdd(t->view(), offset); }
+
+  void scatterAdd(TensorView t, int offset = 0) {
     cudaSetDevice(device_);
     cudaStreamSynchronize(0);
     int threads = 512;
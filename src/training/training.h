@@ -65,6 +65,12 @@ public:
     }
     scheduler->finished();
     model->save(true);
+
+    if(options_->has("memory-stats"))
+      dumpMemoryStats(model->getGraphs(),
+                      options_->get<std::string>("memory-stats"));
+    if(options_->has("profile"))
+      dumpProfile(model->getGraphs(), options_->get<std::string>("profile"));
   }
 };
 }
@@ -155,6 +155,7 @@ public:
 
     penalties_ = graph->constant({1, dimVocab_},
                                  keywords::init = inits::from_vector(p));
+    penalties_->setPersistent(true);
     return New<WordPenaltyState>(dimVocab_, penalties_);
   }
 
@@ -190,6 +191,7 @@ public:
 
     penalties_ = graph->constant({1, dimVocab_},
                                  keywords::init = inits::from_vector(p));
+    penalties_->setPersistent(true);
     return New<WordPenaltyState>(dimVocab_, penalties_);
   }
 
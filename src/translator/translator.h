@@ -41,8 +41,19 @@ public:
     auto devices = options_->get<std::vector<int>>("devices");
     for(auto& device : devices) {
       auto graph = New<ExpressionGraph>(true);
-      graph->setDevice(device);
+      if(options_->get<bool>("cpu")) {
+        graph->setDevice(device, DeviceType::cpu);
+        graph->setInt8(options_->get<bool>("int8"));
+        if(options_->has("half-precision"))
+          graph->setHalfPrecision(options_->get<std::string>("half-precision"));
+        graph->setConcurrency(options_->get<bool>("concurrent-graph"));
+      } else {
+        graph->setDevice(device);
+      }
       graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
+      graph->setFusion(options_->get<bool>("fuse-elementwise"));
+      graph->setEagerRelease(options_->get<bool>("eager-release"));
+      graph->setProfiling(options_->has("profile"));
       graphs_.push_back(graph);
 
       auto scorers = createScorers(options);
@@ -56,42 +67,49 @@ public:
     data::BatchGenerator<data::Corpus> bg(corpus_, options_);
 
     auto devices = options_->get<std::vector<int>>("devices");
-    ThreadPool threadPool(devices.size(), devices.size());
-
     auto collector = New<OutputCollector>();
     size_t sentenceId = 0;
 
     bg.prepare(false);
 
-    while(bg) {
-      auto batch = bg.next();
+    {
+      ThreadPool threadPool(devices.size(), devices.size());
+      while(bg) {
+        auto batch = bg.next();
 
-      auto task = [=](size_t id) {
-        thread_local Ptr<ExpressionGraph> graph;
-        thread_local std::vector<Ptr<Scorer>> scorers;
+        auto task = [=](size_t id) {
+          thread_local Ptr<ExpressionGraph> graph;
+          thread_local std::vector<Ptr<Scorer>> scorers;
 
-        if(!graph) {
-          graph = graphs_[id % devices.size()];
-          graph->getBackend()->setDevice(graph->getDevice());
-          scorers = scorers_[id % devices.size()];
-        }
+          if(!graph) {
+            graph = graphs_[id % devices.size()];
+            graph->getBackend()->setDevice(graph->getDevice());
+            scorers = scorers_[id % devices.size()];
+          }
 
-        auto search = New<Search>(options_, scorers);
-        auto history = search->search(graph, batch, id);
+          auto search = New<Search>(options_, scorers);
+          auto history = search->search(graph, batch, id);
 
-        std::stringstream best1;
-        std::stringstream bestn;
-        Printer(options_, trgVocab_, history, best1, bestn);
-        collector->Write(history->GetLineNum(),
-                         best1.str(),
-                         bestn.str(),
-                         options_->get<bool>("n-best"));
-      };
+          std::stringstream best1;
+          std::stringstream bestn;
+          Printer(options_, trgVocab_, history, best1, bestn);
+          collector->Write(history->GetLineNum(),
+                           best1.str(),
+                           bestn.str(),
+                           options_->get<bool>("n-best"));
+        };
 
-      threadPool.enqueue(task, sentenceId);
+        threadPool.enqueue(task, sentenceId);
 
-      sentenceId++;
+        sentenceId++;
+      }
+      // leaving the scope joins the translation threads
     }
+
+    if(options_->has("memory-stats"))
+      dumpMemoryStats(graphs_, options_->get<std::string>("memory-stats"));
+    if(options_->has("profile"))
+      dumpProfile(graphs_, options_->get<std::string>("profile"));
   }
 };
 
@@ -130,8 +148,18 @@ public:
     // initialize scorers
     for(auto& device : devices_) {
       auto graph = New<ExpressionGraph>(true);
-      graph->setDevice(device);
+      if(options_->get<bool>("cpu")) {
+        graph->setDevice(device, DeviceType::cpu);
+        graph->setInt8(options_->get<bool>("int8"));
+        if(options_->has("half-precision"))
+          graph->setHalfPrecision(options_->get<std::string>("half-precision"));
+        graph->setConcurrency(options_->get<bool>("concurrent-graph"));
+      } else {
+        graph->setDevice(device);
+      }
       graph->reserveWorkspaceMB(options_->get<size_t>("workspace"));
+      graph->setFusion(options_->get<bool>("fuse-elementwise"));
+      graph->setEagerRelease(options_->get<bool>("eager-release"));
       graphs_.push_back(graph);
 
       auto scorers = createScorers(options_);